@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 ImpactX contributors
+# Authors: Axel Huebl, Chad Mitchell
+# License: BSD-3-Clause-LBNL
+#
+
+
+import os
+
+import numpy as np
+
+
+def read_reduced_diags(name):
+    """Read the reduced beam characteristics of the last step
+
+    Returns
+    -------
+    sigx, sigy, sigt, emittance_x, emittance_y, emittance_t
+    """
+    rdc_name = f"diags/{name}.0"
+    if not os.path.exists(rdc_name):  # OpenMP
+        rdc_name += ".0"
+    data = np.loadtxt(rdc_name, skiprows=1, ndmin=2)
+    last = data[-1, :]
+
+    # columns: step s x_mean x_min x_max ... sig_x sig_y sig_t ... emittance_x emittance_y emittance_t
+    sigx, sigy, sigt = last[11], last[12], last[13]
+    emittance_x, emittance_y, emittance_t = last[26], last[27], last[28]
+
+    return (sigx, sigy, sigt, emittance_x, emittance_y, emittance_t)
+
+
+# the envelope is transported without sampling noise
+atol = 0.0  # ignored
+rtol = 1.0e-6
+print(f"  rtol={rtol} (ignored: atol~={atol})")
+
+print("Initial Beam:")
+sigx, sigy, sigt, emittance_x, emittance_y, emittance_t = read_reduced_diags(
+    "reduced_beam_characteristics"
+)
+print(f"  sigx={sigx:e} sigy={sigy:e} sigt={sigt:e}")
+print(
+    f"  emittance_x={emittance_x:e} emittance_y={emittance_y:e} emittance_t={emittance_t:e}"
+)
+
+assert np.allclose(
+    [sigx, sigy, sigt, emittance_x, emittance_y, emittance_t],
+    [
+        7.5121493728802567e-005,
+        7.5121493728802567e-005,
+        1.0000000000000000e-003,
+        2.0000000000000000e-009,
+        2.0000000000000000e-009,
+        2.0000000000000000e-006,
+    ],
+    rtol=rtol,
+    atol=atol,
+)
+
+
+print("")
+print("Final Beam:")
+sigx, sigy, sigt, emittance_x, emittance_y, emittance_t = read_reduced_diags(
+    "reduced_beam_characteristics_final"
+)
+print(f"  sigx={sigx:e} sigy={sigy:e} sigt={sigt:e}")
+print(
+    f"  emittance_x={emittance_x:e} emittance_y={emittance_y:e} emittance_t={emittance_t:e}"
+)
+
+# the FODO cell is matched: the final second moments equal the initial ones
+assert np.allclose(
+    [sigx, sigy, sigt, emittance_x, emittance_y, emittance_t],
+    [
+        7.5121493522517667e-005,
+        7.5121493841353161e-005,
+        1.0000000000000000e-003,
+        2.0000000000000000e-009,
+        2.0000000000000000e-009,
+        2.0000000000000000e-006,
+    ],
+    rtol=rtol,
+    atol=atol,
+)
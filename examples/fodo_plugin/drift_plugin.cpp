@@ -0,0 +1,101 @@
+/* Copyright 2022-2023 ImpactX contributors
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ *
+ * An element plugin that implements a drift, loaded by ImpactX at runtime.
+ *
+ * Build on CPU, e.g., with:
+ *   c++ -O3 -shared -fPIC -I<ImpactX>/src drift_plugin.cpp -o drift_plugin.so
+ */
+#include "particles/elements/PluginABI.H"
+
+#include <cmath>
+#include <cstdint>
+
+
+namespace
+{
+    struct Drift
+    {
+        double ds; // segment length in m
+    };
+
+    void *
+    create (double ds, int num_parameters, char const * const * /* names */, double const * /* values */)
+    {
+        // this element has no parameters
+        if (num_parameters != 0) { return nullptr; }
+        return new Drift{ds};
+    }
+
+    void
+    destroy (void * state)
+    {
+        delete static_cast<Drift *>(state);
+    }
+
+    void
+    push_particles (
+        void const * /* state */,
+        int64_t num_particles,
+        IMPACTX_PLUGIN_REAL * x,
+        IMPACTX_PLUGIN_REAL * y,
+        IMPACTX_PLUGIN_REAL * t,
+        IMPACTX_PLUGIN_REAL * px,
+        IMPACTX_PLUGIN_REAL * py,
+        IMPACTX_PLUGIN_REAL * pt,
+        uint64_t * idcpu,
+        impactx_plugin_refpart const * refpart,
+        double slice_ds
+    )
+    {
+        // access reference particle values to find beta*gamma^2
+        double const betgam2 = refpart->pt * refpart->pt - 1.0;
+
+        // advance position and momentum (drift)
+        for (int64_t i = 0; i < num_particles; ++i) {
+            if (!impactx_plugin_is_valid(idcpu[i])) { continue; }
+
+            x[i] += slice_ds * px[i];
+            y[i] += slice_ds * py[i];
+            t[i] += (slice_ds / betgam2) * pt[i];
+        }
+    }
+
+    void
+    push_reference (void const * /* state */, impactx_plugin_refpart * refpart, double slice_ds)
+    {
+        // assign intermediate parameter
+        double const step = slice_ds / std::sqrt(refpart->pt * refpart->pt - 1.0);
+
+        // advance position and momentum (drift)
+        refpart->x += step * refpart->px;
+        refpart->y += step * refpart->py;
+        refpart->z += step * refpart->pz;
+        refpart->t -= step * refpart->pt;
+
+        // advance integrated path length
+        refpart->s += slice_ds;
+    }
+
+    impactx_plugin_element const elements[] = {
+        {"drift", create, destroy, push_particles, push_reference}
+    };
+
+    impactx_plugin const plugin = {
+        IMPACTX_PLUGIN_ABI_VERSION,
+        sizeof(IMPACTX_PLUGIN_REAL),
+        1,
+        elements
+    };
+} // namespace
+
+extern "C"
+#if defined(__GNUC__)
+__attribute__((visibility("default")))
+#endif
+impactx_plugin const *
+impactx_plugin_register ()
+{
+    return &plugin;
+}
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 ImpactX contributors
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+from impactx import ImpactX, distribution, elements
+
+sim = ImpactX()
+
+# set numerical parameters and IO control
+sim.particle_shape = 2  # B-spline order
+sim.space_charge = False
+# sim.diagnostics = False  # benchmarking
+sim.slice_step_diagnostics = True
+
+# domain decomposition & space charge mesh
+sim.init_grids()
+
+# load a 2 GeV electron beam with an initial
+# unnormalized rms emittance of 2 nm
+kin_energy_MeV = 2.0e3  # reference energy
+bunch_charge_C = 1.0e-9  # used with space charge
+npart = 10000  # number of macro particles
+
+#   reference particle
+ref = sim.particle_container().ref_particle()
+ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(kin_energy_MeV)
+
+#   particle bunch
+distr = distribution.Waterbag(
+    lambdaX=3.9984884770e-5,
+    lambdaY=3.9984884770e-5,
+    lambdaT=1.0e-3,
+    lambdaPx=2.6623538760e-5,
+    lambdaPy=2.6623538760e-5,
+    lambdaPt=2.0e-3,
+    muxpx=-0.846574929020762,
+    muypy=0.846574929020762,
+    mutpt=0.0,
+)
+sim.add_particles(bunch_charge_C, distr, npart)
+
+# the drifts are elements of a plugin, loaded at runtime
+plugin = "../drift_plugin.so"
+
+# add beam diagnostics
+monitor = elements.BeamMonitor("monitor", backend="h5")
+
+# design the accelerator lattice)
+ns = 25  # number of slices per ds in the element
+fodo = [
+    monitor,
+    elements.Plugin(plugin, element="drift", ds=0.25, nslice=ns),
+    monitor,
+    elements.Quad(ds=1.0, k=1.0, nslice=ns),
+    monitor,
+    elements.Plugin(plugin, element="drift", ds=0.5, nslice=ns),
+    monitor,
+    elements.Quad(ds=1.0, k=-1.0, nslice=ns),
+    monitor,
+    elements.Plugin(plugin, element="drift", ds=0.25, nslice=ns),
+    monitor,
+]
+# assign a fodo segment
+sim.lattice.extend(fodo)
+
+# run simulation
+sim.evolve()
+
+# clean shutdown
+sim.finalize()
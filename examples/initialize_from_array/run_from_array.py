@@ -9,7 +9,6 @@
 import numpy as np
 import transformation_utilities as pycoord
 
-import amrex.space3d as amr
 from impactx import Config, ImpactX, elements
 
 ################
@@ -62,37 +61,13 @@ dx, dy, dz, dpx, dpy, dpz = pycoord.to_ref_part_t_from_global_t(
 )
 dx, dy, dt, dpx, dpy, dpt = pycoord.to_s_from_t(ref, dx, dy, dz, dpx, dpy, dpz)
 
-if not Config.have_gpu:  # initialize using cpu-based PODVectors
-    dx_podv = amr.PODVector_real_std()
-    dy_podv = amr.PODVector_real_std()
-    dt_podv = amr.PODVector_real_std()
-    dpx_podv = amr.PODVector_real_std()
-    dpy_podv = amr.PODVector_real_std()
-    dpt_podv = amr.PODVector_real_std()
-else:  # initialize on device using arena/gpu-based PODVectors
-    dx_podv = amr.PODVector_real_arena()
-    dy_podv = amr.PODVector_real_arena()
-    dt_podv = amr.PODVector_real_arena()
-    dpx_podv = amr.PODVector_real_arena()
-    dpy_podv = amr.PODVector_real_arena()
-    dpt_podv = amr.PODVector_real_arena()
-
-for p_dx in dx:
-    dx_podv.push_back(p_dx)
-for p_dy in dy:
-    dy_podv.push_back(p_dy)
-for p_dt in dt:
-    dt_podv.push_back(p_dt)
-for p_dpx in dpx:
-    dpx_podv.push_back(p_dpx)
-for p_dpy in dpy:
-    dpy_podv.push_back(p_dpy)
-for p_dpt in dpt:
-    dpt_podv.push_back(p_dpt)
-
-pc.add_n_particles(
-    dx_podv, dy_podv, dt_podv, dpx_podv, dpy_podv, dpt_podv, qm_eev, bunch_charge_C
-)
+if Config.have_gpu:  # initialize from device memory
+    import cupy as cp
+
+    dx, dy, dt, dpx, dpy, dpt = (cp.asarray(a) for a in (dx, dy, dt, dpx, dpy, dpt))
+
+# copied directly into the particle tile, without intermediate buffers
+pc.add_n_particles(dx, dy, dt, dpx, dpy, dpt, qm_eev, bunch_charge_C)
 
 monitor = elements.BeamMonitor("monitor", backend="h5")
 sim.lattice.extend(
@@ -14,6 +14,13 @@
 #include "particles/ImpactXParticleContainer.H"
 #include "particles/Push.H"
 #include "particles/diagnostics/DiagnosticOutput.H"
+#include "particles/diagnostics/LossMap.H"
+#include "particles/elements/diagnostics/AsyncIO.H"
+#include "particles/ensemble/EnsembleDiagnostics.H"
+#include "particles/ensemble/EnsemblePush.H"
+#include "particles/envelope/EnvelopePush.H"
+#include "particles/smallbeam/DynamicAperture.H"
+#include "particles/smallbeam/SmallBeam.H"
 #include "particles/spacecharge/ForceFromSelfFields.H"
 #include "particles/spacecharge/GatherAndPush.H"
 #include "particles/spacecharge/PoissonSolve.H"
@@ -28,11 +35,63 @@
 #include <AMReX_Print.H>
 #include <AMReX_Utility.H>
 
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 
 namespace impactx {
+namespace
+{
+    /** The loss map along the lattice, if enabled with diag.loss_map
+     *
+     * @param diag_enable diagnostics are enabled
+     */
+    std::optional<diagnostics::LossMap>
+    make_loss_map (bool diag_enable)
+    {
+        amrex::ParmParse pp_diag("diag");
+        bool loss_map_enable = false;
+        pp_diag.queryAdd("loss_map", loss_map_enable);
+        if (!diag_enable || !loss_map_enable) { return std::nullopt; }
+
+        amrex::ParticleReal loss_map_ds = 0.1; // in meters
+        pp_diag.queryAdd("loss_map_ds", loss_map_ds);
+        return diagnostics::LossMap(loss_map_ds);
+    }
+
+    /** Add the particles lost in a slice step to the loss map
+     *
+     * @param loss_map the loss map
+     * @param lost the particles lost in the slice step, on this MPI rank
+     * @param period index of the period through the lattice
+     * @param element_index index of the element in the lattice
+     * @param element_variant the element
+     * @param ref_part the reference particle after the slice step
+     */
+    void
+    add_to_loss_map (
+        diagnostics::LossMap & loss_map,
+        LostParticles const & lost,
+        int period,
+        int element_index,
+        KnownElements const & element_variant,
+        RefPart const & ref_part
+    )
+    {
+        std::string const element_type = std::visit([](auto && element) -> std::string {
+            return std::decay_t<decltype(element)>::type;
+        }, element_variant);
+        loss_map.add(lost, period, element_index, element_type, ref_part.s, ref_part.charge);
+    }
+} // namespace
+
     ImpactX::ImpactX() {
         // todo: if amr.n_cells is provided, overwrite/redefine AmrCore object
 
@@ -49,7 +108,13 @@ namespace impactx {
     {
         if (m_grids_initialized)
         {
+            diagnostics::close_diagnostics();
+            diagnostics::async_io::shutdown();
+
             m_lattice.clear();
+            m_envelope.reset();
+            m_ensemble.clear();
+            m_num_generated_particles = 0;
 
             // this one last
             amr_data.reset();
@@ -130,6 +195,93 @@ namespace impactx {
 
         validate();
 
+        std::string track = "particles";
+        amrex::ParmParse("algo").queryAdd("track", track);
+
+        if (track == "particles") {
+            if (m_ensemble.empty()) {
+                track_particles();
+            } else {
+                track_ensemble();
+            }
+        } else if (track == "envelope") {
+            track_envelope();
+        } else if (track == "dynamic_aperture") {
+            track_dynamic_aperture();
+        } else {
+            throw std::runtime_error("Unknown algo.track (particles/envelope/dynamic_aperture): " + track);
+        }
+    }
+
+    int ImpactX::walk_lattice (
+        int periods,
+        int global_step,
+        int verbose,
+        bool diag_enable,
+        std::function<void(int, int, KnownElements &, amrex::ParticleReal, int)> const & push,
+        std::function<void(int)> const & slice_step_diagnostics
+    )
+    {
+        amrex::ParmParse pp_diag("diag");
+
+        // check typos in inputs after step 1
+        bool early_params_checked = false;
+
+        for (int cycle=0; cycle < periods; ++cycle) {
+            // loop over all beamline elements
+            int element_index = 0;
+            for (auto &element_variant: m_lattice) {
+                // update element edge of the reference particle
+                amr_data->m_particle_container->SetRefParticleEdge();
+
+                // number of slices used for the application of space charge
+                int nslice = 1;
+                amrex::ParticleReal slice_ds; // in meters
+                std::visit([&nslice, &slice_ds](auto &&element) {
+                    nslice = element.nslice();
+                    slice_ds = element.ds() / nslice;
+                }, element_variant);
+
+                // sub-steps for space charge within the element
+                for (int slice_step = 0; slice_step < nslice; ++slice_step) {
+                    BL_PROFILE("ImpactX::evolve::slice_step");
+                    global_step++;
+                    if (verbose > 0) {
+                        amrex::Print() << " ++++ Starting global_step=" << global_step
+                                       << " slice_step=" << slice_step << "\n";
+                    }
+
+                    push(cycle, element_index, element_variant, slice_ds, global_step);
+
+                    // just prints an empty newline at the end of the slice_step
+                    if (verbose > 0) {
+                        amrex::Print() << "\n";
+                    }
+
+                    // slice-step diagnostics
+                    bool slice_step_diagnostics_enable = false;
+                    pp_diag.queryAdd("slice_step_diagnostics", slice_step_diagnostics_enable);
+
+                    if (diag_enable && slice_step_diagnostics_enable) {
+                        slice_step_diagnostics(global_step);
+                    }
+
+                    // inputs: unused parameters (e.g. typos) check after step 1 has finished
+                    if (!early_params_checked) { early_params_checked = early_param_check(); }
+
+                } // end in-element space-charge slice-step loop
+
+                ++element_index;
+            } // end beamline element loop
+        } // end periods though the lattice loop
+
+        return global_step;
+    }
+
+    void ImpactX::track_particles ()
+    {
+        BL_PROFILE("ImpactX::track_particles");
+
         // verbosity
         amrex::ParmParse pp_impactx("impactx");
         int verbose = 1;
@@ -150,6 +302,7 @@ namespace impactx {
         }
 
         int file_min_digits = 6;
+        bool sliced_diag_enable = false;
         if (diag_enable)
         {
             pp_diag.queryAdd("file_min_digits", file_min_digits);
@@ -165,6 +318,14 @@ namespace impactx {
                                           diagnostics::OutputType::PrintReducedBeamCharacteristics,
                                           "diags/reduced_beam_characteristics");
 
+            // print the initial sliced beam characteristics
+            pp_diag.queryAdd("sliced_beam_characteristics", sliced_diag_enable);
+            if (sliced_diag_enable) {
+                diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+                                              diagnostics::OutputType::PrintSlicedBeamCharacteristics,
+                                              "diags/sliced_beam_characteristics");
+            }
+
         }
 
         amrex::ParmParse pp_algo("algo");
@@ -180,93 +341,477 @@ namespace impactx {
             amrex::Print() << " CSR effects: " << csr << "\n";
         }
 
+        // optional: in situ loss map along the lattice
+        std::optional<diagnostics::LossMap> loss_map = make_loss_map(diag_enable);
+
         // periods through the lattice
         int periods = 1;
         amrex::ParmParse("lattice").queryAdd("periods", periods);
 
-        for (int cycle=0; cycle < periods; ++cycle) {
-            // loop over all beamline elements
-            for (auto &element_variant: m_lattice) {
-                // update element edge of the reference particle
-                amr_data->m_particle_container->SetRefParticleEdge();
+        // optional: small beam mode, with low overhead per slice step
+        bool small_beam_enable = false;
+        pp_algo.queryAdd("small_beam", small_beam_enable);
 
-                // number of slices used for the application of space charge
-                int nslice = 1;
-                amrex::ParticleReal slice_ds; // in meters
-                std::visit([&nslice, &slice_ds](auto &&element) {
-                    nslice = element.nslice();
-                    slice_ds = element.ds() / nslice;
-                }, element_variant);
+        if (small_beam_enable) {
+            bool slice_step_diagnostics = false;
+            pp_diag.queryAdd("slice_step_diagnostics", slice_step_diagnostics);
+            if (space_charge || csr || (diag_enable && slice_step_diagnostics)) {
+                throw std::runtime_error(
+                    "algo.small_beam is not possible with space charge, CSR or diag.slice_step_diagnostics.");
+            }
+            if (verbose > 0) {
+                amrex::Print() << " Small beam mode: tracking on the host\n";
+            }
 
-                // sub-steps for space charge within the element
-                for (int slice_step = 0; slice_step < nslice; ++slice_step) {
-                    BL_PROFILE("ImpactX::evolve::slice_step");
-                    global_step++;
-                    if (verbose > 0) {
-                        amrex::Print() << " ++++ Starting global_step=" << global_step
-                                       << " slice_step=" << slice_step << "\n";
+            global_step = small_beam::track(*amr_data->m_particle_container, m_lattice, periods, global_step,
+                                            loss_map ? &loss_map.value() : nullptr);
+
+            // inputs: unused parameters (e.g. typos) check after tracking has finished
+            if (!early_params_checked) { early_params_checked = early_param_check(); }
+        } else {
+            auto const push = [&](int cycle, int element_index, KnownElements & element_variant,
+                                  amrex::ParticleReal slice_ds, int step) {
+                // Wakefield calculation: call wakefield function to apply wake effects
+                particles::wakefields::HandleWakefield(*amr_data->m_particle_container, element_variant, slice_ds);
+
+                // Space-charge calculation: turn off if there is only 1 particle
+                if (space_charge &&
+                    amr_data->m_particle_container->TotalNumberOfParticles(true, false)) {
+
+                    // transform from x',y',t to x,y,z
+                    transformation::CoordinateTransformation(
+                            *amr_data->m_particle_container,
+                            CoordSystem::t);
+
+                    // Note: The following operation assume that
+                    // the particles are in x, y, z coordinates.
+
+                    // Resize the mesh, based on `m_particle_container` extent
+                    ResizeMesh();
+
+                    // Redistribute particles in the new mesh in x, y, z
+                    amr_data->m_particle_container->Redistribute();
+
+                    // charge deposition
+                    amr_data->m_particle_container->DepositCharge(amr_data->m_rho, amr_data->refRatio());
+
+                    // poisson solve in x,y,z
+                    int const mlmg_iters = spacecharge::PoissonSolve(*amr_data->m_particle_container,
+                                                                     amr_data->m_rho,
+                                                                     amr_data->m_phi,
+                                                                     amr_data->refRatio(),
+                                                                     amr_data->m_poisson_solver);
+                    if (verbose > 1 && mlmg_iters > 0) {
+                        amrex::Print() << " Poisson solve: " << mlmg_iters << " MLMG iterations\n";
                     }
 
-                    // Wakefield calculation: call wakefield function to apply wake effects
-                    particles::wakefields::HandleWakefield(*amr_data->m_particle_container, element_variant, slice_ds);
+                    // calculate force in x,y,z
+                    spacecharge::ForceFromSelfFields(amr_data->m_space_charge_field,
+                                                     amr_data->m_phi,
+                                                     amr_data->Geom());
+
+                    // gather and space-charge push in x,y,z , assuming the space-charge
+                    // field is the same before/after transformation
+                    // TODO: This is currently using linear order.
+                    spacecharge::GatherAndPush(*amr_data->m_particle_container,
+                                               amr_data->m_space_charge_field,
+                                               amr_data->Geom(),
+                                               slice_ds);
+
+                    // transform from x,y,z to x',y',t
+                    transformation::CoordinateTransformation(*amr_data->m_particle_container,
+                                                             CoordSystem::s);
+                }
+
+                // for later: original Impact implementation as an option
+                // Redistribute particles in x',y',t
+                //   TODO: only needed if we want to gather and push space charge
+                //         in x',y',t
+                //   TODO: change geometry beforehand according to transformation
+                //m_particle_container->Redistribute();
+                //
+                // in original Impact, we gather and space-charge push in x',y',t ,
+                // assuming that the distribution did not change
+
+                // push all particles with external maps
+                Push(*amr_data->m_particle_container, element_variant, step);
+
+                // move "lost" particles to another particle container
+                LostParticles const lost = collect_lost_particles(*amr_data->m_particle_container);
+                if (loss_map) {
+                    add_to_loss_map(*loss_map, lost, cycle, element_index, element_variant,
+                                    amr_data->m_particle_container->GetRefParticle());
+                }
+            };
+
+            auto const slice_step_diagnostics = [&](int step) {
+                // print slice step reference particle to file
+                diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+                                              diagnostics::OutputType::PrintRefParticle,
+                                              "diags/ref_particle",
+                                              step,
+                                              true);
+
+                // print slice step reduced beam characteristics to file
+                diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+                                              diagnostics::OutputType::PrintReducedBeamCharacteristics,
+                                              "diags/reduced_beam_characteristics",
+                                              step,
+                                              true);
+
+                // print slice step sliced beam characteristics to file
+                if (sliced_diag_enable) {
+                    diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+                                                  diagnostics::OutputType::PrintSlicedBeamCharacteristics,
+                                                  "diags/sliced_beam_characteristics",
+                                                  step,
+                                                  true);
+                }
+            };
+
+            global_step = walk_lattice(periods, global_step, verbose, diag_enable, push, slice_step_diagnostics);
+        } // end small beam mode
+
+        if (diag_enable)
+        {
+            // print final reference particle to file
+            diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+                                          diagnostics::OutputType::PrintRefParticle,
+                                          "diags/ref_particle_final",
+                                          global_step);
+
+            // print the final values of the reduced beam characteristics
+            diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+                                          diagnostics::OutputType::PrintReducedBeamCharacteristics,
+                                          "diags/reduced_beam_characteristics_final",
+                                          global_step);
+
+            // print the final sliced beam characteristics
+            if (sliced_diag_enable) {
+                diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+                                              diagnostics::OutputType::PrintSlicedBeamCharacteristics,
+                                              "diags/sliced_beam_characteristics_final",
+                                              global_step);
+            }
+
+            // output particles lost in apertures
+            if (amr_data->m_particles_lost->TotalNumberOfParticles() > 0)
+            {
+                std::string openpmd_backend = "default";
+                pp_diag.queryAdd("backend", openpmd_backend);
+
+                diagnostics::BeamMonitor output_lost("particles_lost", openpmd_backend, "g");
+                output_lost(*amr_data->m_particles_lost, 0);
+                output_lost.finalize();
+            }
+
+            // where particles got lost
+            if (loss_map) { loss_map->write("diags/loss_map"); }
+
+            // write all buffered diagnostics and close the files
+            diagnostics::close_diagnostics();
+        }
+
+        // loop over all beamline elements & finalize them
+        for (auto & element_variant : m_lattice)
+        {
+            std::visit([](auto&& element){
+                element.finalize();
+            }, element_variant);
+        }
+    }
+
+    void ImpactX::track_envelope ()
+    {
+        BL_PROFILE("ImpactX::track_envelope");
+
+        // verbosity
+        amrex::ParmParse pp_impactx("impactx");
+        int verbose = 1;
+        pp_impactx.queryAdd("verbose", verbose);
+
+        // the reference particle is stored with the particle container
+        RefPart & ref = amr_data->m_particle_container->GetRefParticle();
+        envelope::Envelope & env = m_envelope.value();
+
+        // a global step for diagnostics including space charge slice steps in elements
+        //   before we start the evolve loop, we are in "step 0" (initial state)
+        int global_step = 0;
+
+        amrex::ParmParse pp_diag("diag");
+        bool diag_enable = true;
+        pp_diag.queryAdd("enable", diag_enable);
+        if (verbose > 0) {
+            amrex::Print() << " Diagnostics: " << diag_enable << "\n";
+        }
+
+        if (diag_enable)
+        {
+            // print initial reference particle to file
+            diagnostics::DiagnosticOutput(env, ref,
+                                          diagnostics::OutputType::PrintRefParticle,
+                                          "diags/ref_particle",
+                                          global_step);
+
+            // print the initial values of reduced beam characteristics
+            diagnostics::DiagnosticOutput(env, ref,
+                                          diagnostics::OutputType::PrintReducedBeamCharacteristics,
+                                          "diags/reduced_beam_characteristics");
+        }
+
+        amrex::ParmParse pp_algo("algo");
+        bool space_charge = false;
+        pp_algo.query("space_charge", space_charge);
+        if (verbose > 0) {
+            amrex::Print() << " Space Charge effects (2D K-V envelope): " << space_charge << "\n";
+        }
+
+        // periods through the lattice
+        int periods = 1;
+        amrex::ParmParse("lattice").queryAdd("periods", periods);
+
+        auto const push = [&](int /* cycle */, int /* element_index */, KnownElements & element_variant,
+                              amrex::ParticleReal slice_ds, int /* step */) {
+            // linear space charge kick of a K-V beam with the envelope's rms sizes
+            if (space_charge) {
+                envelope::kv_space_charge_push(env, ref, slice_ds);
+            }
+
+            // push the reference particle and the envelope with the linear map of the element
+            envelope::Push(env, ref, element_variant);
+        };
+
+        auto const slice_step_diagnostics = [&](int step) {
+            // print slice step reference particle to file
+            diagnostics::DiagnosticOutput(env, ref,
+                                          diagnostics::OutputType::PrintRefParticle,
+                                          "diags/ref_particle",
+                                          step,
+                                          true);
+
+            // print slice step reduced beam characteristics to file
+            diagnostics::DiagnosticOutput(env, ref,
+                                          diagnostics::OutputType::PrintReducedBeamCharacteristics,
+                                          "diags/reduced_beam_characteristics",
+                                          step,
+                                          true);
+        };
+
+        global_step = walk_lattice(periods, global_step, verbose, diag_enable, push, slice_step_diagnostics);
+
+        if (diag_enable)
+        {
+            // print final reference particle to file
+            diagnostics::DiagnosticOutput(env, ref,
+                                          diagnostics::OutputType::PrintRefParticle,
+                                          "diags/ref_particle_final",
+                                          global_step);
+
+            // print the final values of the reduced beam characteristics
+            diagnostics::DiagnosticOutput(env, ref,
+                                          diagnostics::OutputType::PrintReducedBeamCharacteristics,
+                                          "diags/reduced_beam_characteristics_final",
+                                          global_step);
+
+            // write all buffered diagnostics and close the files
+            diagnostics::close_diagnostics();
+        }
+
+        // loop over all beamline elements & finalize them
+        for (auto & element_variant : m_lattice)
+        {
+            std::visit([](auto&& element){
+                element.finalize();
+            }, element_variant);
+        }
+    }
+
+    void ImpactX::track_dynamic_aperture ()
+    {
+        BL_PROFILE("ImpactX::track_dynamic_aperture");
+
+        // verbosity
+        amrex::ParmParse pp_impactx("impactx");
+        int verbose = 1;
+        pp_impactx.queryAdd("verbose", verbose);
+
+        amrex::ParmParse pp_diag("diag");
+        bool diag_enable = true;
+        pp_diag.queryAdd("enable", diag_enable);
+        if (verbose > 0) {
+            amrex::Print() << " Diagnostics: " << diag_enable << "\n";
+        }
+
+        // the grid of probes
+        amrex::ParmParse const pp_da("da");
+        std::string plane = "xy";
+        pp_da.queryAdd("plane", plane);
+        amrex::ParticleReal x_min = 0.0, x_max = 0.0, v_min = 0.0, v_max = 0.0;
+        int num_x = 0, num_v = 0;
+        pp_da.get("x_min", x_min);
+        pp_da.get("x_max", x_max);
+        pp_da.get("num_x", num_x);
+        pp_da.get("v_min", v_min);
+        pp_da.get("v_max", v_max);
+        pp_da.get("num_v", num_v);
+        amrex::ParticleReal pt = 0.0;
+        pp_da.queryAdd("pt", pt);
+        amrex::ParticleReal max_amplitude = 1.0;
+        pp_da.queryAdd("max_amplitude", max_amplitude);
+
+        small_beam::DynamicAperture da(plane, x_min, x_max, num_x, v_min, v_max, num_v, pt, max_amplitude);
+
+        // maximum number of turns
+        int periods = 1;
+        amrex::ParmParse("lattice").queryAdd("periods", periods);
+        if (verbose > 0) {
+            amrex::Print() << " Dynamic aperture scan: " << da.num_probes() << " probes in the "
+                           << plane << " plane, up to " << periods << " turns\n";
+        }
+
+        da.add_probes(*amr_data->m_particle_container);
+        int const turns = da.track(*amr_data->m_particle_container, m_lattice, periods);
+
+        // inputs: unused parameters (e.g. typos) check after tracking has finished
+        early_param_check();
+
+        if (diag_enable)
+        {
+            // survival map: turn and position s of the loss of each probe
+            int const num_survived = da.write("diags/dynamic_aperture");
+            if (verbose > 0) {
+                amrex::Print() << " Dynamic aperture scan: " << num_survived << " of " << da.num_probes()
+                               << " probes survived " << turns << " turns\n";
+            }
+
+            // print final reference particle to file
+            diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+                                          diagnostics::OutputType::PrintRefParticle,
+                                          "diags/ref_particle_final",
+                                          0);
+
+            // write all buffered diagnostics and close the files
+            diagnostics::close_diagnostics();
+        }
 
-                    // Space-charge calculation: turn off if there is only 1 particle
-                    if (space_charge &&
-                        amr_data->m_particle_container->TotalNumberOfParticles(true, false)) {
+        // loop over all beamline elements & finalize them
+        for (auto & element_variant : m_lattice)
+        {
+            std::visit([](auto&& element){
+                element.finalize();
+            }, element_variant);
+        }
+    }
 
-                        // transform from x',y',t to x,y,z
-                        transformation::CoordinateTransformation(
-                                *amr_data->m_particle_container,
-                                CoordSystem::t);
+    std::vector<std::unordered_map<std::string, amrex::ParticleReal>>
+    ImpactX::ensemble_reduced_beam_characteristics ()
+    {
+        return ensemble::reduced_beam_characteristics(*amr_data->m_particle_container, m_ensemble);
+    }
 
-                        // Note: The following operation assume that
-                        // the particles are in x, y, z coordinates.
+    void ImpactX::track_ensemble ()
+    {
+        BL_PROFILE("ImpactX::track_ensemble");
 
-                        // Resize the mesh, based on `m_particle_container` extent
-                        ResizeMesh();
+        auto & pc = *amr_data->m_particle_container;
 
-                        // Redistribute particles in the new mesh in x, y, z
-                        amr_data->m_particle_container->Redistribute();
+        // verbosity
+        amrex::ParmParse pp_impactx("impactx");
+        int verbose = 1;
+        pp_impactx.queryAdd("verbose", verbose);
+        if (verbose > 0) {
+            amrex::Print() << " Ensemble members: " << m_ensemble.size() << "\n";
+        }
 
-                        // charge deposition
-                        amr_data->m_particle_container->DepositCharge(amr_data->m_rho, amr_data->refRatio());
+        // a global step for diagnostics including slice steps in elements
+        //   before we start the evolve loop, we are in "step 0" (initial state)
+        int global_step = 0;
 
-                        // poisson solve in x,y,z
-                        spacecharge::PoissonSolve(*amr_data->m_particle_container, amr_data->m_rho, amr_data->m_phi, amr_data->refRatio());
+        // check typos in inputs after step 1
+        bool early_params_checked = false;
 
-                        // calculate force in x,y,z
-                        spacecharge::ForceFromSelfFields(amr_data->m_space_charge_field,
-                                                         amr_data->m_phi,
-                                                         amr_data->Geom());
+        amrex::ParmParse pp_diag("diag");
+        bool diag_enable = true;
+        pp_diag.queryAdd("enable", diag_enable);
+        if (verbose > 0) {
+            amrex::Print() << " Diagnostics: " << diag_enable << "\n";
+        }
 
-                        // gather and space-charge push in x,y,z , assuming the space-charge
-                        // field is the same before/after transformation
-                        // TODO: This is currently using linear order.
-                        spacecharge::GatherAndPush(*amr_data->m_particle_container,
-                                                   amr_data->m_space_charge_field,
-                                                   amr_data->Geom(),
-                                                   slice_ds);
+        if (diag_enable)
+        {
+            // print initial reference particles to file
+            diagnostics::DiagnosticOutput(pc, m_ensemble,
+                                          diagnostics::OutputType::PrintRefParticle,
+                                          "diags/ref_particle_ensemble",
+                                          global_step);
+
+            // print the initial values of reduced beam characteristics
+            diagnostics::DiagnosticOutput(pc, m_ensemble,
+                                          diagnostics::OutputType::PrintReducedBeamCharacteristics,
+                                          "diags/reduced_beam_characteristics_ensemble");
+        }
 
-                        // transform from x,y,z to x',y',t
-                        transformation::CoordinateTransformation(*amr_data->m_particle_container,
-                                                                 CoordSystem::s);
+        // optional: in situ loss map of the particles of the first member, along its lattice
+        std::optional<diagnostics::LossMap> loss_map = make_loss_map(diag_enable);
+
+        // periods through the lattice
+        int periods = 1;
+        amrex::ParmParse("lattice").queryAdd("periods", periods);
+
+        // the element of each member at the current lattice position
+        std::vector<KnownElements *> element_variants(m_ensemble.size());
+
+        // the position s of the reference particle of each member, for lost particles
+        std::vector<amrex::ParticleReal> member_s(m_ensemble.size());
+        int const member_comp = pc.GetIntCompIndex(ensemble::member_attribute);
+
+        for (int cycle=0; cycle < periods; ++cycle) {
+            // iterate the lattices of all members together
+            std::vector<std::list<KnownElements>::iterator> it;
+            for (auto & member : m_ensemble) {
+                it.push_back(member.m_lattice.begin());
+            }
+
+            // loop over all beamline element positions
+            while (it.front() != m_ensemble.front().m_lattice.end()) {
+                for (std::size_t m = 0; m < m_ensemble.size(); ++m) {
+                    element_variants[m] = &(*it[m]);
+
+                    // update element edge of the reference particle
+                    m_ensemble[m].m_ref_part.sedge = m_ensemble[m].m_ref_part.s;
+                }
+
+                // number of slices of the element, the same for all members
+                int const nslice = std::visit([](auto &&element) {
+                    return element.nslice();
+                }, *element_variants.front());
+
+                for (int slice_step = 0; slice_step < nslice; ++slice_step) {
+                    BL_PROFILE("ImpactX::track_ensemble::slice_step");
+                    global_step++;
+                    if (verbose > 0) {
+                        amrex::Print() << " ++++ Starting global_step=" << global_step
+                                       << " slice_step=" << slice_step << "\n";
                     }
 
-                    // for later: original Impact implementation as an option
-                    // Redistribute particles in x',y',t
-                    //   TODO: only needed if we want to gather and push space charge
-                    //         in x',y',t
-                    //   TODO: change geometry beforehand according to transformation
-                    //m_particle_container->Redistribute();
-                    //
-                    // in original Impact, we gather and space-charge push in x',y',t ,
-                    // assuming that the distribution did not change
+                    // push the reference particles and all particles of all members
+                    ensemble::Push(pc, m_ensemble, element_variants);
 
-                    // push all particles with external maps
-                    Push(*amr_data->m_particle_container, element_variant, global_step);
+                    // diagnostics that are not ensemble-aware use the first member
+                    pc.SetRefParticle(m_ensemble.front().m_ref_part);
 
-                    // move "lost" particles to another particle container
-                    collect_lost_particles(*amr_data->m_particle_container);
+                    // move "lost" particles to another particle container,
+                    // at the position s of the reference particle of their member
+                    for (std::size_t m = 0; m < m_ensemble.size(); ++m) {
+                        member_s[m] = m_ensemble[m].m_ref_part.s;
+                    }
+                    LostParticles const lost = collect_lost_particles(pc, member_s, member_comp);
+                    if (loss_map) {
+                        auto const element_index = static_cast<int>(
+                            std::distance(m_ensemble.front().m_lattice.begin(), it.front()));
+                        add_to_loss_map(*loss_map, lost, cycle, element_index, *element_variants.front(),
+                                        m_ensemble.front().m_ref_part);
+                    }
 
                     // just prints an empty newline at the end of the slice_step
                     if (verbose > 0) {
@@ -278,45 +823,43 @@ namespace impactx {
                     pp_diag.queryAdd("slice_step_diagnostics", slice_step_diagnostics);
 
                     if (diag_enable && slice_step_diagnostics) {
-                        // print slice step reference particle to file
-                        diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+                        diagnostics::DiagnosticOutput(pc, m_ensemble,
                                                       diagnostics::OutputType::PrintRefParticle,
-                                                      "diags/ref_particle",
+                                                      "diags/ref_particle_ensemble",
                                                       global_step,
                                                       true);
 
-                        // print slice step reduced beam characteristics to file
-                        diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+                        diagnostics::DiagnosticOutput(pc, m_ensemble,
                                                       diagnostics::OutputType::PrintReducedBeamCharacteristics,
-                                                      "diags/reduced_beam_characteristics",
+                                                      "diags/reduced_beam_characteristics_ensemble",
                                                       global_step,
                                                       true);
-
                     }
 
                     // inputs: unused parameters (e.g. typos) check after step 1 has finished
                     if (!early_params_checked) { early_params_checked = early_param_check(); }
 
-                } // end in-element space-charge slice-step loop
+                } // end in-element slice-step loop
 
+                for (auto & member_it : it) { ++member_it; }
             } // end beamline element loop
         } // end periods though the lattice loop
 
         if (diag_enable)
         {
-            // print final reference particle to file
-            diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+            // print final reference particles to file
+            diagnostics::DiagnosticOutput(pc, m_ensemble,
                                           diagnostics::OutputType::PrintRefParticle,
-                                          "diags/ref_particle_final",
+                                          "diags/ref_particle_ensemble_final",
                                           global_step);
 
             // print the final values of the reduced beam characteristics
-            diagnostics::DiagnosticOutput(*amr_data->m_particle_container,
+            diagnostics::DiagnosticOutput(pc, m_ensemble,
                                           diagnostics::OutputType::PrintReducedBeamCharacteristics,
-                                          "diags/reduced_beam_characteristics_final",
+                                          "diags/reduced_beam_characteristics_ensemble_final",
                                           global_step);
 
-            // output particles lost in apertures
+            // output particles lost in apertures, with their ensemble member
             if (amr_data->m_particles_lost->TotalNumberOfParticles() > 0)
             {
                 std::string openpmd_backend = "default";
@@ -326,14 +869,23 @@ namespace impactx {
                 output_lost(*amr_data->m_particles_lost, 0);
                 output_lost.finalize();
             }
+
+            // where particles got lost
+            if (loss_map) { loss_map->write("diags/loss_map_ensemble"); }
+
+            // write all buffered diagnostics and close the files
+            diagnostics::close_diagnostics();
         }
 
-        // loop over all beamline elements & finalize them
-        for (auto & element_variant : m_lattice)
+        // loop over all beamline elements of all members & finalize them
+        for (auto & member : m_ensemble)
         {
-            std::visit([](auto&& element){
-                element.finalize();
-            }, element_variant);
+            for (auto & element_variant : member.m_lattice)
+            {
+                std::visit([](auto&& element){
+                    element.finalize();
+                }, element_variant);
+            }
         }
     }
 } // namespace impactx
@@ -197,5 +197,8 @@ namespace impactx::initialization
         m_rho.erase(lev);
         m_phi.erase(lev);
         m_space_charge_field.erase(lev);
+
+        // the solver references the grids and the previous phi
+        m_poisson_solver.reset();
     }
 } // namespace impactx::initialization
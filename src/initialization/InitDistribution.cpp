@@ -12,17 +12,23 @@
 #include "ImpactX.H"
 #include "particles/ImpactXParticleContainer.H"
 #include "particles/distribution/All.H"
+#include "particles/ensemble/Ensemble.H"
 
 #include <ablastr/constant.H>
 #include <ablastr/warn_manager/WarnManager.H>
 
 #include <AMReX.H>
 #include <AMReX_BLProfiler.H>
+#include <AMReX_GpuLaunch.H>
+#include <AMReX_ParallelDescriptor.H>
 #include <AMReX_REAL.H>
 #include <AMReX_ParmParse.H>
 #include <AMReX_Print.H>
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <list>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -32,11 +38,135 @@
 namespace impactx
 {
 
+namespace
+{
+    /** Generate particles from a distribution and add them to the particle container
+     *
+     * The particles are split evenly over a group of nranks MPI ranks,
+     * starting at first_rank. The group wraps around at the number of ranks.
+     * Ranks outside of the group do not generate particles.
+     *
+     * @param pc the particle container to add particles to
+     * @param ref the reference particle of the new particles
+     * @param bunch_charge bunch charge (C)
+     * @param distr distribution function to draw from (object)
+     * @param npart number of particles to draw
+     * @param first_rank first MPI rank of the group
+     * @param nranks number of MPI ranks in the group
+     * @param first_index global index of the first particle, keys the random numbers
+     */
+    void
+    generate_particles (
+        ImpactXParticleContainer & pc,
+        RefPart const & ref,
+        amrex::ParticleReal bunch_charge,
+        distribution::KnownDistributions distr,
+        amrex::Long npart,
+        int first_rank,
+        int nranks,
+        amrex::Long first_index
+    )
+    {
+        BL_PROFILE("impactx::generate_particles");
+
+        int const myproc = amrex::ParallelDescriptor::MyProc();
+        int const nprocs = amrex::ParallelDescriptor::NProcs();
+        int const rank_in_group = (myproc - first_rank % nprocs + nprocs) % nprocs;
+        amrex::Long const navg = npart / nranks;
+        amrex::Long const nleft = npart - navg * nranks;
+        amrex::Long npart_this_proc = (rank_in_group < nleft) ? navg+1 : navg;
+        if (rank_in_group >= nranks) { npart_this_proc = 0; }
+
+        // global index of the first particle of this rank: independent of the
+        // domain decomposition, so the beam is the same on any number of ranks
+        amrex::Long const first_index_this_proc = first_index
+            + rank_in_group * navg + std::min(amrex::Long(rank_in_group), nleft);
+
+        // random seed of the beam
+        amrex::Long seed = 0;
+        amrex::ParmParse("algo").queryAdd("rng_seed", seed);
+
+        // pseudo-random or quasi-random sampling
+        std::string sampling = "random";
+        amrex::ParmParse("algo").queryAdd("init_sampling", sampling);
+        if (sampling != "random" && sampling != "halton") {
+            throw std::runtime_error("generate_particles: algo.init_sampling must be random or halton but is: " + sampling);
+        }
+
+        // number of particles sampled per kernel launch (0: all at once); this limits
+        // the launch size only, the tile holds all particles of this rank from the start
+        amrex::Long chunk_size = 0;
+        amrex::ParmParse("algo").queryAdd("init_chunk_size", chunk_size);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(chunk_size >= 0,
+            "generate_particles: algo.init_chunk_size must not be negative.");
+        if (chunk_size == 0) { chunk_size = std::max(npart_this_proc, amrex::Long(1)); }
+
+        // append the new particles directly to the particle tile:
+        // the distribution writes into the tile, without temporary buffers
+        amrex::Long old_np = 0;
+        amrex::Long pid = 0;
+        auto & particle_tile = pc.ResizeAddParticleTile(npart_this_proc, old_np, pid);
+
+        auto & soa = particle_tile.GetStructOfArrays();
+        auto & soa_real = soa.GetRealData();
+        amrex::ParticleReal * const AMREX_RESTRICT x_ptr = soa_real[RealSoA::x].dataPtr() + old_np;
+        amrex::ParticleReal * const AMREX_RESTRICT y_ptr = soa_real[RealSoA::y].dataPtr() + old_np;
+        amrex::ParticleReal * const AMREX_RESTRICT t_ptr = soa_real[RealSoA::t].dataPtr() + old_np;
+        amrex::ParticleReal * const AMREX_RESTRICT px_ptr = soa_real[RealSoA::px].dataPtr() + old_np;
+        amrex::ParticleReal * const AMREX_RESTRICT py_ptr = soa_real[RealSoA::py].dataPtr() + old_np;
+        amrex::ParticleReal * const AMREX_RESTRICT pt_ptr = soa_real[RealSoA::pt].dataPtr() + old_np;
+        amrex::ParticleReal * const AMREX_RESTRICT qm_ptr = soa_real[RealSoA::qm].dataPtr() + old_np;
+        amrex::ParticleReal * const AMREX_RESTRICT w_ptr = soa_real[RealSoA::w].dataPtr() + old_np;
+        uint64_t * const AMREX_RESTRICT idcpu_ptr = soa.GetIdCPUData().dataPtr() + old_np;
+
+        amrex::ParticleReal const qm = ref.qm_ratio_SI();
+        amrex::ParticleReal const w = bunch_charge / ablastr::constant::SI::q_e / amrex::ParticleReal(npart);
+
+        std::visit([&](auto&& distribution){
+            // initialize distributions
+            distribution.initialize(bunch_charge, ref);
+
+            using Distribution = std::remove_reference_t< std::remove_cv_t<decltype(distribution)> >;
+
+            // the engine type is passed as a typed null pointer
+            auto const sample = [&](auto const * engine_tag)
+            {
+                using Engine = std::remove_cv_t< std::remove_pointer_t<decltype(engine_tag)> >;
+                auto const sequence = Engine::make_sequence(static_cast<uint64_t>(seed));
+
+                for (amrex::Long first = 0; first < npart_this_proc; first += chunk_size)
+                {
+                    amrex::Long const np_chunk = std::min(chunk_size, npart_this_proc - first);
+
+                    initialization::InitSingleParticleData<Distribution, Engine> const init_single_particle_data(
+                        distribution,
+                        x_ptr + first, y_ptr + first, t_ptr + first,
+                        px_ptr + first, py_ptr + first, pt_ptr + first,
+                        qm_ptr + first, w_ptr + first, idcpu_ptr + first,
+                        qm, w, pid + first, myproc,
+                        sequence, static_cast<uint64_t>(first_index_this_proc + first));
+                    amrex::ParallelFor(np_chunk, init_single_particle_data);
+                }
+            };
+
+            if (sampling == "halton") {
+                sample(static_cast<distribution::HaltonEngine const *>(nullptr));
+            } else {
+                sample(static_cast<distribution::PhiloxEngine const *>(nullptr));
+            }
+
+            // finalize distributions and deallocate temporary device global memory
+            amrex::Gpu::streamSynchronize();
+            distribution.finalize();
+        }, distr);
+    }
+} // namespace
+
     void
     ImpactX::add_particles (
         amrex::ParticleReal bunch_charge,
         distribution::KnownDistributions distr,
-        int npart
+        amrex::Long npart
     )
     {
         BL_PROFILE("ImpactX::add_particles");
@@ -48,6 +178,8 @@ namespace impactx
             "add_particles: Reference particle mass not yet set!");
         AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ref.kin_energy_MeV() != 0.0,
             "add_particles: Reference particle energy not yet set!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_ensemble.empty(),
+            "add_particles: particles cannot be mixed with ensemble members. Use add_ensemble_member instead.");
 
         AMREX_ALWAYS_ASSERT_WITH_MESSAGE(bunch_charge >= 0.0,
             "add_particles: the bunch charge should be positive. "
@@ -66,48 +198,9 @@ namespace impactx
         // position, per MPI rank. We then measure the distribution's spatial
         // extent, create a grid, resize it to fit the beam, and then
         // redistribute particles so that they reside on the correct MPI rank.
-        int const myproc = amrex::ParallelDescriptor::MyProc();
-        int const nprocs = amrex::ParallelDescriptor::NProcs();
-        int const navg = npart / nprocs;
-        int const nleft = npart - navg * nprocs;
-        int npart_this_proc = (myproc < nleft) ? navg+1 : navg;
-        auto const rel_part_this_proc =
-            amrex::ParticleReal(npart_this_proc) / amrex::ParticleReal(npart);
-
-        // alloc data for particle attributes
-        amrex::Gpu::DeviceVector<amrex::ParticleReal> x, y, t;
-        amrex::Gpu::DeviceVector<amrex::ParticleReal> px, py, pt;
-        x.resize(npart_this_proc);
-        y.resize(npart_this_proc);
-        t.resize(npart_this_proc);
-        px.resize(npart_this_proc);
-        py.resize(npart_this_proc);
-        pt.resize(npart_this_proc);
-
-        std::visit([&](auto&& distribution){
-            // initialize distributions
-            distribution.initialize(bunch_charge, ref);
-
-            amrex::ParticleReal * const AMREX_RESTRICT x_ptr = x.data();
-            amrex::ParticleReal * const AMREX_RESTRICT y_ptr = y.data();
-            amrex::ParticleReal * const AMREX_RESTRICT t_ptr = t.data();
-            amrex::ParticleReal * const AMREX_RESTRICT px_ptr = px.data();
-            amrex::ParticleReal * const AMREX_RESTRICT py_ptr = py.data();
-            amrex::ParticleReal * const AMREX_RESTRICT pt_ptr = pt.data();
-
-            using Distribution = std::remove_reference_t< std::remove_cv_t<decltype(distribution)> >;
-            initialization::InitSingleParticleData<Distribution> const init_single_particle_data(
-                distribution, x_ptr, y_ptr, t_ptr, px_ptr, py_ptr, pt_ptr);
-            amrex::ParallelForRNG(npart_this_proc, init_single_particle_data);
-
-            // finalize distributions and deallocate temporary device global memory
-            amrex::Gpu::streamSynchronize();
-            distribution.finalize();
-        }, distr);
-
-        amr_data->m_particle_container->AddNParticles(x, y, t, px, py, pt,
-                                                      ref.qm_ratio_SI(),
-                                            bunch_charge * rel_part_this_proc);
+        generate_particles(*amr_data->m_particle_container, ref, bunch_charge, distr, npart,
+                           0, amrex::ParallelDescriptor::NProcs(), m_num_generated_particles);
+        m_num_generated_particles += npart;
 
         bool space_charge = false;
         amrex::ParmParse pp_algo("algo");
@@ -124,6 +217,102 @@ namespace impactx
         }
     }
 
+    void
+    ImpactX::init_envelope (
+        amrex::ParticleReal bunch_charge,
+        distribution::KnownDistributions distr,
+        amrex::ParticleReal current
+    )
+    {
+        BL_PROFILE("ImpactX::init_envelope");
+
+        auto const & ref = amr_data->m_particle_container->GetRefParticle();
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ref.charge_qe() != 0.0,
+            "init_envelope: Reference particle charge not yet set!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ref.mass_MeV() != 0.0,
+            "init_envelope: Reference particle mass not yet set!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ref.kin_energy_MeV() != 0.0,
+            "init_envelope: Reference particle energy not yet set!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(bunch_charge >= 0.0,
+            "init_envelope: the bunch charge should be positive. "
+            "For negatively charged bunches, please change the reference particle's charge.");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(current >= 0.0,
+            "init_envelope: the beam current should be positive.");
+
+        m_envelope = envelope::create_envelope(distr, bunch_charge, current);
+    }
+
+    int
+    ImpactX::add_ensemble_member (
+        RefPart ref_part,
+        std::list<KnownElements> lattice,
+        amrex::ParticleReal bunch_charge,
+        distribution::KnownDistributions distr,
+        amrex::Long npart
+    )
+    {
+        BL_PROFILE("ImpactX::add_ensemble_member");
+
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ref_part.charge_qe() != 0.0,
+            "add_ensemble_member: Reference particle charge not yet set!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ref_part.mass_MeV() != 0.0,
+            "add_ensemble_member: Reference particle mass not yet set!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ref_part.kin_energy_MeV() != 0.0,
+            "add_ensemble_member: Reference particle energy not yet set!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(bunch_charge >= 0.0,
+            "add_ensemble_member: the bunch charge should be positive. "
+            "For negatively charged bunches, please change the reference particle's charge.");
+
+        auto & pc = *amr_data->m_particle_container;
+        int const member = static_cast<int>(m_ensemble.size());
+
+        if (member == 0)
+        {
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(pc.TotalNumberOfParticles() == 0,
+                "add_ensemble_member: ensemble members cannot be mixed with particles from add_particles.");
+
+            // the ensemble member is stored per particle, also for lost particles
+            if (!pc.HasIntComp(ensemble::member_attribute)) {
+                pc.AddIntComp(ensemble::member_attribute);
+                amr_data->m_particles_lost->AddIntComp(ensemble::member_attribute);
+            }
+
+            // diagnostics that are not ensemble-aware use the first member
+            pc.SetRefParticle(ref_part);
+        }
+
+        // the particles of each member are generated on a group of MPI ranks
+        int const nprocs = amrex::ParallelDescriptor::NProcs();
+        int ranks_per_member = nprocs;
+        amrex::ParmParse("algo").queryAdd("ensemble_ranks_per_member", ranks_per_member);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ranks_per_member >= 1 && ranks_per_member <= nprocs,
+            "add_ensemble_member: algo.ensemble_ranks_per_member must be between 1 and the number of MPI ranks.");
+        int const first_rank = (member * ranks_per_member) % nprocs;
+
+        // new particles are appended to this tile
+        auto & particle_tile = pc.DefineAndReturnAddParticleTile();
+        amrex::Long const old_np = particle_tile.numParticles();
+
+        generate_particles(pc, ref_part, bunch_charge, distr, npart, first_rank, ranks_per_member,
+                           m_num_generated_particles);
+        m_num_generated_particles += npart;
+
+        // tag the new particles with their ensemble member
+        amrex::Long const new_np = particle_tile.numParticles();
+        int * const AMREX_RESTRICT member_arr =
+            particle_tile.GetStructOfArrays().GetIntData(pc.GetIntCompIndex(ensemble::member_attribute)).dataPtr();
+        amrex::ParallelFor(new_np - old_np,
+        [=] AMREX_GPU_DEVICE (amrex::Long i) noexcept
+        {
+            member_arr[old_np + i] = member;
+        });
+        amrex::Gpu::streamSynchronize();
+
+        m_ensemble.push_back(ensemble::Member{ref_part, std::move(lattice), bunch_charge});
+
+        return member;
+    }
+
     void initialization::set_distribution_parameters_from_twiss_inputs (
         amrex::ParmParse const & pp_dist,
         amrex::ParticleReal& sigx, amrex::ParticleReal& sigy, amrex::ParticleReal& sigt,
@@ -219,9 +408,6 @@ namespace impactx
         amrex::ParticleReal kin_energy = 0.0;  // Beam kinetic energy (MeV)
         pp_dist.get("kin_energy", kin_energy);
 
-        amrex::ParticleReal bunch_charge = 0.0;  // Bunch charge (C)
-        pp_dist.get("charge", bunch_charge);
-
         std::string particle_type;  // Particle type
         pp_dist.get("particle", particle_type);
 
@@ -251,8 +437,29 @@ namespace impactx
         amr_data->m_particle_container->GetRefParticle()
                 .set_charge_qe(qe).set_mass_MeV(massE).set_kin_energy_MeV(kin_energy);
 
-        int npart = 1;  // Number of simulation particles
-        pp_dist.get("npart", npart);
+        // track particles (default), the beam envelope or a dynamic aperture scan
+        std::string track = "particles";
+        amrex::ParmParse("algo").queryAdd("track", track);
+
+        // dynamic aperture scans generate their own probe particles
+        if (track == "dynamic_aperture") {
+            amrex::Print() << "Beam kinetic energy (MeV): " << kin_energy << std::endl;
+            amrex::Print() << "Particle type: " << particle_type << std::endl;
+            amrex::Print() << "Dynamic aperture scan" << std::endl;
+            return;
+        }
+
+        std::string distribution_type;  // Beam distribution type
+        pp_dist.get("distribution", distribution_type);
+
+        amrex::ParticleReal bunch_charge = 0.0;  // Bunch charge (C)
+        if (distribution_type == "openpmd") {
+            // optional: by default, keep the particle weights of the file
+            bunch_charge = -1.0;
+            pp_dist.query("charge", bunch_charge);
+        } else {
+            pp_dist.get("charge", bunch_charge);
+        }
 
         std::string unit_type;  // System of units
         pp_dist.get("units", unit_type);
@@ -262,8 +469,7 @@ namespace impactx
                 "gaussian", "kurth4d", "kurth6d", "kvdist", "semigaussian", "triangle", "waterbag"
         };
 
-        std::string distribution_type;  // Beam distribution type
-        pp_dist.get("distribution", distribution_type);
+        distribution::KnownDistributions distr;
 
         std::string base_dist_type = distribution_type;
         // Position of the underscore for splitting off the suffix in case the distribution name either ends in "_from_twiss"
@@ -302,54 +508,40 @@ namespace impactx
             }
 
             if(base_dist_type == "waterbag"){
-                distribution::KnownDistributions const waterbag(distribution::Waterbag(
+                distr = distribution::Waterbag(
                         sigx, sigy, sigt,
                         sigpx, sigpy, sigpt,
-                        muxpx, muypy, mutpt));
-
-                add_particles(bunch_charge, waterbag, npart);
+                        muxpx, muypy, mutpt);
             } else if (base_dist_type == "kurth6d") {
-                distribution::KnownDistributions const kurth6D(distribution::Kurth6D(
+                distr = distribution::Kurth6D(
                         sigx, sigy, sigt,
                         sigpx, sigpy, sigpt,
-                        muxpx, muypy, mutpt));
-
-                add_particles(bunch_charge, kurth6D, npart);
+                        muxpx, muypy, mutpt);
             } else if (base_dist_type == "gaussian") {
-                distribution::KnownDistributions const gaussian(distribution::Gaussian(
+                distr = distribution::Gaussian(
                         sigx, sigy, sigt,
                         sigpx, sigpy, sigpt,
-                        muxpx, muypy, mutpt));
-
-                add_particles(bunch_charge, gaussian, npart);
+                        muxpx, muypy, mutpt);
             } else if (base_dist_type == "kvdist") {
-                distribution::KnownDistributions const kvDist(distribution::KVdist(
+                distr = distribution::KVdist(
                         sigx, sigy, sigt,
                         sigpx, sigpy, sigpt,
-                        muxpx, muypy, mutpt));
-
-                add_particles(bunch_charge, kvDist, npart);
+                        muxpx, muypy, mutpt);
             } else if (base_dist_type == "kurth4d") {
-                distribution::KnownDistributions const kurth4D(distribution::Kurth4D(
+                distr = distribution::Kurth4D(
                         sigx, sigy, sigt,
                         sigpx, sigpy, sigpt,
-                        muxpx, muypy, mutpt));
-
-                add_particles(bunch_charge, kurth4D, npart);
+                        muxpx, muypy, mutpt);
             } else if (base_dist_type == "semigaussian") {
-                distribution::KnownDistributions const semigaussian(distribution::Semigaussian(
+                distr = distribution::Semigaussian(
                         sigx, sigy, sigt,
                         sigpx, sigpy, sigpt,
-                        muxpx, muypy, mutpt));
-
-                add_particles(bunch_charge, semigaussian, npart);
+                        muxpx, muypy, mutpt);
             } else if (base_dist_type == "triangle") {
-                distribution::KnownDistributions const triangle(distribution::Triangle(
+                distr = distribution::Triangle(
                         sigx, sigy, sigt,
                         sigpx, sigpy, sigpt,
-                        muxpx, muypy, mutpt));
-
-                add_particles(bunch_charge, triangle, npart);
+                        muxpx, muypy, mutpt);
             } else {
                 throw std::runtime_error("Unknown distribution: " + distribution_type);
             }
@@ -366,18 +558,50 @@ namespace impactx
             pp_dist.query("normalize_halo", normalize_halo);
             pp_dist.query("halo", halo);
 
-            distribution::KnownDistributions thermal(distribution::Thermal(k, kT, kT_halo, normalize, normalize_halo, halo));
-
-            add_particles(bunch_charge, thermal, npart);
+            distr = distribution::Thermal(k, kT, kT_halo, normalize, normalize_halo, halo);
+        } else if (distribution_type == "openpmd") {
+            // particles are read from a file below, instead of being sampled
         } else {
             throw std::runtime_error("Unknown distribution: " + distribution_type);
         }
 
+        amrex::Long npart = 1;  // Number of simulation particles
+        if (distribution_type == "openpmd") {
+            if (track == "envelope") {
+                throw std::runtime_error("beam.distribution = openpmd is not supported with algo.track = envelope.");
+            }
+
+            std::string filepath;
+            pp_dist.get("openpmd_path", filepath);
+            std::string species_name = "beam";
+            pp_dist.query("openpmd_species", species_name);
+            int iteration = -1;
+            pp_dist.query("openpmd_iteration", iteration);
+
+            add_particles_from_openpmd(filepath, species_name, iteration, bunch_charge);
+            npart = amr_data->m_particle_container->TotalNumberOfParticles();
+        } else if (track == "envelope") {
+            amrex::ParticleReal current = 0.0;  // Beam current (A), for envelope space charge
+            pp_dist.query("current", current);
+
+            init_envelope(bunch_charge, distr, current);
+        } else {
+            pp_dist.get("npart", npart);
+
+            add_particles(bunch_charge, distr, npart);
+        }
+
         // print information on the initialized beam
         amrex::Print() << "Beam kinetic energy (MeV): " << kin_energy << std::endl;
-        amrex::Print() << "Bunch charge (C): " << bunch_charge << std::endl;
+        if (bunch_charge >= 0.0) {
+            amrex::Print() << "Bunch charge (C): " << bunch_charge << std::endl;
+        }
         amrex::Print() << "Particle type: " << particle_type << std::endl;
-        amrex::Print() << "Number of particles: " << npart << std::endl;
+        if (track == "envelope") {
+            amrex::Print() << "Envelope tracking" << std::endl;
+        } else {
+            amrex::Print() << "Number of particles: " << npart << std::endl;
+        }
         amrex::Print() << "Beam distribution type: " << distribution_type << std::endl;
 
         if (unit_type == "static") {
@@ -389,6 +613,8 @@ namespace impactx
         }
 
         amrex::Print() << "Initialized beam distribution parameters" << std::endl;
-        amrex::Print() << "# of particles: " << amr_data->m_particle_container->TotalNumberOfParticles() << std::endl;
+        if (track != "envelope") {
+            amrex::Print() << "# of particles: " << amr_data->m_particle_container->TotalNumberOfParticles() << std::endl;
+        }
     }
 } // namespace impactx
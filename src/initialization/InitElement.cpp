@@ -17,6 +17,7 @@
 #include <AMReX_Print.H>
 
 #include <algorithm>
+#include <array>
 #include <map>
 #include <string>
 #include <utility>
@@ -93,6 +94,50 @@ namespace detail
 
         return values;
     }
+
+    /** Read a math expression, which can contain spaces
+     *
+     * @param pp_element the element being read
+     * @param name key name
+     * @param expression the default expression, replaced if the key exists
+     */
+    void
+    query_expression (amrex::ParmParse& pp_element, const char* name, std::string & expression)
+    {
+        std::vector<std::string> tokens;
+        if (pp_element.queryarr(name, tokens)) {
+            expression.clear();
+            for (auto const & token : tokens) {
+                expression += token + " ";
+            }
+        } else {
+            pp_element.add(name, expression);
+        }
+    }
+
+    /** Read named parameters of an element
+     *
+     * @tparam T type of the parameter values
+     * @param pp_element the element being read
+     * @return the values of the element parameters parameter_names and parameter_values by name
+     */
+    template<typename T>
+    std::map<std::string, T>
+    query_parameters (amrex::ParmParse& pp_element)
+    {
+        std::vector<std::string> names;
+        std::vector<T> values;
+        pp_element.queryarr("parameter_names", names);
+        pp_element.queryarr("parameter_values", values);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(names.size() == values.size(),
+                                         pp_element.getPrefix() + ".parameter_names and .parameter_values must have the same length.");
+
+        std::map<std::string, T> parameters;
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            parameters[names[i]] = values[i];
+        }
+        return parameters;
+    }
 } // namespace detail
 
     /** Read a lattice element
@@ -218,6 +263,7 @@ namespace detail
 
             amrex::ParticleReal escale, freq, phase;
             int mapsteps = mapsteps_default;
+            amrex::ParticleReal map_tolerance = 0.0;
             RF_field_data const ez;
             std::vector<amrex::ParticleReal> cos_coef = ez.default_cos_coef;
             std::vector<amrex::ParticleReal> sin_coef = ez.default_sin_coef;
@@ -225,10 +271,11 @@ namespace detail
             pp_element.get("freq", freq);
             pp_element.get("phase", phase);
             pp_element.queryAdd("mapsteps", mapsteps);
+            pp_element.queryAdd("map_tolerance", map_tolerance);
             detail::queryAddResize(pp_element, "cos_coefficients", cos_coef);
             detail::queryAddResize(pp_element, "sin_coefficients", sin_coef);
 
-            m_lattice.emplace_back( RFCavity(ds, escale, freq, phase, cos_coef, sin_coef, a["dx"], a["dy"], a["rotation_degree"], mapsteps, nslice) );
+            m_lattice.emplace_back( RFCavity(ds, escale, freq, phase, cos_coef, sin_coef, a["dx"], a["dy"], a["rotation_degree"], mapsteps, nslice, map_tolerance) );
         } else if (element_type == "solenoid")
         {
             auto const [ds, nslice] = detail::query_ds(pp_element, nslice_default);
@@ -252,6 +299,7 @@ namespace detail
 
             amrex::ParticleReal bscale;
             int mapsteps = mapsteps_default;
+            amrex::ParticleReal map_tolerance = 0.0;
             int units = 0;
             Sol_field_data const bz;
             std::vector<amrex::ParticleReal> cos_coef = bz.default_cos_coef;
@@ -259,10 +307,11 @@ namespace detail
             pp_element.get("bscale", bscale);
             pp_element.queryAdd("units", units);
             pp_element.queryAdd("mapsteps", mapsteps);
+            pp_element.queryAdd("map_tolerance", map_tolerance);
             detail::queryAddResize(pp_element, "cos_coefficients", cos_coef);
             detail::queryAddResize(pp_element, "sin_coefficients", sin_coef);
 
-            m_lattice.emplace_back( SoftSolenoid(ds, bscale, cos_coef, sin_coef, units, a["dx"], a["dy"], a["rotation_degree"], mapsteps, nslice) );
+            m_lattice.emplace_back( SoftSolenoid(ds, bscale, cos_coef, sin_coef, units, a["dx"], a["dy"], a["rotation_degree"], mapsteps, nslice, map_tolerance) );
         } else if (element_type == "quadrupole_softedge")
         {
             auto const [ds, nslice] = detail::query_ds(pp_element, nslice_default);
@@ -270,15 +319,17 @@ namespace detail
 
             amrex::ParticleReal gscale;
             int mapsteps = mapsteps_default;
+            amrex::ParticleReal map_tolerance = 0.0;
             Quad_field_data const gz;
             std::vector<amrex::ParticleReal> cos_coef = gz.default_cos_coef;
             std::vector<amrex::ParticleReal> sin_coef = gz.default_sin_coef;
             pp_element.get("gscale", gscale);
             pp_element.queryAdd("mapsteps", mapsteps);
+            pp_element.queryAdd("map_tolerance", map_tolerance);
             detail::queryAddResize(pp_element, "cos_coefficients", cos_coef);
             detail::queryAddResize(pp_element, "sin_coefficients", sin_coef);
 
-            m_lattice.emplace_back( SoftQuadrupole(ds, gscale, cos_coef, sin_coef, a["dx"], a["dy"], a["rotation_degree"], mapsteps, nslice) );
+            m_lattice.emplace_back( SoftQuadrupole(ds, gscale, cos_coef, sin_coef, a["dx"], a["dy"], a["rotation_degree"], mapsteps, nslice, map_tolerance) );
         } else if (element_type == "drift_chromatic")
         {
             auto const [ds, nslice] = detail::query_ds(pp_element, nslice_default);
@@ -325,6 +376,31 @@ namespace detail
             auto a = detail::query_alignment(pp_element);
 
             m_lattice.emplace_back( ExactDrift(ds, a["dx"], a["dy"], a["rotation_degree"], nslice) );
+        } else if (element_type == "expression_map")
+        {
+            auto const [ds, nslice] = detail::query_ds(pp_element, nslice_default);
+            auto a = detail::query_alignment(pp_element);
+
+            std::array<std::string, 6> expressions = {"x", "y", "t", "px", "py", "pt"};
+            for (auto & expression : expressions) {
+                std::string const name = expression;
+                detail::query_expression(pp_element, name.c_str(), expression);
+            }
+
+            auto const parameters = detail::query_parameters<amrex::ParticleReal>(pp_element);
+
+            m_lattice.emplace_back( ExpressionMap(ds, expressions, parameters, a["dx"], a["dy"], a["rotation_degree"], nslice) );
+        } else if (element_type == "plugin")
+        {
+            auto const [ds, nslice] = detail::query_ds(pp_element, nslice_default);
+
+            std::string library;
+            pp_element.get("library", library);
+            std::string plugin_element;
+            pp_element.queryAdd("element", plugin_element);
+            auto const parameters = detail::query_parameters<double>(pp_element);
+
+            m_lattice.emplace_back( Plugin(library, plugin_element, ds, parameters, nslice) );
         } else if (element_type == "sbend_exact")
         {
             auto const [ds, nslice] = detail::query_ds(pp_element, nslice_default);
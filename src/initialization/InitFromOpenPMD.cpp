@@ -0,0 +1,365 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "ImpactX.H"
+#include "particles/ImpactXParticleContainer.H"
+#include "particles/elements/diagnostics/AsyncIO.H"
+
+#include <ablastr/constant.H>
+
+#include <AMReX.H>
+#include <AMReX_Array.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_GpuContainers.H>
+#include <AMReX_GpuLaunch.H>
+#include <AMReX_Particle.H>  // for SetParticleIDandCPU
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_ParallelReduce.H>
+#include <AMReX_ParmParse.H>
+#include <AMReX_Print.H>
+#include <AMReX_REAL.H>
+#include <AMReX_Reduce.H>
+
+#ifdef ImpactX_USE_OPENPMD
+#   include <openPMD/openPMD.hpp>
+namespace io = openPMD;
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace impactx
+{
+#ifdef ImpactX_USE_OPENPMD
+namespace
+{
+    /** Load slices of openPMD record components as amrex::ParticleReal
+     *
+     * Components that are stored as amrex::ParticleReal are read directly
+     * into the destination. Other floating point types are read into a
+     * temporary buffer and converted after the flush.
+     */
+    class ChunkLoader
+    {
+      public:
+        /** Schedule loading a slice of a record component
+         *
+         * @param rc the record component
+         * @param offset first particle of the slice
+         * @param extent number of particles in the slice
+         * @param dst host destination, valid until flush()
+         */
+        void
+        load (io::RecordComponent rc, uint64_t offset, uint64_t extent, amrex::ParticleReal * dst)
+        {
+            if (extent == 0u) { return; }
+
+            io::Datatype const dtype = rc.getDatatype();
+            if (dtype == io::determineDatatype<amrex::ParticleReal>()) {
+                rc.loadChunkRaw(dst, {offset}, {extent});
+            } else if (dtype == io::Datatype::DOUBLE) {
+                convert_after_flush(rc.loadChunk<double>({offset}, {extent}), extent, dst);
+            } else if (dtype == io::Datatype::FLOAT) {
+                convert_after_flush(rc.loadChunk<float>({offset}, {extent}), extent, dst);
+            } else {
+                throw std::runtime_error("add_particles_from_openpmd: only float and double particle data are supported.");
+            }
+        }
+
+        /** Read all scheduled slices */
+        void
+        flush (io::Series & series)
+        {
+            series.flush();
+            for (auto const & convert : m_convert) { convert(); }
+            m_convert.clear();
+        }
+
+      private:
+        template<typename T>
+        void
+        convert_after_flush (std::shared_ptr<T> data, uint64_t extent, amrex::ParticleReal * dst)
+        {
+            m_convert.emplace_back([data, extent, dst]() {
+                std::transform(data.get(), data.get() + extent, dst,
+                               [](T v) { return static_cast<amrex::ParticleReal>(v); });
+            });
+        }
+
+        std::vector<std::function<void()>> m_convert; ///< type conversions after the next flush
+    };
+
+    /** Read a reference particle attribute of the species, if present */
+    amrex::ParticleReal
+    ref_attribute (io::ParticleSpecies const & species, std::string const & name, amrex::ParticleReal fallback)
+    {
+        if (!species.containsAttribute(name)) { return fallback; }
+        return static_cast<amrex::ParticleReal>(species.getAttribute(name).get<double>());
+    }
+} // namespace
+#endif // ImpactX_USE_OPENPMD
+
+    void
+    ImpactX::add_particles_from_openpmd (
+        std::string const & filepath,
+        std::string const & species_name,
+        int iteration,
+        amrex::ParticleReal bunch_charge
+    )
+    {
+        BL_PROFILE("ImpactX::add_particles_from_openpmd");
+
+        auto & pc = *amr_data->m_particle_container;
+        auto const & ref = pc.GetRefParticle();
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ref.charge_qe() != 0.0,
+            "add_particles_from_openpmd: Reference particle charge not yet set!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ref.mass_MeV() != 0.0,
+            "add_particles_from_openpmd: Reference particle mass not yet set!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(ref.kin_energy_MeV() != 0.0,
+            "add_particles_from_openpmd: Reference particle energy not yet set!");
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(m_ensemble.empty(),
+            "add_particles_from_openpmd: particles cannot be mixed with ensemble members.");
+
+#ifdef ImpactX_USE_OPENPMD
+        using namespace amrex::literals; // for _rt and _prt
+
+        // openPMD calls are not thread-safe: wait for the I/O thread of the BeamMonitors
+        diagnostics::async_io::drain();
+
+        auto series = io::Series(filepath, io::Access::READ_ONLY
+#   if openPMD_HAVE_MPI==1
+            , amrex::ParallelDescriptor::Communicator()
+#   endif
+        );
+
+        // default: the last iteration in the series
+        if (iteration < 0) {
+            if (series.iterations.empty()) {
+                throw std::runtime_error("add_particles_from_openpmd: no iterations in " + filepath);
+            }
+            iteration = static_cast<int>(series.iterations.rbegin()->first);
+        }
+        if (series.iterations.count(iteration) == 0u) {
+            throw std::runtime_error("add_particles_from_openpmd: iteration " + std::to_string(iteration) +
+                                     " not found in " + filepath);
+        }
+        io::Iteration it = series.iterations[iteration];
+        if (it.particles.count(species_name) == 0u) {
+            throw std::runtime_error("add_particles_from_openpmd: particle species " + species_name +
+                                     " not found in " + filepath);
+        }
+        io::ParticleSpecies species = it.particles[species_name];
+
+        // records as written by the BeamMonitor: positions and momenta relative to the reference particle
+        std::array<std::string, 6> const position_momentum = {"position", "position", "position", "momentum", "momentum", "momentum"};
+        std::array<std::string, 6> const xyt = {"x", "y", "t", "x", "y", "t"};
+        for (int c = 0; c < 6; ++c) {
+            if (species.count(position_momentum[c]) == 0u || species[position_momentum[c]].count(xyt[c]) == 0u) {
+                throw std::runtime_error("add_particles_from_openpmd: missing record " +
+                                         position_momentum[c] + "/" + xyt[c] + " in " + filepath);
+            }
+        }
+        bool const has_qm = species.count("qm") != 0u;
+        bool const has_w = species.count("weighting") != 0u;
+        bool const has_offset = species.count("positionOffset") != 0u;
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(has_w || bunch_charge >= 0.0_prt,
+            "add_particles_from_openpmd: the file has no weighting, so the bunch charge must be set.");
+
+        // record components in the order of the particle container, then the position offsets
+        constexpr int ncomps = 11;
+        std::array<std::optional<io::RecordComponent>, ncomps> rcs;
+        for (int c = 0; c < 6; ++c) { rcs[c] = species[position_momentum[c]][xyt[c]]; }
+        if (has_qm) { rcs[RealSoA::qm] = species["qm"][io::RecordComponent::SCALAR]; }
+        if (has_w) { rcs[RealSoA::w] = species["weighting"][io::RecordComponent::SCALAR]; }
+        if (has_offset) {
+            for (int c = 0; c < 3; ++c) { rcs[8 + c] = species["positionOffset"][xyt[c]]; }
+        }
+
+        // split the particles of the file into contiguous slices, one per MPI rank
+        auto const npart = static_cast<amrex::Long>(rcs[RealSoA::x]->getExtent().at(0));
+        int const myproc = amrex::ParallelDescriptor::MyProc();
+        int const nprocs = amrex::ParallelDescriptor::NProcs();
+        amrex::Long const navg = npart / nprocs;
+        amrex::Long const nleft = npart - navg * nprocs;
+        amrex::Long const npart_this_proc = (myproc < nleft) ? navg+1 : navg;
+        amrex::Long const offset_this_proc = myproc * navg + std::min(amrex::Long(myproc), nleft);
+
+        // number of particles read per flush (0: all at once)
+        amrex::Long chunk_size = 0;
+        amrex::ParmParse("algo").queryAdd("init_chunk_size", chunk_size);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(chunk_size >= 0,
+            "add_particles_from_openpmd: algo.init_chunk_size must not be negative.");
+        if (chunk_size == 0) { chunk_size = std::max(npart_this_proc, amrex::Long(1)); }
+        chunk_size = std::min(chunk_size, std::max(npart_this_proc, amrex::Long(1)));
+
+        // conversion from the reference particle of the file to the one of the simulation
+        //   momenta are normalized by the reference momentum, pt by the reference momentum times c
+        amrex::ParticleReal const bg = ref.beta_gamma();
+        amrex::ParticleReal const bg_file = ref_attribute(species, "beta_gamma_ref", bg);
+        amrex::ParticleReal const gamma_file = ref_attribute(species, "gamma_ref", ref.gamma());
+        amrex::ParticleReal const mass_ratio = ref_attribute(species, "mass_ref", ref.mass) / ref.mass;
+        amrex::ParticleReal const p_scale = mass_ratio * bg_file / bg;
+        amrex::ParticleReal const pt_shift = (ref.gamma() - mass_ratio * gamma_file) / bg;
+        amrex::ParticleReal const ref_x = ref.x;
+        amrex::ParticleReal const ref_y = ref.y;
+        amrex::ParticleReal const ref_t = ref.t;
+
+        amrex::GpuArray<amrex::ParticleReal, ncomps> unit_si;
+        for (int c = 0; c < ncomps; ++c) {
+            unit_si[c] = rcs[c].has_value() ? static_cast<amrex::ParticleReal>(rcs[c]->unitSI()) : 1.0_prt;
+        }
+
+        amrex::ParticleReal const qm_ref = ref.qm_ratio_SI();
+        amrex::ParticleReal const w_ref = (bunch_charge >= 0.0_prt && npart > 0)
+            ? bunch_charge / ablastr::constant::SI::q_e / amrex::ParticleReal(npart) : 0.0_prt;
+
+        // append the new particles directly to the particle tile
+        amrex::Long old_np = 0;
+        amrex::Long pid = 0;
+        auto & particle_tile = pc.ResizeAddParticleTile(npart_this_proc, old_np, pid);
+        auto & soa = particle_tile.GetStructOfArrays();
+        auto & soa_real = soa.GetRealData();
+        uint64_t * const AMREX_RESTRICT idcpu_ptr = soa.GetIdCPUData().dataPtr() + old_np;
+
+        // position offsets of the current chunk
+        amrex::Gpu::DeviceVector<amrex::ParticleReal> offset_x(has_offset ? chunk_size : 0);
+        amrex::Gpu::DeviceVector<amrex::ParticleReal> offset_y(has_offset ? chunk_size : 0);
+        amrex::Gpu::DeviceVector<amrex::ParticleReal> offset_t(has_offset ? chunk_size : 0);
+
+        std::array<amrex::ParticleReal*, ncomps> dst;
+        for (int c = 0; c < RealSoA::nattribs; ++c) { dst[c] = soa_real[c].dataPtr() + old_np; }
+        dst[8] = offset_x.dataPtr();
+        dst[9] = offset_y.dataPtr();
+        dst[10] = offset_t.dataPtr();
+
+#ifdef AMREX_USE_GPU
+        // staging buffers for the host-to-device copy
+        std::array<amrex::Gpu::PinnedVector<amrex::ParticleReal>, ncomps> staging;
+        for (int c = 0; c < ncomps; ++c) {
+            if (rcs[c].has_value()) { staging[c].resize(chunk_size); }
+        }
+#endif
+
+        ChunkLoader loader;
+        for (amrex::Long first = 0; first < npart_this_proc; first += chunk_size)
+        {
+            amrex::Long const np_chunk = std::min(chunk_size, npart_this_proc - first);
+
+            // the particle attributes are read straight into the tile, the offsets into a chunk buffer
+            auto const chunk_dst = [&](int c) {
+                return c < RealSoA::nattribs ? dst[c] + first : dst[c];
+            };
+
+            for (int c = 0; c < ncomps; ++c) {
+                if (!rcs[c].has_value()) { continue; }
+#ifdef AMREX_USE_GPU
+                amrex::ParticleReal * const read_dst = staging[c].dataPtr();
+#else
+                amrex::ParticleReal * const read_dst = chunk_dst(c);
+#endif
+                loader.load(*rcs[c], uint64_t(offset_this_proc + first), uint64_t(np_chunk), read_dst);
+            }
+            loader.flush(series);
+
+#ifdef AMREX_USE_GPU
+            for (int c = 0; c < ncomps; ++c) {
+                if (!rcs[c].has_value()) { continue; }
+                amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice,
+                                      staging[c].begin(), staging[c].begin() + np_chunk,
+                                      chunk_dst(c));
+            }
+#endif
+
+            // convert units and the reference frame on the device
+            amrex::ParticleReal * const AMREX_RESTRICT x = chunk_dst(RealSoA::x);
+            amrex::ParticleReal * const AMREX_RESTRICT y = chunk_dst(RealSoA::y);
+            amrex::ParticleReal * const AMREX_RESTRICT t = chunk_dst(RealSoA::t);
+            amrex::ParticleReal * const AMREX_RESTRICT px = chunk_dst(RealSoA::px);
+            amrex::ParticleReal * const AMREX_RESTRICT py = chunk_dst(RealSoA::py);
+            amrex::ParticleReal * const AMREX_RESTRICT pt = chunk_dst(RealSoA::pt);
+            amrex::ParticleReal * const AMREX_RESTRICT qm = chunk_dst(RealSoA::qm);
+            amrex::ParticleReal * const AMREX_RESTRICT w = chunk_dst(RealSoA::w);
+            amrex::ParticleReal const * const AMREX_RESTRICT ox = chunk_dst(8);
+            amrex::ParticleReal const * const AMREX_RESTRICT oy = chunk_dst(9);
+            amrex::ParticleReal const * const AMREX_RESTRICT ot = chunk_dst(10);
+            uint64_t * const AMREX_RESTRICT idcpu = idcpu_ptr + first;
+            amrex::Long const pid_chunk = pid + first;
+            auto const u = unit_si;
+
+            amrex::ParallelFor(np_chunk, [=] AMREX_GPU_DEVICE (amrex::Long i) noexcept
+            {
+                // positions: global position = position + positionOffset
+                x[i] *= u[RealSoA::x];
+                y[i] *= u[RealSoA::y];
+                t[i] *= u[RealSoA::t];
+                if (has_offset) {
+                    x[i] += ox[i] * u[8] - ref_x;
+                    y[i] += oy[i] * u[9] - ref_y;
+                    t[i] += ot[i] * u[10] - ref_t;
+                }
+
+                // momenta: normalize by the reference momentum of the simulation
+                px[i] *= u[RealSoA::px] * p_scale;
+                py[i] *= u[RealSoA::py] * p_scale;
+                pt[i] = pt[i] * u[RealSoA::pt] * p_scale + pt_shift;
+
+                qm[i] = has_qm ? qm[i] * u[RealSoA::qm] : qm_ref;
+                w[i] = has_w ? w[i] * u[RealSoA::w] : w_ref;
+                idcpu[i] = amrex::SetParticleIDandCPU(pid_chunk + i, myproc);
+            });
+            amrex::Gpu::streamSynchronize();
+        }
+
+        series.close();
+
+        // optional: rescale the weights of the file to the bunch charge
+        if (has_w && bunch_charge >= 0.0_prt)
+        {
+            amrex::ParticleReal * const AMREX_RESTRICT w = dst[RealSoA::w];
+            amrex::ParticleReal w_sum = amrex::Reduce::Sum<amrex::ParticleReal>(npart_this_proc,
+                [=] AMREX_GPU_DEVICE (amrex::Long i) noexcept { return w[i]; });
+            amrex::ParallelAllReduce::Sum(w_sum, amrex::ParallelDescriptor::Communicator());
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(w_sum > 0.0_prt,
+                "add_particles_from_openpmd: the weights in the file must have a positive sum to set a bunch charge.");
+
+            amrex::ParticleReal const w_scale = bunch_charge / ablastr::constant::SI::q_e / w_sum;
+            amrex::ParallelFor(npart_this_proc, [=] AMREX_GPU_DEVICE (amrex::Long i) noexcept
+            {
+                w[i] *= w_scale;
+            });
+            amrex::Gpu::streamSynchronize();
+        }
+
+        amrex::Print() << "Read " << npart << " particles from " << filepath
+                       << " (iteration " << iteration << ", species " << species_name << ")" << std::endl;
+
+        bool space_charge = false;
+        amrex::ParmParse pp_algo("algo");
+        pp_algo.queryAdd("space_charge", space_charge);
+
+        // see add_particles: the particles are split equally on all MPI ranks
+        // and are only redistributed spatially for space charge
+        if (space_charge) {
+            this->ResizeMesh();
+            pc.Redistribute();
+        }
+#else
+        amrex::ignore_unused(filepath, species_name, iteration, bunch_charge);
+        throw std::runtime_error("add_particles_from_openpmd: ImpactX was not compiled with openPMD support (ImpactX_OPENPMD=ON).");
+#endif // ImpactX_USE_OPENPMD
+    }
+} // namespace impactx
@@ -12,8 +12,10 @@
 #include <AMReX.H>
 #include <AMReX_BLProfiler.H>
 #include <AMReX_INT.H>
+#include <AMReX_ParmParse.H>
 
 #include <stdexcept>
+#include <string>
 
 
 namespace impactx
@@ -27,10 +29,26 @@ namespace impactx
         if (ref.kin_energy_MeV() == 0.0)
             throw std::runtime_error("The reference particle energy is zero. Not yet initialized?");
 
-        // particles in the beam bunch
-        // count particles - if no particles are found in our particle container, then a lot of
-        // AMReX routines over ParIter won't work, and we have nothing to do here anyway
+        std::string track = "particles";
+        amrex::ParmParse("algo").queryAdd("track", track);
+
+        if (track == "envelope")
+        {
+            // beam envelope
+            if (!m_envelope.has_value())
+                throw std::runtime_error("No beam envelope found. Cannot run evolve with algo.track = envelope without a beam envelope.");
+        }
+        else if (track == "dynamic_aperture")
         {
+            // the probes are generated from the da.* parameters
+            if (amr_data->m_particle_container->TotalNumberOfParticles() > 0)
+                throw std::runtime_error("algo.track = dynamic_aperture generates its own probe particles. Do not add beam particles.");
+        }
+        else
+        {
+            // particles in the beam bunch
+            // count particles - if no particles are found in our particle container, then a lot of
+            // AMReX routines over ParIter won't work, and we have nothing to do here anyway
             int const nLevelPC = amr_data->finestLevel();
             amrex::Long nParticles = 0;
             for (int lev = 0; lev <= nLevelPC; ++lev) {
@@ -42,6 +60,27 @@ namespace impactx
                 throw std::runtime_error("Only one particle found. This is not yet supported: https://github.com/ECP-WarpX/impactx/issues/44");
         }
 
+        // ensemble of lattice variants
+        if (!m_ensemble.empty())
+        {
+            if (track != "particles")
+                throw std::runtime_error("Ensemble simulations are only supported with algo.track = particles.");
+
+            amrex::ParmParse const pp_algo("algo");
+            bool space_charge = false;
+            pp_algo.query("space_charge", space_charge);
+            bool csr = false;
+            pp_algo.query("csr", csr);
+            if (space_charge || csr)
+                throw std::runtime_error("Ensemble simulations do not yet support space charge or CSR.");
+
+            ensemble::validate(m_ensemble);
+            if (m_ensemble.front().m_lattice.empty())
+                throw std::runtime_error("Beamline lattice of the ensemble members has zero elements. Not yet initialized?");
+
+            return;
+        }
+
         // elements
         if (m_lattice.empty())
             throw std::runtime_error("Beamline lattice has zero elements. Not yet initialized?");
@@ -21,7 +21,14 @@
 int main(int argc, char* argv[])
 {
 #if defined(AMREX_USE_MPI)
+#   if defined(ImpactX_MPI_THREAD_MULTIPLE)
+    // for asynchronous output (diag.async_io)
+    int provided = MPI_THREAD_SINGLE;
+    AMREX_ALWAYS_ASSERT(MPI_SUCCESS == MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided));
+    amrex::ignore_unused(provided);  // checked by diag.async_io
+#   else
     AMREX_ALWAYS_ASSERT(MPI_SUCCESS == MPI_Init(&argc, &argv));
+#   endif
 #endif
 
     // although ImpactX' init_grids will call this if not done before, we call
@@ -9,12 +9,14 @@
  */
 #include "CollectLost.H"
 
+#include <AMReX_GpuContainers.H>
 #include <AMReX_GpuLaunch.H>
 #include <AMReX_GpuQualifiers.H>
 #include <AMReX_Math.H>
 #include <AMReX_Particle.H>
 #include <AMReX_ParticleTransformation.H>
 #include <AMReX_RandomEngine.H>
+#include <AMReX_Reduce.H>
 
 
 namespace impactx
@@ -23,6 +25,8 @@ namespace impactx
     {
         int s_index; //!< runtime index of runtime attribute in destination for position s where particle got lost
         amrex::ParticleReal s_lost; //!< position s in meters where particle got lost
+        int member_index = -1; //!< runtime index of the integer ensemble member attribute in source, or -1
+        amrex::ParticleReal const * member_s_lost = nullptr; //!< per ensemble member: position s in meters where particle got lost
 
         using SrcData = ImpactXParticleContainer::ParticleTileType::ConstParticleTileDataType;
         using DstData = ImpactXParticleContainer::ParticleTileType::ParticleTileDataType;
@@ -35,38 +39,44 @@ namespace impactx
                 dst.m_rdata[j][dst_ip] = src.m_rdata[j][src_ip];
             for (int j = 0; j < src.m_num_runtime_real; ++j)
                 dst.m_runtime_rdata[j][dst_ip] = src.m_runtime_rdata[j][src_ip];
+            for (int j = 0; j < src.m_num_runtime_int; ++j)
+                dst.m_runtime_idata[j][dst_ip] = src.m_runtime_idata[j][src_ip];
 
-            // unused: integer compile-time or runtime attributes
+            // unused: integer compile-time attributes
             //for (int j = 0; j < SrcData::NAI; ++j)
             //    dst.m_idata[j][dst_ip] = src.m_idata[j][src_ip];
-            //for (int j = 0; j < src.m_num_runtime_int; ++j)
-            //    dst.m_runtime_idata[j][dst_ip] = src.m_runtime_idata[j][src_ip];
 
             // flip id to positive in destination
             amrex::ParticleIDWrapper{dst.m_idcpu[dst_ip]}.make_valid();
 
             // remember the current s of the ref particle when lost
-            dst.m_runtime_rdata[s_index][dst_ip] = s_lost;
+            dst.m_runtime_rdata[s_index][dst_ip] = member_index < 0 ?
+                s_lost : member_s_lost[src.m_runtime_idata[member_index][src_ip]];
         }
     };
 
-    void collect_lost_particles (ImpactXParticleContainer& source)
+namespace
+{
+    /** Move lost particles into a separate container
+     *
+     * @param source the beam particle container that might loose particles
+     * @param copy copies a lost particle and stores where it got lost
+     * @param count_member if not negative: count only the lost particles of this ensemble member
+     * @return the (counted) particles that got lost on this MPI rank
+     */
+    LostParticles collect_lost (ImpactXParticleContainer& source, CopyAndMarkNegative const & copy, int count_member = -1)
     {
-        BL_PROFILE("impactX::collect_lost_particles");
-
         using SrcData = ImpactXParticleContainer::ParticleTileType::ConstParticleTileDataType;
 
         ImpactXParticleContainer& dest = *source.GetLostParticleContainer();
-        const int s_runtime_index = dest.GetRealCompIndex("s_lost") - dest.NArrayReal;
-
-        RefPart const ref_part = source.GetRefParticle();
-        auto const s_lost = ref_part.s;
 
         // have to resize here, not in the constructor because grids have not
         // been built when constructor was called.
         dest.reserveData();
         dest.resizeData();
 
+        LostParticles lost;
+
         // copy all particles marked with a negative ID from source to destination
         int const nLevel = source.finestLevel();
         for (int lev = 0; lev <= nLevel; ++lev) {
@@ -84,7 +94,7 @@ namespace impactx
                 if (np == 0) continue;  // no particles in source tile
 
                 // we will copy particles that were marked as lost, with a negative id
-                auto const predicate = [] AMREX_GPU_HOST_DEVICE (const SrcData& src, int ip)
+                auto const predicate = [] AMREX_GPU_HOST_DEVICE (const SrcData& src, long ip)
                 /* NVCC 11.3.109 chokes in C++17 on this: noexcept */
                 {
                     return !amrex::ConstParticleIDWrapper{src.m_idcpu[ip]}.is_valid();
@@ -93,28 +103,39 @@ namespace impactx
                 auto& ptile_dest = dest.DefineAndReturnParticleTile(
                         lev, pti.index(), pti.LocalTileIndex());
 
-                // count how many particles we will copy
-                amrex::ReduceOps<amrex::ReduceOpSum> reduce_op;
-                amrex::ReduceData<int> reduce_data(reduce_op);
+                // count how many particles we will copy, and the counted ones and their weight for the loss map
+                amrex::ReduceOps<amrex::ReduceOpSum, amrex::ReduceOpSum, amrex::ReduceOpSum> reduce_op;
+                amrex::ReduceData<amrex::Long, amrex::Long, amrex::ParticleReal> reduce_data(reduce_op);
+                using ReduceTuple = typename decltype(reduce_data)::Type;
                 {
                     auto const src_data = ptile_source.getConstParticleTileData();
+                    int const member_index = copy.member_index;
 
-                    reduce_op.eval(np, reduce_data, [=] AMREX_GPU_HOST_DEVICE (int ip)
+                    reduce_op.eval(np, reduce_data, [=] AMREX_GPU_HOST_DEVICE (long ip) -> ReduceTuple
                     {
-                        return predicate(src_data, ip);
+                        bool const is_lost = predicate(src_data, ip);
+                        bool const counted = is_lost &&
+                            (count_member < 0 || src_data.m_runtime_idata[member_index][ip] == count_member);
+                        return {amrex::Long(is_lost),
+                                amrex::Long(counted),
+                                counted ? src_data.m_rdata[RealSoA::w][ip] : amrex::ParticleReal(0)};
                     });
                 }
-                int const np_to_move = amrex::get<0>(reduce_data.value());
+                ReduceTuple const counts = reduce_data.value();
+                amrex::Long const np_to_move = amrex::get<0>(counts);
                 if (np_to_move == 0) continue;  // no particles to move from source tile
+                lost.num_particles += amrex::get<1>(counts);
+                lost.weight += amrex::get<2>(counts);
 
                 // allocate memory in destination
-                int const dst_index = ptile_dest.numParticles();
+                amrex::Long const dst_index = ptile_dest.numParticles();
                 ptile_dest.resize(dst_index + np_to_move);
 
                 // copy particles
-                //   skipped in loop below: integer compile-time or runtime attributes
+                //   skipped in loop below: integer compile-time attributes
                 AMREX_ALWAYS_ASSERT(SrcData::NAI == 0);
-                AMREX_ALWAYS_ASSERT(ptile_source.NumRuntimeIntComps() == 0);
+                //   integer runtime attributes, e.g., the ensemble member, are copied
+                AMREX_ALWAYS_ASSERT(ptile_dest.NumRuntimeIntComps() == ptile_source.NumRuntimeIntComps());
 
                 //   first runtime attribute in destination is s position where particle got lost
                 AMREX_ALWAYS_ASSERT(dest.NumRuntimeRealComps() > 0);
@@ -123,7 +144,7 @@ namespace impactx
                     ptile_dest,
                     ptile_source,
                     predicate,
-                    CopyAndMarkNegative{s_runtime_index, s_lost},
+                    copy,
                     0,
                     dst_index
                 );
@@ -132,5 +153,43 @@ namespace impactx
                 amrex::removeInvalidParticles(ptile_source);
             } // particle tile loop
         } // lev
+
+        return lost;
+    }
+} // namespace
+
+    LostParticles collect_lost_particles (ImpactXParticleContainer& source)
+    {
+        BL_PROFILE("impactX::collect_lost_particles");
+
+        ImpactXParticleContainer& dest = *source.GetLostParticleContainer();
+        const int s_runtime_index = dest.GetRealCompIndex("s_lost") - dest.NArrayReal;
+
+        RefPart const ref_part = source.GetRefParticle();
+
+        return collect_lost(source, CopyAndMarkNegative{s_runtime_index, ref_part.s});
+    }
+
+    LostParticles collect_lost_particles (
+        ImpactXParticleContainer& source,
+        std::vector<amrex::ParticleReal> const & member_s,
+        int member_comp
+    )
+    {
+        BL_PROFILE("impactX::collect_lost_particles(ensemble)");
+
+        ImpactXParticleContainer& dest = *source.GetLostParticleContainer();
+        const int s_runtime_index = dest.GetRealCompIndex("s_lost") - dest.NArrayReal;
+
+        amrex::Gpu::DeviceVector<amrex::ParticleReal> d_member_s(member_s.size());
+        amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, member_s.begin(), member_s.end(), d_member_s.begin());
+        amrex::Gpu::streamSynchronize();
+
+        CopyAndMarkNegative copy{s_runtime_index, 0.0};
+        copy.member_index = member_comp - source.NArrayInt;
+        copy.member_s_lost = d_member_s.data();
+
+        // the loss map follows the lattice of the first member
+        return collect_lost(source, copy, 0);
     }
 } // namespace impactx
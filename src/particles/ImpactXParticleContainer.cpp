@@ -17,6 +17,7 @@
 #include <AMReX.H>
 #include <AMReX_AmrCore.H>
 #include <AMReX_AmrParGDB.H>
+#include <AMReX_GpuContainers.H>
 #include <AMReX_ParallelDescriptor.H>
 #include <AMReX_ParmParse.H>
 #include <AMReX_Particle.H>
@@ -159,29 +160,9 @@ namespace impactx
         SetParticleShape(v);
     }
 
-    void
-    ImpactXParticleContainer::AddNParticles (
-        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & x,
-        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & y,
-        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & t,
-        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & px,
-        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & py,
-        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & pt,
-        amrex::ParticleReal qm,
-        amrex::ParticleReal bchchg
-    )
+    ImpactXParticleContainer::ParticleTileType &
+    ImpactXParticleContainer::DefineAndReturnAddParticleTile ()
     {
-        BL_PROFILE("ImpactX::AddNParticles");
-
-        AMREX_ALWAYS_ASSERT(x.size() == y.size());
-        AMREX_ALWAYS_ASSERT(x.size() == t.size());
-        AMREX_ALWAYS_ASSERT(x.size() == px.size());
-        AMREX_ALWAYS_ASSERT(x.size() == py.size());
-        AMREX_ALWAYS_ASSERT(x.size() == pt.size());
-
-        // number of particles to add
-        int const np = x.size();
-
         // we add particles to lev 0, tile 0 of the first box assigned to this proc
         int lid = 0, gid = 0, tid = 0;
         {
@@ -193,14 +174,21 @@ namespace impactx
                 gid = *it;
             }
         }
-        auto& particle_tile = DefineAndReturnParticleTile(lid, gid, tid);
+        return DefineAndReturnParticleTile(lid, gid, tid);
+    }
+
+    ImpactXParticleContainer::ParticleTileType &
+    ImpactXParticleContainer::ResizeAddParticleTile (amrex::Long np, amrex::Long & old_np, amrex::Long & pid)
+    {
+        AMREX_ALWAYS_ASSERT(np >= 0);
+
+        auto& particle_tile = DefineAndReturnAddParticleTile();
 
-        auto old_np = particle_tile.numParticles();
-        auto new_np = old_np + np;
+        old_np = particle_tile.numParticles();
+        auto const new_np = old_np + np;
         particle_tile.resize(new_np);
 
         // Update NextID to include particles created in this function
-        int pid;
 #ifdef AMREX_USE_OMP
 #pragma omp critical (add_beam_nextid)
 #endif
@@ -209,48 +197,93 @@ namespace impactx
             ParticleType::NextID(pid+np);
         }
         AMREX_ALWAYS_ASSERT_WITH_MESSAGE(
-        static_cast<amrex::Long>(pid) + static_cast<amrex::Long>(np) < amrex::LongParticleIds::LastParticleID,
+        pid + np < amrex::LongParticleIds::LastParticleID,
             "ERROR: overflow on particle id numbers");
 
+        return particle_tile;
+    }
+
+    void
+    ImpactXParticleContainer::AddNParticles (
+        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & x,
+        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & y,
+        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & t,
+        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & px,
+        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & py,
+        amrex::Gpu::DeviceVector<amrex::ParticleReal> const & pt,
+        amrex::ParticleReal qm,
+        amrex::ParticleReal bchchg
+    )
+    {
+        BL_PROFILE("ImpactX::AddNParticles");
+
+        AMREX_ALWAYS_ASSERT(x.size() == y.size());
+        AMREX_ALWAYS_ASSERT(x.size() == t.size());
+        AMREX_ALWAYS_ASSERT(x.size() == px.size());
+        AMREX_ALWAYS_ASSERT(x.size() == py.size());
+        AMREX_ALWAYS_ASSERT(x.size() == pt.size());
+
+        AddNParticles(x.size(), x.data(), y.data(), t.data(), px.data(), py.data(), pt.data(),
+                      qm, bchchg, true);
+    }
+
+    void
+    ImpactXParticleContainer::AddNParticles (
+        amrex::Long np,
+        amrex::ParticleReal const * x,
+        amrex::ParticleReal const * y,
+        amrex::ParticleReal const * t,
+        amrex::ParticleReal const * px,
+        amrex::ParticleReal const * py,
+        amrex::ParticleReal const * pt,
+        amrex::ParticleReal qm,
+        amrex::ParticleReal bchchg,
+        bool device_memory
+    )
+    {
+        BL_PROFILE("ImpactX::AddNParticles(pointers)");
+
+        amrex::Long old_np = 0;
+        amrex::Long pid = 0;
+        auto& particle_tile = ResizeAddParticleTile(np, old_np, pid);
+
         const int cpuid = amrex::ParallelDescriptor::MyProc();
 
         auto & soa = particle_tile.GetStructOfArrays().GetRealData();
-        amrex::ParticleReal * const AMREX_RESTRICT x_arr = soa[RealSoA::x].dataPtr();
-        amrex::ParticleReal * const AMREX_RESTRICT y_arr = soa[RealSoA::y].dataPtr();
-        amrex::ParticleReal * const AMREX_RESTRICT t_arr = soa[RealSoA::t].dataPtr();
-        amrex::ParticleReal * const AMREX_RESTRICT px_arr = soa[RealSoA::px].dataPtr();
-        amrex::ParticleReal * const AMREX_RESTRICT py_arr = soa[RealSoA::py].dataPtr();
-        amrex::ParticleReal * const AMREX_RESTRICT pt_arr = soa[RealSoA::pt].dataPtr();
+
+        // copy the phase space coordinates directly into the particle tile
+        auto const copy_into_tile = [&soa, old_np, np, device_memory](amrex::ParticleReal const * src, int comp)
+        {
+            amrex::ParticleReal * const dst = soa[comp].dataPtr() + old_np;
+            if (device_memory) {
+                amrex::Gpu::copyAsync(amrex::Gpu::deviceToDevice, src, src + np, dst);
+            } else {
+                amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, src, src + np, dst);
+            }
+        };
+        copy_into_tile(x, RealSoA::x);
+        copy_into_tile(y, RealSoA::y);
+        copy_into_tile(t, RealSoA::t);
+        copy_into_tile(px, RealSoA::px);
+        copy_into_tile(py, RealSoA::py);
+        copy_into_tile(pt, RealSoA::pt);
+
         amrex::ParticleReal * const AMREX_RESTRICT qm_arr = soa[RealSoA::qm].dataPtr();
         amrex::ParticleReal * const AMREX_RESTRICT w_arr  = soa[RealSoA::w ].dataPtr();
 
         uint64_t * const AMREX_RESTRICT idcpu_arr = particle_tile.GetStructOfArrays().GetIdCPUData().dataPtr();
 
-        amrex::ParticleReal const * const AMREX_RESTRICT x_ptr = x.data();
-        amrex::ParticleReal const * const AMREX_RESTRICT y_ptr = y.data();
-        amrex::ParticleReal const * const AMREX_RESTRICT t_ptr = t.data();
-        amrex::ParticleReal const * const AMREX_RESTRICT px_ptr = px.data();
-        amrex::ParticleReal const * const AMREX_RESTRICT py_ptr = py.data();
-        amrex::ParticleReal const * const AMREX_RESTRICT pt_ptr = pt.data();
-
         amrex::ParallelFor(np,
-        [=] AMREX_GPU_DEVICE (int i) noexcept
+        [=] AMREX_GPU_DEVICE (amrex::Long i) noexcept
         {
             idcpu_arr[old_np+i] = amrex::SetParticleIDandCPU(pid + i, cpuid);
 
-            x_arr[old_np+i] = x_ptr[i];
-            y_arr[old_np+i] = y_ptr[i];
-            t_arr[old_np+i] = t_ptr[i];
-
-            px_arr[old_np+i] = px_ptr[i];
-            py_arr[old_np+i] = py_ptr[i];
-            pt_arr[old_np+i] = pt_ptr[i];
             qm_arr[old_np+i] = qm;
             w_arr[old_np+i]  = bchchg/ablastr::constant::SI::q_e/np;
         });
 
         // safety first: in case passed attribute arrays were temporary, we
-        // want to make sure the ParallelFor has ended here
+        // want to make sure the copies and the ParallelFor have ended here
         amrex::Gpu::streamSynchronize();
     }
 
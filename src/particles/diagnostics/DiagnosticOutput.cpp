@@ -10,20 +10,335 @@
 #include "DiagnosticOutput.H"
 #include "NonlinearLensInvariants.H"
 #include "ReducedBeamCharacteristics.H"
+#include "SlicedBeamCharacteristics.H"
+#include "particles/ensemble/EnsembleDiagnostics.H"
 
 #include <AMReX_BLProfiler.H> // for BL_PROFILE
 #include <AMReX_Extension.H>  // for AMREX_RESTRICT
+#include <AMReX_GpuContainers.H>  // for DeviceVector
+#include <AMReX_GpuLaunch.H>  // for ParallelFor
+#include <AMReX_ParallelDescriptor.H>  // for MyProc
 #include <AMReX_ParmParse.H>  // for ParmParse
 #include <AMReX_REAL.H>       // for ParticleReal
-#include <AMReX_Print.H>      // for PrintToFile
-#include <AMReX_ParticleTile.H>     // for constructor of SoAParticle
 
+#include <cstdint>
+#include <fstream>
 #include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 
 namespace impactx::diagnostics
 {
+namespace
+{
+    /** A diagnostics file that stays open between calls
+     *
+     * Rows are buffered in memory and written to the file every
+     * ``diag.flush_every`` steps, in one write. Each MPI rank writes its
+     * own file, with the rank as suffix of the file name.
+     *
+     * The text format writes one line of space-separated decimal values per
+     * row. The binary format writes a header line ``impactx-diag-v1``,
+     * a line with ``name:type`` of each column (type ``f8``: double,
+     * ``i8``: int64, ``u8``: uint64), followed by blocks of rows: the
+     * number of rows as int64 and then each column as a contiguous array
+     * of 8-byte values. All binary values are in native byte order.
+     */
+    class DiagnosticFile
+    {
+      public:
+        DiagnosticFile (std::string const & file_name, bool binary)
+        : m_binary(binary)
+        {
+            std::string proc_file_name = file_name + "." + std::to_string(amrex::ParallelDescriptor::MyProc());
+            if (m_binary) { proc_file_name.append(".bin"); }
+
+            m_ofs.open(proc_file_name, m_binary ? std::ios::app | std::ios::binary : std::ios::app);
+            if (!m_ofs) {
+                throw std::runtime_error("DiagnosticOutput: cannot open file " + proc_file_name);
+            }
+            m_text.precision(std::numeric_limits<amrex::ParticleReal>::max_digits10);
+        }
+
+        ~DiagnosticFile ()
+        {
+            flush();
+        }
+
+        DiagnosticFile (DiagnosticFile const &) = delete;
+        DiagnosticFile& operator= (DiagnosticFile const &) = delete;
+
+        /** Start a new table with the given column names */
+        void
+        header (std::vector<std::string> const & names)
+        {
+            if (m_binary) {
+                // the binary header is written with the first block of rows
+                if (m_names.empty()) { m_names = names; }
+            } else {
+                for (std::size_t i = 0; i < names.size(); ++i) {
+                    m_text << (i == 0 ? "" : " ") << names[i];
+                }
+                m_text << "\n";
+            }
+        }
+
+        /** Add the next value of the current row */
+        template<typename T>
+        DiagnosticFile &
+        operator<< (T v)
+        {
+            static_assert(std::is_arithmetic_v<T>, "DiagnosticFile: only numbers can be written");
+
+            if (m_binary) {
+                if (m_col >= m_columns.size()) { m_columns.resize(m_col + 1); }
+                Column & c = m_columns[m_col];
+                if constexpr (std::is_floating_point_v<T>) {
+                    c.type = "f8";
+                    append(c, static_cast<double>(v));
+                } else if constexpr (std::is_unsigned_v<T>) {
+                    c.type = "u8";
+                    append(c, static_cast<uint64_t>(v));
+                } else {
+                    c.type = "i8";
+                    append(c, static_cast<int64_t>(v));
+                }
+            } else {
+                m_text << (m_col == 0 ? "" : " ") << v;
+            }
+            ++m_col;
+            return *this;
+        }
+
+        /** Finish the current row */
+        void
+        end_row ()
+        {
+            if (m_binary) {
+                ++m_nrows;
+            } else {
+                m_text << "\n";
+            }
+            m_col = 0;
+        }
+
+        /** Write the buffered rows, if the last write is at least flush_every steps ago */
+        void
+        flush_if_due (int step, int flush_every)
+        {
+            if (step - m_last_flush_step >= flush_every || step < m_last_flush_step) {
+                flush();
+                m_last_flush_step = step;
+            }
+        }
+
+        /** Write all buffered rows to the file */
+        void
+        flush ()
+        {
+            if (m_binary) {
+                if (m_nrows == 0) { return; }
+
+                if (!m_header_written) {
+                    m_ofs << "impactx-diag-v1\n";
+                    for (std::size_t i = 0; i < m_columns.size(); ++i) {
+                        std::string const name = i < m_names.size() ? m_names[i] : "column_" + std::to_string(i);
+                        m_ofs << (i == 0 ? "" : " ") << name << ":" << m_columns[i].type;
+                    }
+                    m_ofs << "\n";
+                    m_header_written = true;
+                }
+
+                auto const nrows = static_cast<int64_t>(m_nrows);
+                m_ofs.write(reinterpret_cast<char const *>(&nrows), sizeof(nrows));
+                for (auto & c : m_columns) {
+                    m_ofs.write(c.data.data(), static_cast<std::streamsize>(c.data.size()));
+                    c.data.clear();
+                }
+                m_nrows = 0;
+            } else {
+                m_ofs << m_text.str();
+                m_text.str("");
+            }
+            m_ofs.flush();
+        }
+
+      private:
+        /** One column of the binary format: 8-byte values of one type */
+        struct Column
+        {
+            std::string type = "f8"; ///< f8, i8 or u8
+            std::vector<char> data; ///< buffered values
+        };
+
+        template<typename T>
+        static void
+        append (Column & c, T v)
+        {
+            static_assert(sizeof(T) == 8);
+            char const * bytes = reinterpret_cast<char const *>(&v);
+            c.data.insert(c.data.end(), bytes, bytes + sizeof(T));
+        }
+
+        bool m_binary; ///< binary (true) or text (false) format
+        std::ofstream m_ofs; ///< the open file
+        std::ostringstream m_text; ///< buffered rows of the text format
+        std::vector<std::string> m_names; ///< column names of the binary format
+        std::vector<Column> m_columns; ///< buffered rows of the binary format
+        std::size_t m_nrows = 0; ///< number of buffered rows of the binary format
+        std::size_t m_col = 0; ///< next column of the current row
+        bool m_header_written = false; ///< binary header was written
+        int m_last_flush_step = 0; ///< step of the last write to the file
+    };
+
+    /** The diagnostics files that are currently open, by file name */
+    std::map<std::string, std::unique_ptr<DiagnosticFile>> &
+    open_files ()
+    {
+        static std::map<std::string, std::unique_ptr<DiagnosticFile>> files;
+        return files;
+    }
+
+    /** Number of steps between writes to the diagnostics files */
+    int
+    flush_every ()
+    {
+        int flush_every = 100;
+        amrex::ParmParse("diag").queryAdd("flush_every", flush_every);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(flush_every >= 1,
+            "DiagnosticOutput: diag.flush_every must be at least 1.");
+        return flush_every;
+    }
+
+    /** Return the open diagnostics file with this name, opening it if needed */
+    DiagnosticFile &
+    get_file (std::string const & file_name)
+    {
+        auto & files = open_files();
+        auto it = files.find(file_name);
+        if (it == files.end())
+        {
+            std::string format = "text";
+            amrex::ParmParse("diag").queryAdd("format", format);
+            if (format != "text" && format != "binary") {
+                throw std::runtime_error("DiagnosticOutput: diag.format must be text or binary but is: " + format);
+            }
+
+            it = files.emplace(file_name, std::make_unique<DiagnosticFile>(file_name, format == "binary")).first;
+        }
+        return *it->second;
+    }
+
+    /** Column names of the reference particle output */
+    std::vector<std::string>
+    ref_particle_header ()
+    {
+        return {"step", "s", "beta", "gamma", "beta_gamma", "x", "y", "z", "t", "px", "py", "pz", "pt"};
+    }
+
+    /** Write one row of reference particle output */
+    void
+    write_ref_particle_line (
+        DiagnosticFile & file,
+        RefPart const & ref_part,
+        int step
+    )
+    {
+        file << step << ref_part.s
+             << ref_part.beta() << ref_part.gamma() << ref_part.beta_gamma()
+             << ref_part.x << ref_part.y << ref_part.z << ref_part.t
+             << ref_part.px << ref_part.py << ref_part.pz << ref_part.pt;
+    }
+
+    /** Names of the reduced beam characteristics in the output, in order */
+    std::vector<std::string> const &
+    rbc_names ()
+    {
+        static std::vector<std::string> const names = {
+            "x_mean", "x_min", "x_max",
+            "y_mean", "y_min", "y_max",
+            "t_mean", "t_min", "t_max",
+            "sig_x", "sig_y", "sig_t",
+            "px_mean", "px_min", "px_max",
+            "py_mean", "py_min", "py_max",
+            "pt_mean", "pt_min", "pt_max",
+            "sig_px", "sig_py", "sig_pt",
+            "emittance_x", "emittance_y", "emittance_t",
+            "alpha_x", "alpha_y", "alpha_t",
+            "beta_x", "beta_y", "beta_t",
+            "dispersion_x", "dispersion_px",
+            "dispersion_y", "dispersion_py",
+            "charge_C"
+        };
+        return names;
+    }
+
+    /** Column names of the reduced beam characteristics output */
+    std::vector<std::string>
+    rbc_header ()
+    {
+        std::vector<std::string> header = {"step", "s"};
+        header.insert(header.end(), rbc_names().begin(), rbc_names().end());
+        return header;
+    }
+
+    /** Write one row of reduced beam characteristics output */
+    void
+    write_rbc_line (
+        DiagnosticFile & file,
+        std::unordered_map<std::string, amrex::ParticleReal> const & rbc,
+        amrex::ParticleReal s,
+        int step
+    )
+    {
+        file << step << s;
+        for (auto const & name : rbc_names()) {
+            file << rbc.at(name);
+        }
+    }
+
+    /** Column names of the sliced beam characteristics output */
+    std::vector<std::string>
+    sliced_header ()
+    {
+        std::vector<std::string> header = {"step", "s", "slice"};
+        auto const & names = sliced_beam_characteristics_names();
+        header.insert(header.end(), names.begin(), names.end());
+        return header;
+    }
+
+    /** Prepend a column to a header */
+    std::vector<std::string>
+    with_first_column (std::string const & name, std::vector<std::string> header)
+    {
+        header.insert(header.begin(), name);
+        return header;
+    }
+} // namespace
+
+    void
+    flush_diagnostics ()
+    {
+        for (auto & [name, file] : open_files()) {
+            file->flush();
+        }
+    }
+
+    void
+    close_diagnostics ()
+    {
+        // files are flushed when they are closed
+        open_files().clear();
+    }
+
     void DiagnosticOutput (ImpactXParticleContainer const & pc,
                            OutputType const otype,
                            std::string file_name,
@@ -35,146 +350,187 @@ namespace impactx::diagnostics
         using namespace amrex::literals; // for _rt and _prt
 
         // keep file open as we add more and more lines
-        amrex::AllPrintToFile file_handler(std::move(file_name));
-        file_handler.SetPrecision(std::numeric_limits<amrex::ParticleReal>::max_digits10);
+        DiagnosticFile & file = get_file(file_name);
 
         // write file header per MPI RANK
         if (!append) {
             if (otype == OutputType::PrintRefParticle) {
-                file_handler << "step s beta gamma beta_gamma x y z t px py pz pt\n";
+                file.header(ref_particle_header());
             } else if (otype == OutputType::PrintReducedBeamCharacteristics) {
-                file_handler << "step" << " " << "s" << " "
-                             << "x_mean" << " " << "x_min" << " " << "x_max" << " "
-                             << "y_mean" << " " << "y_min" << " " << "y_max" << " "
-                             << "t_mean" << " " << "t_min" << " " << "t_max" << " "
-                             << "sig_x" << " " << "sig_y" << " " << "sig_t" << " "
-                             << "px_mean" << " " << "px_min" << " " << "px_max" << " "
-                             << "py_mean" << " " << "py_min" << " " << "py_max" << " "
-                             << "pt_mean" << " " << "pt_min" << " " << "pt_max" << " "
-                             << "sig_px" << " " << "sig_py" << " " << "sig_pt" << " "
-                             << "emittance_x" << " " << "emittance_y" << " " << "emittance_t" << " "
-                             << "alpha_x" << " " << "alpha_y" << " " << "alpha_t" << " "
-                             << "beta_x" << " " << "beta_y" << " " << "beta_t" << " "
-                             << "dispersion_x" << " " << "dispersion_px" << " "
-                             << "dispersion_y" << " " << "dispersion_py" << " "
-                             << "charge_C" << " "
-                             << "\n";
+                file.header(rbc_header());
+            } else if (otype == OutputType::PrintSlicedBeamCharacteristics) {
+                file.header(sliced_header());
+            } else if (otype == OutputType::PrintNonlinearLensInvariants) {
+                file.header({"id", "H", "I"});
             }
         }
 
         if (otype == OutputType::PrintRefParticle) {
-            // preparing to access reference particle data: RefPart
-            RefPart const ref_part = pc.GetRefParticle();
-
-            amrex::ParticleReal const s = ref_part.s;
-            amrex::ParticleReal const beta = ref_part.beta();
-            amrex::ParticleReal const gamma = ref_part.gamma();
-            amrex::ParticleReal const beta_gamma = ref_part.beta_gamma();
-            amrex::ParticleReal const x = ref_part.x;
-            amrex::ParticleReal const y = ref_part.y;
-            amrex::ParticleReal const z = ref_part.z;
-            amrex::ParticleReal const t = ref_part.t;
-            amrex::ParticleReal const px = ref_part.px;
-            amrex::ParticleReal const py = ref_part.py;
-            amrex::ParticleReal const pz = ref_part.pz;
-            amrex::ParticleReal const pt = ref_part.pt;
-
-            // write particle data to file
-            file_handler
-                    << step << " " << s << " "
-                    << beta << " " << gamma << " " << beta_gamma << " "
-                    << x << " " << y << " " << z << " " << t << " "
-                    << px << " " << py << " " << pz << " " << pt << "\n";
+            write_ref_particle_line(file, pc.GetRefParticle(), step);
+            file.end_row();
         } // if( otype == OutputType::PrintRefParticle)
         else if (otype == OutputType::PrintReducedBeamCharacteristics) {
             std::unordered_map<std::string, amrex::ParticleReal> const rbc =
                 diagnostics::reduced_beam_characteristics(pc);
 
-            amrex::ParticleReal const s = pc.GetRefParticle().s;
-
-            file_handler << step << " " << s << " "
-                         << rbc.at("x_mean") << " " << rbc.at("x_min") << " " << rbc.at("x_max") << " "
-                         << rbc.at("y_mean") << " " << rbc.at("y_min") << " " << rbc.at("y_max") << " "
-                         << rbc.at("t_mean") << " " << rbc.at("t_min") << " " << rbc.at("t_max") << " "
-                         << rbc.at("sig_x") << " " << rbc.at("sig_y") << " " << rbc.at("sig_t") << " "
-                         << rbc.at("px_mean") << " " << rbc.at("px_min") << " " << rbc.at("px_max") << " "
-                         << rbc.at("py_mean") << " " << rbc.at("py_min") << " " << rbc.at("py_max") << " "
-                         << rbc.at("pt_mean") << " " << rbc.at("pt_min") << " " << rbc.at("pt_max") << " "
-                         << rbc.at("sig_px") << " " << rbc.at("sig_py") << " " << rbc.at("sig_pt") << " "
-                         << rbc.at("emittance_x") << " " << rbc.at("emittance_y") << " " << rbc.at("emittance_t") << " "
-                         << rbc.at("alpha_x") << " " << rbc.at("alpha_y") << " " << rbc.at("alpha_t") << " "
-                         << rbc.at("beta_x") << " " << rbc.at("beta_y") << " " << rbc.at("beta_t") << " "
-                         << rbc.at("dispersion_x") << " " << rbc.at("dispersion_px") << " "
-                         << rbc.at("dispersion_y") << " " << rbc.at("dispersion_py") << " "
-                         << rbc.at("charge_C") << "\n";
+            write_rbc_line(file, rbc, pc.GetRefParticle().s, step);
+            file.end_row();
         } // if( otype == OutputType::PrintReducedBeamCharacteristics)
+        else if (otype == OutputType::PrintSlicedBeamCharacteristics) {
+            int num_bins = 64;
+            amrex::ParmParse("diag").queryAdd("sliced_beam_characteristics_num_bins", num_bins);
+
+            auto const slices = diagnostics::sliced_beam_characteristics(pc, num_bins);
+            auto const & names = sliced_beam_characteristics_names();
+            for (int b = 0; b < num_bins; ++b) {
+                file << step << pc.GetRefParticle().s << b;
+                for (auto const & name : names) {
+                    file << slices.at(name)[b];
+                }
+                file.end_row();
+            }
+        } // if( otype == OutputType::PrintSlicedBeamCharacteristics)
 
         // TODO: add as an option to the monitor element
         if (otype == OutputType::PrintNonlinearLensInvariants) {
-            // create a host-side particle buffer
-            auto tmp = pc.make_alike<amrex::PinnedArenaAllocator>();
+            // Parse the diagnostic parameters
+            amrex::ParmParse pp_diag("diag");
+
+            amrex::ParticleReal alpha = 0.0;
+            pp_diag.queryAdd("alpha", alpha);
+
+            amrex::ParticleReal beta = 1.0;
+            pp_diag.queryAdd("beta", beta);
+
+            amrex::ParticleReal tn = 0.4;
+            pp_diag.queryAdd("tn", tn);
+
+            amrex::ParticleReal cn = 0.01;
+            pp_diag.queryAdd("cn", cn);
 
-            // copy all particles from device to host
-            bool const local = true;
-            tmp.copyParticles(pc, local);
+            NonlinearLensInvariants const nonlinear_lens_invariants(alpha, beta, tn, cn);
 
             // loop over refinement levels
-            int const nLevel = tmp.finestLevel();
+            int const nLevel = pc.finestLevel();
             for (int lev = 0; lev <= nLevel; ++lev) {
                 // loop over all particle boxes
-                using MyPinnedParIter = amrex::ParIterSoA<RealSoA::nattribs,IntSoA::nattribs, amrex::PinnedArenaAllocator>;
-                for (MyPinnedParIter pti(tmp, lev); pti.isValid(); ++pti) {
-                    const int np = pti.numParticles();
+                for (ParConstIterSoA pti(pc, lev); pti.isValid(); ++pti) {
+                    const long np = pti.numParticles();
 
                     // preparing access to particle data: SoA of Reals
                     auto const& soa = pti.GetStructOfArrays();
-                    auto const& part_x = soa.GetRealData(RealSoA::x);
-                    auto const& part_y = soa.GetRealData(RealSoA::y);
-                    auto const& part_px = soa.GetRealData(RealSoA::px);
-                    auto const& part_py = soa.GetRealData(RealSoA::py);
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_x = soa.GetRealData(RealSoA::x).dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_y = soa.GetRealData(RealSoA::y).dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_px = soa.GetRealData(RealSoA::px).dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_py = soa.GetRealData(RealSoA::py).dataPtr();
 
-                    auto const& part_idcpu = soa.GetIdCPUData().dataPtr();
+                    // calculate invariants of motion on the device
+                    amrex::Gpu::DeviceVector<amrex::ParticleReal> d_H(np);
+                    amrex::Gpu::DeviceVector<amrex::ParticleReal> d_I(np);
+                    amrex::ParticleReal * const AMREX_RESTRICT H_ptr = d_H.dataPtr();
+                    amrex::ParticleReal * const AMREX_RESTRICT I_ptr = d_I.dataPtr();
+                    amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (long i)
+                    {
+                        NonlinearLensInvariants::Data const HI_out =
+                                nonlinear_lens_invariants(part_x[i], part_y[i], part_px[i], part_py[i]);
+                        H_ptr[i] = HI_out.H;
+                        I_ptr[i] = HI_out.I;
+                    });
 
-                    // Parse the diagnostic parameters
-                    amrex::ParmParse pp_diag("diag");
+                    // copy the ids and invariants to the host
+                    std::vector<uint64_t> h_idcpu(np);
+                    std::vector<amrex::ParticleReal> h_H(np);
+                    std::vector<amrex::ParticleReal> h_I(np);
+                    uint64_t const * const part_idcpu = soa.GetIdCPUData().dataPtr();
+                    amrex::Gpu::copyAsync(amrex::Gpu::deviceToHost, part_idcpu, part_idcpu + np, h_idcpu.begin());
+                    amrex::Gpu::copyAsync(amrex::Gpu::deviceToHost, d_H.begin(), d_H.end(), h_H.begin());
+                    amrex::Gpu::copyAsync(amrex::Gpu::deviceToHost, d_I.begin(), d_I.end(), h_I.begin());
+                    amrex::Gpu::streamSynchronize();
 
-                    amrex::ParticleReal alpha = 0.0;
-                    pp_diag.queryAdd("alpha", alpha);
+                    // write particle invariant data to file
+                    for (long i = 0; i < np; ++i) {
+                        file << h_idcpu[i] << h_H[i] << h_I[i];
+                        file.end_row();
+                    }
+                } // end loop over all particle boxes
+            } // end mesh-refinement level loop
+        }
 
-                    amrex::ParticleReal beta = 1.0;
-                    pp_diag.queryAdd("beta", beta);
+        file.flush_if_due(step, flush_every());
+    }
+
+    void DiagnosticOutput (envelope::Envelope const & env,
+                           RefPart const & ref_part,
+                           OutputType const otype,
+                           std::string file_name,
+                           int step,
+                           bool append)
+    {
+        BL_PROFILE("impactx::diagnostics::DiagnosticOutput(envelope)");
 
-                    amrex::ParticleReal tn = 0.4;
-                    pp_diag.queryAdd("tn", tn);
+        if (otype == OutputType::PrintNonlinearLensInvariants ||
+            otype == OutputType::PrintSlicedBeamCharacteristics) {
+            throw std::runtime_error(
+                "DiagnosticOutput: per-particle and sliced diagnostics are not defined for the beam envelope.");
+        }
 
-                    amrex::ParticleReal cn = 0.01;
-                    pp_diag.queryAdd("cn", cn);
+        // keep file open as we add more and more lines
+        DiagnosticFile & file = get_file(file_name);
 
-                    NonlinearLensInvariants const nonlinear_lens_invariants(alpha, beta, tn, cn);
+        if (otype == OutputType::PrintRefParticle) {
+            if (!append) { file.header(ref_particle_header()); }
+            write_ref_particle_line(file, ref_part, step);
+            file.end_row();
+        }
+        else if (otype == OutputType::PrintReducedBeamCharacteristics) {
+            if (!append) { file.header(rbc_header()); }
+            std::unordered_map<std::string, amrex::ParticleReal> const rbc =
+                diagnostics::reduced_beam_characteristics(env, ref_part);
+            write_rbc_line(file, rbc, ref_part.s, step);
+            file.end_row();
+        }
 
-                    // print out particles (this hack works only on CPU and on GPUs with
-                    // unified memory access)
-                    for (int i = 0; i < np; ++i) {
-                        amrex::ParticleReal const x = part_x[i];
-                        amrex::ParticleReal const y = part_y[i];
-                        uint64_t const global_id = part_idcpu[i];
+        file.flush_if_due(step, flush_every());
+    }
 
-                        amrex::ParticleReal const px = part_px[i];
-                        amrex::ParticleReal const py = part_py[i];
+    void DiagnosticOutput (ImpactXParticleContainer & pc,
+                           std::vector<ensemble::Member> const & members,
+                           OutputType const otype,
+                           std::string file_name,
+                           int step,
+                           bool append)
+    {
+        BL_PROFILE("impactx::diagnostics::DiagnosticOutput(ensemble)");
 
-                        // calculate invariants of motion
-                        NonlinearLensInvariants::Data const HI_out =
-                                nonlinear_lens_invariants(x, y, px, py);
+        if (otype == OutputType::PrintNonlinearLensInvariants ||
+            otype == OutputType::PrintSlicedBeamCharacteristics) {
+            throw std::runtime_error(
+                "DiagnosticOutput: per-particle and sliced diagnostics are not supported for ensembles.");
+        }
 
-                        // write particle invariant data to file
-                        file_handler
-                                << global_id << " "
-                                << HI_out.H << " " << HI_out.I << "\n";
+        // keep file open as we add more and more lines
+        DiagnosticFile & file = get_file(file_name);
 
-                    } // i=0...np
-                } // end loop over all particle boxes
-            } // end mesh-refinement level loop
+        if (otype == OutputType::PrintRefParticle) {
+            if (!append) { file.header(with_first_column("member", ref_particle_header())); }
+            for (std::size_t m = 0; m < members.size(); ++m) {
+                file << m;
+                write_ref_particle_line(file, members[m].m_ref_part, step);
+                file.end_row();
+            }
         }
+        else if (otype == OutputType::PrintReducedBeamCharacteristics) {
+            if (!append) { file.header(with_first_column("member", rbc_header())); }
+            // all members are reduced together
+            auto const rbc = ensemble::reduced_beam_characteristics(pc, members);
+            for (std::size_t m = 0; m < members.size(); ++m) {
+                file << m;
+                write_rbc_line(file, rbc[m], members[m].m_ref_part.s, step);
+                file.end_row();
+            }
+        }
+
+        file.flush_if_due(step, flush_every());
     }
 
 } // namespace impactx::diagnostics
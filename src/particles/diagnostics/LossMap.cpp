@@ -0,0 +1,134 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell
+ * License: BSD-3-Clause-LBNL
+ */
+#include "LossMap.H"
+
+#include <AMReX_BLProfiler.H>
+#include <AMReX_ParallelDescriptor.H>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+
+namespace impactx::diagnostics
+{
+    void
+    LossMap::Table::add (std::size_t row, LostParticles const & lost, double charge_per_particle)
+    {
+        if (row >= num_particles.size()) {
+            num_particles.resize(row + 1, 0);
+            weight.resize(row + 1, 0.0);
+            charge.resize(row + 1, 0.0);
+        }
+        num_particles[row] += lost.num_particles;
+        weight[row] += double(lost.weight);
+        charge[row] += double(lost.weight) * charge_per_particle;
+    }
+
+    void
+    LossMap::Table::reduce ()
+    {
+        // tables of MPI ranks can differ in length
+        int num_rows = static_cast<int>(num_particles.size());
+        amrex::ParallelDescriptor::ReduceIntMax(num_rows);
+        num_particles.resize(num_rows, 0);
+        weight.resize(num_rows, 0.0);
+        charge.resize(num_rows, 0.0);
+
+        if (num_rows == 0) { return; }
+        amrex::ParallelDescriptor::ReduceLongSum(num_particles.data(), num_rows);
+        amrex::ParallelDescriptor::ReduceRealSum(weight.data(), num_rows);
+        amrex::ParallelDescriptor::ReduceRealSum(charge.data(), num_rows);
+    }
+
+    LossMap::LossMap (amrex::ParticleReal ds)
+    : m_ds(ds)
+    {
+        if (!(m_ds > 0)) {
+            throw std::runtime_error("LossMap: the bin width in s must be positive.");
+        }
+    }
+
+    void
+    LossMap::add (
+        LostParticles const & lost,
+        int period,
+        int element_index,
+        std::string const & element_type,
+        amrex::ParticleReal s,
+        amrex::ParticleReal charge
+    )
+    {
+        if (element_index >= static_cast<int>(m_element_types.size())) {
+            m_element_types.resize(element_index + 1);
+        }
+        m_element_types[element_index] = element_type;
+
+        // add a row even without losses: all MPI ranks see the same lattice
+        auto const s_bin = static_cast<std::size_t>(std::floor(std::max(s, amrex::ParticleReal(0)) / m_ds));
+        m_elements.add(element_index, lost, charge);
+        m_s.add(s_bin, lost, charge);
+        m_periods.add(period, lost, charge);
+    }
+
+    void
+    LossMap::write (std::string const & prefix) const
+    {
+        BL_PROFILE("impactx::diagnostics::LossMap::write");
+
+        // sum the local losses of all MPI ranks
+        Table elements = m_elements;
+        Table s = m_s;
+        Table periods = m_periods;
+        elements.reduce();
+        s.reduce();
+        periods.reduce();
+
+        if (!amrex::ParallelDescriptor::IOProcessor()) { return; }
+
+        auto const open = [](std::string const & file_name) {
+            std::ofstream ofs(file_name, std::ofstream::out | std::ofstream::trunc);
+            if (!ofs) {
+                throw std::runtime_error("LossMap: cannot open file " + file_name);
+            }
+            ofs.precision(std::numeric_limits<double>::max_digits10);
+            return ofs;
+        };
+
+        {
+            std::ofstream ofs = open(prefix + "_elements");
+            ofs << "element_index element_type lost_particles lost_weight lost_charge_C\n";
+            for (std::size_t i = 0; i < elements.num_particles.size(); ++i) {
+                std::string const type = i < m_element_types.size() ? m_element_types[i] : "unknown";
+                ofs << i << " " << type << " " << elements.num_particles[i] << " "
+                    << elements.weight[i] << " " << elements.charge[i] << "\n";
+            }
+        }
+        {
+            std::ofstream ofs = open(prefix + "_s");
+            ofs << "s_begin s_end lost_particles lost_weight lost_charge_C\n";
+            for (std::size_t i = 0; i < s.num_particles.size(); ++i) {
+                ofs << double(m_ds) * double(i) << " " << double(m_ds) * double(i + 1) << " "
+                    << s.num_particles[i] << " " << s.weight[i] << " " << s.charge[i] << "\n";
+            }
+        }
+        {
+            std::ofstream ofs = open(prefix + "_periods");
+            ofs << "period lost_particles lost_weight lost_charge_C\n";
+            for (std::size_t i = 0; i < periods.num_particles.size(); ++i) {
+                ofs << i << " " << periods.num_particles[i] << " "
+                    << periods.weight[i] << " " << periods.charge[i] << "\n";
+            }
+        }
+    }
+
+} // namespace impactx::diagnostics
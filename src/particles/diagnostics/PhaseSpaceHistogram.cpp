@@ -0,0 +1,218 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "PhaseSpaceHistogram.H"
+
+#include <AMReX_Array.H>                // for GpuArray
+#include <AMReX_BLProfiler.H>           // for TinyProfiler
+#include <AMReX_GpuAtomic.H>            // for HostDevice::Atomic::Add
+#include <AMReX_GpuContainers.H>        // for DeviceVector
+#include <AMReX_GpuQualifiers.H>        // for AMREX_GPU_DEVICE
+#include <AMReX_Math.H>                 // for Math::floor
+#include <AMReX_ParallelDescriptor.H>   // for ParallelDescriptor
+#include <AMReX_ParallelReduce.H>       // for ParallelAllReduce
+#include <AMReX_Reduce.H>               // for ReduceOps
+
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+
+namespace impactx::diagnostics
+{
+    std::string
+    particle_component_name (std::string const & name)
+    {
+        static std::unordered_map<std::string, std::string> const short_names = {
+            {"x", "position_x"}, {"y", "position_y"}, {"t", "position_t"},
+            {"px", "momentum_x"}, {"py", "momentum_y"}, {"pt", "momentum_t"}
+        };
+        auto const it = short_names.find(name);
+        return it != short_names.end() ? it->second : name;
+    }
+
+    PhaseSpaceHistogram
+    phase_space_histogram (
+        ImpactXParticleContainer & pc,
+        std::vector<std::string> const & components,
+        std::vector<int> const & num_bins,
+        std::vector<std::array<amrex::ParticleReal, 2>> const & ranges
+    )
+    {
+        BL_PROFILE("impactx::diagnostics::phase_space_histogram");
+
+        using namespace amrex::literals; // for _rt and _prt
+        constexpr int max_dims = PhaseSpaceHistogram::max_dims;
+
+        int const ndims = static_cast<int>(components.size());
+        if (ndims < 1 || ndims > max_dims) {
+            throw std::runtime_error("phase_space_histogram: 1 to 4 components are supported.");
+        }
+        if (static_cast<int>(num_bins.size()) != ndims) {
+            throw std::runtime_error("phase_space_histogram: one number of bins per component is needed.");
+        }
+        if (!ranges.empty() && static_cast<int>(ranges.size()) != ndims) {
+            throw std::runtime_error("phase_space_histogram: one range per component is needed.");
+        }
+
+        PhaseSpaceHistogram hist;
+        std::size_t num_cells = 1;
+        amrex::GpuArray<int, max_dims> comp_idx{};
+        amrex::GpuArray<int, max_dims> nbins{};
+        for (int d = 0; d < ndims; ++d) {
+            if (num_bins[d] < 1) {
+                throw std::runtime_error("phase_space_histogram: the number of bins must be at least 1.");
+            }
+            hist.components.push_back(particle_component_name(components[d]));
+            comp_idx[d] = pc.GetRealCompIndex(hist.components[d]);
+            nbins[d] = num_bins[d];
+            num_cells *= std::size_t(num_bins[d]);
+            if (num_cells > PhaseSpaceHistogram::max_cells) {
+                throw std::runtime_error("phase_space_histogram: too many bins, the product of the numbers of bins "
+                                         "must not exceed " + std::to_string(PhaseSpaceHistogram::max_cells) + ".");
+            }
+        }
+        hist.num_bins = num_bins;
+
+        // extent of the beam in the components without a user-defined range
+        amrex::GpuArray<amrex::ParticleReal, max_dims> lo{};
+        amrex::GpuArray<amrex::ParticleReal, max_dims> hi{};
+        {
+            amrex::ReduceOps<amrex::ReduceOpMin, amrex::ReduceOpMin, amrex::ReduceOpMin, amrex::ReduceOpMin,
+                             amrex::ReduceOpMax, amrex::ReduceOpMax, amrex::ReduceOpMax, amrex::ReduceOpMax> reduce_ops;
+            using ReduceDataT = amrex::ReduceData<amrex::ParticleReal, amrex::ParticleReal, amrex::ParticleReal, amrex::ParticleReal,
+                                                  amrex::ParticleReal, amrex::ParticleReal, amrex::ParticleReal, amrex::ParticleReal>;
+            ReduceDataT reduce_data(reduce_ops);
+            using ReduceTuple = typename ReduceDataT::Type;
+
+            for (int lev = 0; lev <= pc.finestLevel(); ++lev) {
+                for (ParIterSoA pti(pc, lev); pti.isValid(); ++pti) {
+                    auto const & soa = pti.GetStructOfArrays();
+                    amrex::GpuArray<amrex::ParticleReal const *, max_dims> part{};
+                    for (int d = 0; d < ndims; ++d) {
+                        part[d] = soa.GetRealData(comp_idx[d]).dataPtr();
+                    }
+                    reduce_ops.eval(pti.numParticles(), reduce_data,
+                        [=] AMREX_GPU_DEVICE (long i) -> ReduceTuple
+                        {
+                            amrex::ParticleReal v[max_dims] = {0.0_prt, 0.0_prt, 0.0_prt, 0.0_prt};
+                            for (int d = 0; d < ndims; ++d) { v[d] = part[d][i]; }
+                            return {v[0], v[1], v[2], v[3], v[0], v[1], v[2], v[3]};
+                        });
+                }
+            }
+            auto const r = reduce_data.value(reduce_ops);
+            amrex::ParticleReal mm[2 * max_dims] = {
+                amrex::get<0>(r), amrex::get<1>(r), amrex::get<2>(r), amrex::get<3>(r),
+                amrex::get<4>(r), amrex::get<5>(r), amrex::get<6>(r), amrex::get<7>(r)
+            };
+            amrex::ParallelAllReduce::Min(mm, max_dims, amrex::ParallelDescriptor::Communicator());
+            amrex::ParallelAllReduce::Max(mm + max_dims, max_dims, amrex::ParallelDescriptor::Communicator());
+
+            for (int d = 0; d < ndims; ++d) {
+                bool const user_range = !ranges.empty() && ranges[d][0] < ranges[d][1];
+                lo[d] = user_range ? ranges[d][0] : mm[d];
+                hi[d] = user_range ? ranges[d][1] : mm[max_dims + d];
+
+                // empty beam or all particles at the same value: a unit range around it
+                if (lo[d] > hi[d]) { lo[d] = hi[d] = 0.0_prt; }
+                if (!(hi[d] > lo[d])) { lo[d] -= 0.5_prt; hi[d] += 0.5_prt; }
+                // widen the extent of the beam slightly, to include the particles at the upper end
+                if (!user_range) { hi[d] += (hi[d] - lo[d]) * 4.0_prt * std::numeric_limits<amrex::ParticleReal>::epsilon(); }
+
+                hist.lower.push_back(lo[d]);
+                hist.upper.push_back(hi[d]);
+            }
+        }
+
+        amrex::GpuArray<amrex::ParticleReal, max_dims> inv_dx{};
+        for (int d = 0; d < ndims; ++d) {
+            inv_dx[d] = amrex::ParticleReal(nbins[d]) / (hi[d] - lo[d]);
+        }
+
+        // deposit the particle weights
+        hist.data.assign(num_cells, 0.0);
+        amrex::Gpu::DeviceVector<double> d_data(num_cells, 0.0);
+        double * const d_data_ptr = d_data.data();
+
+        // on CPU, small histograms are summed per thread and merged; large
+        // histograms and GPUs use atomics on the shared histogram
+#ifdef AMREX_USE_GPU
+        bool const thread_private = false;
+#else
+        bool const thread_private = num_cells <= PhaseSpaceHistogram::max_private_cells;
+#endif
+        int const w_idx = RealSoA::w;
+        for (int lev = 0; lev <= pc.finestLevel(); ++lev)
+        {
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+            {
+                std::vector<double> thread_data(thread_private ? num_cells : 0, 0.0);
+                double * const acc = thread_private ? thread_data.data() : d_data_ptr;
+
+                for (ParIterSoA pti(pc, lev); pti.isValid(); ++pti)
+                {
+                    auto const & soa = pti.GetStructOfArrays();
+                    amrex::GpuArray<amrex::ParticleReal const *, max_dims> part{};
+                    for (int d = 0; d < ndims; ++d) {
+                        part[d] = soa.GetRealData(comp_idx[d]).dataPtr();
+                    }
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_w = soa.GetRealData(w_idx).dataPtr();
+
+                    auto const deposit = [=] AMREX_GPU_HOST_DEVICE (long i)
+                    {
+                        // row-major index of the bin: the last axis is contiguous
+                        std::size_t cell = 0;
+                        for (int d = 0; d < ndims; ++d) {
+                            int const b = int(amrex::Math::floor((part[d][i] - lo[d]) * inv_dx[d]));
+                            if (b < 0 || b >= nbins[d]) { return; }
+                            cell = cell * std::size_t(nbins[d]) + std::size_t(b);
+                        }
+                        if (thread_private) {
+                            acc[cell] += double(part_w[i]);
+                        } else {
+                            amrex::HostDevice::Atomic::Add(&acc[cell], double(part_w[i]));
+                        }
+                    };
+
+                    long const np = pti.numParticles();
+#ifdef AMREX_USE_GPU
+                    amrex::ParallelFor(np, deposit);
+#else
+                    // serial per tile: a vectorized loop would race on the bins
+                    for (long i = 0; i < np; ++i) { deposit(i); }
+#endif
+                }
+
+                // merge the thread-private histograms
+                if (thread_private) {
+#ifdef AMREX_USE_OMP
+#pragma omp critical (impactx_phase_space_histogram)
+#endif
+                    for (std::size_t k = 0; k < num_cells; ++k) {
+                        d_data_ptr[k] += thread_data[k];
+                    }
+                }
+            }
+        }
+
+        amrex::Gpu::copy(amrex::Gpu::deviceToHost, d_data.begin(), d_data.end(), hist.data.begin());
+
+        // sum the histograms of all MPI ranks
+        amrex::ParallelAllReduce::Sum(hist.data.data(), static_cast<int>(hist.data.size()),
+                                      amrex::ParallelDescriptor::Communicator());
+
+        return hist;
+    }
+
+} // namespace impactx::diagnostics
@@ -13,242 +13,348 @@
 #include "particles/ImpactXParticleContainer.H"
 #include "particles/ReferenceParticle.H"
 
+#include <ablastr/constant.H>
+
+#include <AMReX.H>                      // for ExecOnFinalize
 #include <AMReX_BLProfiler.H>           // for TinyProfiler
+#include <AMReX_GpuContainers.H>       // for Gpu::copy
 #include <AMReX_GpuQualifiers.H>        // for AMREX_GPU_DEVICE
 #include <AMReX_REAL.H>                 // for ParticleReal
 #include <AMReX_Reduce.H>               // for ReduceOps
 #include <AMReX_ParallelDescriptor.H>   // for ParallelDescriptor
-#include <AMReX_ParticleReduce.H>       // for ParticleReduce
+#include <AMReX_ccse-mpi.H>             // for MPI_Op
 #include <AMReX_TypeList.H>             // for TypeMultiplier
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
 
 namespace impactx::diagnostics
 {
-    std::unordered_map<std::string, amrex::ParticleReal>
-    reduced_beam_characteristics (ImpactXParticleContainer const & pc)
+namespace detail
+{
+    std::array<double, moments_size>
+    empty_moments ()
     {
-        BL_PROFILE("impactx::diagnostics::reduced_beam_characteristics");
+        std::array<double, moments_size> moments{};
+        for (int k = 0; k < 6; ++k) {
+            moments[moments_min + k] = std::numeric_limits<double>::max();
+            moments[moments_max + k] = std::numeric_limits<double>::lowest();
+        }
+        return moments;
+    }
 
-        // preparing to access reference particle data: RefPart
-        RefPart const ref_part = pc.GetRefParticle();
-        // reference particle charge in C
-        amrex::ParticleReal const q_C = ref_part.charge;
+    amrex::GpuArray<double, 6>
+    tile_shift (ImpactXParticleContainer::const_iterator const & pti)
+    {
+        auto const & soa_real = pti.GetStructOfArrays().GetRealData();
+        int const comps[6] = {RealSoA::x, RealSoA::px, RealSoA::y, RealSoA::py, RealSoA::t, RealSoA::pt};
+
+        amrex::GpuArray<double, 6> shift;
+        for (int k = 0; k < 6; ++k) {
+            amrex::ParticleReal const * const first = soa_real[comps[k]].dataPtr();
+            amrex::ParticleReal value;
+            amrex::Gpu::copy(amrex::Gpu::deviceToHost, first, first + 1, &value);
+            shift[k] = value;
+        }
+        return shift;
+    }
 
-        // preparing access to particle data: SoA
-        using PType = typename ImpactXParticleContainer::SuperParticleType;
+    std::array<double, moments_size>
+    moments_from_sums (double const * sums, amrex::GpuArray<double, 6> const & shift)
+    {
+        std::array<double, moments_size> moments = empty_moments();
+
+        // convert the shifted moments to mean values and central co-moments
+        std::copy(sums + moments_min, sums + moments_size, moments.begin() + moments_min);
+        double const w_sum = sums[0];
+        if (w_sum > 0.0) {
+            moments[0] = w_sum;
+            for (int i = 0; i < 6; ++i) {
+                moments[1 + i] = shift[i] + sums[1 + i] / w_sum;
+            }
+            int n = 7;
+            for (int i = 0; i < 6; ++i) {
+                for (int j = i; j < 6; ++j) {
+                    moments[n] = sums[n] - sums[1 + i] * sums[1 + j] / w_sum;
+                    ++n;
+                }
+            }
+        }
+        return moments;
+    }
+
+    std::array<double, moments_size>
+    tile_moments (ImpactXParticleContainer::const_iterator const & pti)
+    {
+        long const np = pti.numParticles();
+        if (np == 0) { return empty_moments(); }
+
+        // preparing access to particle data: SoA, in the basis (x,px,y,py,t,pt)
+        auto const & soa_real = pti.GetStructOfArrays().GetRealData();
+        amrex::GpuArray<amrex::ParticleReal const *, 6> const v = {
+            soa_real[RealSoA::x].dataPtr(), soa_real[RealSoA::px].dataPtr(),
+            soa_real[RealSoA::y].dataPtr(), soa_real[RealSoA::py].dataPtr(),
+            soa_real[RealSoA::t].dataPtr(), soa_real[RealSoA::pt].dataPtr()
+        };
+        amrex::ParticleReal const * const AMREX_RESTRICT part_w = soa_real[RealSoA::w].dataPtr();
+
+        // shift: the first particle of the tile
+        amrex::GpuArray<double, 6> const shift = tile_shift(pti);
 
         /* The variables below need to be static to work around an MSVC bug
          * https://stackoverflow.com/questions/55136414/constexpr-variable-captured-inside-lambda-loses-its-constexpr-ness
          */
-        // numbers of same type reduction operations in first concurrent batch
-        static constexpr std::size_t num_red_ops_1_sum = 7;  // summation
-        static constexpr std::size_t num_red_ops_1_min = 6;  // minimum
-        static constexpr std::size_t num_red_ops_1_max = 6;  // maximum
+        // numbers of same type reduction operations
+        static constexpr std::size_t num_red_ops_sum = 1 + 6 + 21;  // w, first and second shifted moments
+        static constexpr std::size_t num_red_ops_min = 6;  // minimum
+        static constexpr std::size_t num_red_ops_max = 6;  // maximum
 
-        // prepare reduction operations for calculation of mean and min/max values in 6D phase space
+        //   note: accumulated in double precision, also for single precision particle data
         amrex::TypeMultiplier<amrex::ReduceOps,
-            amrex::ReduceOpSum[num_red_ops_1_sum],  // preparing mean values for w, x, y, t, px, py, pt
-            amrex::ReduceOpMin[num_red_ops_1_min],  // preparing min values for x, y, t, px, py, pt
-            amrex::ReduceOpMax[num_red_ops_1_max]   // preparing max values for x, y, t, px, py, pt
-        > reduce_ops_1;
-        using ReducedDataT1 = amrex::TypeMultiplier<amrex::ReduceData, amrex::ParticleReal[num_red_ops_1_sum + num_red_ops_1_min + num_red_ops_1_max]>;
-
-        auto r1 = amrex::ParticleReduce<ReducedDataT1>(
-            pc,
-            [=] AMREX_GPU_DEVICE(const PType& p) noexcept -> ReducedDataT1::Type
+            amrex::ReduceOpSum[num_red_ops_sum],
+            amrex::ReduceOpMin[num_red_ops_min],
+            amrex::ReduceOpMax[num_red_ops_max]
+        > reduce_ops;
+        amrex::TypeMultiplier<amrex::ReduceData, double[moments_size]> reduce_data(reduce_ops);
+        using ReduceTuple = typename decltype(reduce_data)::Type;
+
+        reduce_ops.eval(np, reduce_data,
+            [=] AMREX_GPU_DEVICE (long i) noexcept -> ReduceTuple
             {
-                // access particle position data
-                const amrex::ParticleReal p_x = p.rdata(RealSoA::x);
-                const amrex::ParticleReal p_y = p.rdata(RealSoA::y);
-                const amrex::ParticleReal p_t = p.rdata(RealSoA::t);
-
-                // access SoA particle momentum data and weighting
-                const amrex::ParticleReal p_w = p.rdata(RealSoA::w);
-                const amrex::ParticleReal p_px = p.rdata(RealSoA::px);
-                const amrex::ParticleReal p_py = p.rdata(RealSoA::py);
-                const amrex::ParticleReal p_pt = p.rdata(RealSoA::pt);
-
-                // prepare mean position values
-                const amrex::ParticleReal p_x_mean = p_x * p_w;
-                const amrex::ParticleReal p_y_mean = p_y * p_w;
-                const amrex::ParticleReal p_t_mean = p_t * p_w;
-
-                const amrex::ParticleReal p_px_mean = p_px * p_w;
-                const amrex::ParticleReal p_py_mean = p_py * p_w;
-                const amrex::ParticleReal p_pt_mean = p_pt * p_w;
-
-                return {p_w,
-                        p_x_mean, p_y_mean, p_t_mean,
-                        p_px_mean, p_py_mean, p_pt_mean,
-                        p_x, p_y, p_t, p_px, p_py, p_pt,
-                        p_x, p_y, p_t, p_px, p_py, p_pt};
-            },
-            reduce_ops_1
-        );
-
-        std::vector<amrex::ParticleReal> values_per_rank_1st(num_red_ops_1_sum);
-
-        /* contains in this order:
-         * w, x_mean, y_mean, t_mean
-         * px_mean, py_mean, pt_mean
-         */
-        amrex::constexpr_for<0, num_red_ops_1_sum> ([&](auto i) {
-            values_per_rank_1st[i] = amrex::get<i>(r1);
+                double const w = part_w[i];
+
+                double const x = v[0][i];
+                double const px = v[1][i];
+                double const y = v[2][i];
+                double const py = v[3][i];
+                double const t = v[4][i];
+                double const pt = v[5][i];
+
+                double const dx = x - shift[0];
+                double const dpx = px - shift[1];
+                double const dy = y - shift[2];
+                double const dpy = py - shift[3];
+                double const dt = t - shift[4];
+                double const dpt = pt - shift[5];
+
+                double const wx = w * dx;
+                double const wpx = w * dpx;
+                double const wy = w * dy;
+                double const wpy = w * dpy;
+                double const wt = w * dt;
+                double const wpt = w * dpt;
+
+                // upper triangle of the second moments, in the basis (x,px,y,py,t,pt)
+                return {w,
+                        wx, wpx, wy, wpy, wt, wpt,
+                        wx*dx, wx*dpx, wx*dy, wx*dpy, wx*dt, wx*dpt,
+                        wpx*dpx, wpx*dy, wpx*dpy, wpx*dt, wpx*dpt,
+                        wy*dy, wy*dpy, wy*dt, wy*dpt,
+                        wpy*dpy, wpy*dt, wpy*dpt,
+                        wt*dt, wt*dpt,
+                        wpt*dpt,
+                        x, px, y, py, t, pt,
+                        x, px, y, py, t, pt};
+            });
+
+        ReduceTuple const r = reduce_data.value(reduce_ops);
+        std::array<double, moments_size> sums;
+        amrex::constexpr_for<0, moments_size> ([&](auto i) {
+            sums[i] = amrex::get<i>(r);
         });
 
-        // reduced sum over mpi ranks (allreduce)
-        amrex::ParallelAllReduce::Sum(
-            values_per_rank_1st.data(),
-            values_per_rank_1st.size(),
-            amrex::ParallelDescriptor::Communicator()
-        );
-
-        amrex::ParticleReal const w_sum   = values_per_rank_1st.at(0);
-        amrex::ParticleReal const x_mean  = values_per_rank_1st.at(1) /= w_sum;
-        amrex::ParticleReal const y_mean  = values_per_rank_1st.at(2) /= w_sum;
-        amrex::ParticleReal const t_mean  = values_per_rank_1st.at(3) /= w_sum;
-        amrex::ParticleReal const px_mean = values_per_rank_1st.at(4) /= w_sum;
-        amrex::ParticleReal const py_mean = values_per_rank_1st.at(5) /= w_sum;
-        amrex::ParticleReal const pt_mean = values_per_rank_1st.at(6) /= w_sum;
-
-        std::vector<amrex::ParticleReal> values_per_rank_min(num_red_ops_1_min);
-
-        /* contains in this order:
-         * x_min, y_min, t_min
-         * px_min, py_min, pt_min
-         */
-        amrex::constexpr_for<0, num_red_ops_1_min> ([&](auto i) {
-            constexpr std::size_t idx = i + num_red_ops_1_sum;
-            values_per_rank_min[i] = amrex::get<idx>(r1);
-        });
+        return moments_from_sums(sums.data(), shift);
+    }
 
-        std::vector<amrex::ParticleReal> values_per_rank_max(num_red_ops_1_max);
+    void
+    merge_moments (double const * AMREX_RESTRICT in, double * AMREX_RESTRICT inout)
+    {
+        for (int k = 0; k < 6; ++k) {
+            inout[moments_min + k] = std::min(inout[moments_min + k], in[moments_min + k]);
+            inout[moments_max + k] = std::max(inout[moments_max + k], in[moments_max + k]);
+        }
+
+        double const wa = inout[0];
+        double const wb = in[0];
+        if (wb == 0.0) { return; }
+        if (wa == 0.0) {
+            std::copy(in, in + moments_min, inout);
+            return;
+        }
+
+        // pairwise update of Chan, Golub & LeVeque (1979)
+        double const w = wa + wb;
+        double const f = wa * wb / w;
+        std::array<double, 6> delta;
+        for (int k = 0; k < 6; ++k) {
+            delta[k] = in[1 + k] - inout[1 + k];
+        }
+        int n = 7;
+        for (int i = 0; i < 6; ++i) {
+            for (int j = i; j < 6; ++j) {
+                inout[n] += in[n] + delta[i] * delta[j] * f;
+                ++n;
+            }
+        }
+        for (int k = 0; k < 6; ++k) {
+            inout[1 + k] += delta[k] * wb / w;
+        }
+        inout[0] = w;
+    }
 
-        /* contains in this order:
-         * x_max, y_max, t_max
-         * px_max, py_max, pt_max
-         */
-        amrex::constexpr_for<0, num_red_ops_1_max> ([&](auto i) {
-            constexpr std::size_t idx = i + num_red_ops_1_sum + num_red_ops_1_min;
-            values_per_rank_max[i] = amrex::get<idx>(r1);
-        });
+#ifdef AMREX_USE_MPI
+namespace
+{
+    /** MPI reduction operator: merge blocks of moments_size doubles */
+    void
+    mpi_merge_moments (void * in, void * inout, int * len, MPI_Datatype * /* dtype */)
+    {
+        auto const * a = static_cast<double const *>(in);
+        auto * b = static_cast<double *>(inout);
+        for (int k = 0; k < *len; ++k) {
+            merge_moments(a + k * moments_size, b + k * moments_size);
+        }
+    }
 
-        // reduced sum over mpi ranks (allreduce)
-        amrex::ParallelAllReduce::Min(
-                values_per_rank_min.data(),
-                values_per_rank_min.size(),
-                amrex::ParallelDescriptor::Communicator()
-        );
-
-        // reduced sum over mpi ranks (allreduce)
-        amrex::ParallelAllReduce::Max(
-                values_per_rank_max.data(),
-                values_per_rank_max.size(),
-                amrex::ParallelDescriptor::Communicator()
-        );
-
-        /* The variable below needs to be static to work around an MSVC bug
-         * https://stackoverflow.com/questions/55136414/constexpr-variable-captured-inside-lambda-loses-its-constexpr-ness
-         */
-        // number of reduction operations in second concurrent batch
-        static constexpr std::size_t num_red_ops_2 = 14;
-        // prepare reduction operations for calculation of mean square and correlation values
-        amrex::TypeMultiplier<amrex::ReduceOps, amrex::ReduceOpSum[num_red_ops_2]> reduce_ops_2;
-        using ReducedDataT2 = amrex::TypeMultiplier<amrex::ReduceData, amrex::ParticleReal[num_red_ops_2]>;
-
-        auto r2 = amrex::ParticleReduce<ReducedDataT2>(
-                pc,
-                [=] AMREX_GPU_DEVICE(const PType& p) noexcept
-            -> ReducedDataT2::Type
-            {
-                // access SoA particle momentum data and weighting
-                const amrex::ParticleReal p_w = p.rdata(RealSoA::w);
-                const amrex::ParticleReal p_px = p.rdata(RealSoA::px);
-                const amrex::ParticleReal p_py = p.rdata(RealSoA::py);
-                const amrex::ParticleReal p_pt = p.rdata(RealSoA::pt);
-                // access position data
-                const amrex::ParticleReal p_x = p.rdata(RealSoA::x);
-                const amrex::ParticleReal p_y = p.rdata(RealSoA::y);
-                const amrex::ParticleReal p_t = p.rdata(RealSoA::t);
-                // prepare mean square for positions
-                const amrex::ParticleReal p_x_ms = (p_x-x_mean)*(p_x-x_mean)*p_w;
-                const amrex::ParticleReal p_y_ms = (p_y-y_mean)*(p_y-y_mean)*p_w;
-                const amrex::ParticleReal p_t_ms = (p_t-t_mean)*(p_t-t_mean)*p_w;
-                // prepare mean square for momenta
-                const amrex::ParticleReal p_px_ms = (p_px-px_mean)*(p_px-px_mean)*p_w;
-                const amrex::ParticleReal p_py_ms = (p_py-py_mean)*(p_py-py_mean)*p_w;
-                const amrex::ParticleReal p_pt_ms = (p_pt-pt_mean)*(p_pt-pt_mean)*p_w;
-                // prepare position-momentum correlations
-                const amrex::ParticleReal p_xpx = (p_x-x_mean)*(p_px-px_mean)*p_w;
-                const amrex::ParticleReal p_ypy = (p_y-y_mean)*(p_py-py_mean)*p_w;
-                const amrex::ParticleReal p_tpt = (p_t-t_mean)*(p_pt-pt_mean)*p_w;
-                // prepare correlations for dispersion
-                const amrex::ParticleReal p_xpt = (p_x-x_mean)*(p_pt-pt_mean)*p_w;
-                const amrex::ParticleReal p_pxpt = (p_px-px_mean)*(p_pt-pt_mean)*p_w;
-                const amrex::ParticleReal p_ypt = (p_y-y_mean)*(p_pt-pt_mean)*p_w;
-                const amrex::ParticleReal p_pypt = (p_py-py_mean)*(p_pt-pt_mean)*p_w;
-
-
-                const amrex::ParticleReal p_charge = q_C*p_w;
-
-                return {p_x_ms, p_y_ms, p_t_ms,
-                        p_px_ms, p_py_ms, p_pt_ms,
-                        p_xpx, p_ypy, p_tpt,
-                        p_xpt, p_pxpt, p_ypt, p_pypt,
-                        p_charge};
-            },
-                reduce_ops_2
-        );
-
-        std::vector<amrex::ParticleReal> values_per_rank_2nd(num_red_ops_2);
-
-        /* contains in this order:
-         * x_ms, y_ms, t_ms
-         * px_ms, py_ms, pt_ms,
-         * xpx, ypy, tpt,
-         * p_xpt, p_pxpt, p_ypt, p_pypt,
-         * charge
-         */
-        amrex::constexpr_for<0, num_red_ops_2> ([&](auto i) {
-            values_per_rank_2nd[i] = amrex::get<i>(r2);
-        });
+    /** MPI datatype and operator to merge moments, created on first use */
+    struct MomentsMPI
+    {
+        MPI_Datatype dtype = MPI_DATATYPE_NULL;
+        MPI_Op op = MPI_OP_NULL;
+    };
+
+    MomentsMPI &
+    moments_mpi ()
+    {
+        static MomentsMPI m;
+        if (m.op == MPI_OP_NULL) {
+            MPI_Type_contiguous(moments_size, MPI_DOUBLE, &m.dtype);
+            MPI_Type_commit(&m.dtype);
+            MPI_Op_create(&mpi_merge_moments, 1, &m.op);
+
+            amrex::ExecOnFinalize([]() {
+                MPI_Op_free(&m.op);
+                MPI_Type_free(&m.dtype);
+                m.op = MPI_OP_NULL;
+                m.dtype = MPI_DATATYPE_NULL;
+            });
+        }
+        return m;
+    }
+} // namespace
+#endif
 
-        // reduced sum over mpi ranks (allreduce)
-        amrex::ParallelAllReduce::Sum(
-            values_per_rank_2nd.data(),
-            values_per_rank_2nd.size(),
-            amrex::ParallelDescriptor::Communicator()
-        );
-
-        // minimum values
-        amrex::ParticleReal const x_min = values_per_rank_min.at(0);
-        amrex::ParticleReal const y_min = values_per_rank_min.at(1);
-        amrex::ParticleReal const t_min = values_per_rank_min.at(2);
-        amrex::ParticleReal const px_min = values_per_rank_min.at(3);
-        amrex::ParticleReal const py_min = values_per_rank_min.at(4);
-        amrex::ParticleReal const pt_min = values_per_rank_min.at(5);
-        // maximum values
-        amrex::ParticleReal const x_max = values_per_rank_max.at(0);
-        amrex::ParticleReal const y_max = values_per_rank_max.at(1);
-        amrex::ParticleReal const t_max = values_per_rank_max.at(2);
-        amrex::ParticleReal const px_max = values_per_rank_max.at(3);
-        amrex::ParticleReal const py_max = values_per_rank_max.at(4);
-        amrex::ParticleReal const pt_max = values_per_rank_max.at(5);
+    void
+    allreduce_moments (std::array<double, moments_size> & moments)
+    {
+        allreduce_moments(moments.data(), 1);
+    }
+
+    void
+    allreduce_moments (double * moments, int count)
+    {
+#ifdef AMREX_USE_MPI
+        if (amrex::ParallelDescriptor::NProcs() > 1) {
+            MomentsMPI const & m = moments_mpi();
+            MPI_Allreduce(MPI_IN_PLACE, moments, count, m.dtype, m.op,
+                          amrex::ParallelDescriptor::Communicator());
+        }
+#else
+        amrex::ignore_unused(moments, count);
+#endif
+    }
+
+    std::array<amrex::ParticleReal, 3>
+    eigen_emittances (CovarianceMatrix const & cm)
+    {
+        // The eigenvalues of A = cm * J, with the symplectic form J in the
+        // basis (x,px,y,py,t,pt), are +/- i*e_k with the eigen-emittances e_k.
+        // Thus, the eigenvalues of A^2 are -e_k^2, each twice. The power sums
+        // of the e_k^2 follow from the traces of A^2, A^4 and A^6.
+        std::array<std::array<double, 6>, 6> a;
+        for (int i = 0; i < 6; ++i) {
+            for (int j = 0; j < 6; j += 2) {
+                // (cm * J)(i, j) = -cm(i, j+1), (cm * J)(i, j+1) = cm(i, j)
+                a[i][j] = -double(cm(i + 1, j + 2));
+                a[i][j + 1] = double(cm(i + 1, j + 1));
+            }
+        }
+        auto const mul = [](auto const & l, auto const & r) {
+            std::array<std::array<double, 6>, 6> p{};
+            for (int i = 0; i < 6; ++i) {
+                for (int k = 0; k < 6; ++k) {
+                    for (int j = 0; j < 6; ++j) {
+                        p[i][j] += l[i][k] * r[k][j];
+                    }
+                }
+            }
+            return p;
+        };
+        auto const trace = [](auto const & m) {
+            double tr = 0.0;
+            for (int i = 0; i < 6; ++i) { tr += m[i][i]; }
+            return tr;
+        };
+        auto const a2 = mul(a, a);
+        auto const a4 = mul(a2, a2);
+        auto const a6 = mul(a4, a2);
+        double const p1 = -trace(a2) / 2.0;
+        double const p2 = trace(a4) / 2.0;
+        double const p3 = -trace(a6) / 2.0;
+
+        // elementary symmetric polynomials (Newton's identities)
+        double const e1 = p1;
+        double const e2 = (e1 * p1 - p2) / 2.0;
+        double const e3 = (e2 * p1 - e1 * p2 + p3) / 3.0;
+
+        // the e_k^2 are the real roots of l^3 - e1 l^2 + e2 l - e3 = 0
+        double const shift = e1 / 3.0;
+        double const p = e2 - e1 * e1 / 3.0;
+        double const q = -2.0 * e1 * e1 * e1 / 27.0 + e1 * e2 / 3.0 - e3;
+        std::array<double, 3> lambda = {shift, shift, shift};
+        if (p < 0.0) {
+            double const m = 2.0 * std::sqrt(-p / 3.0);
+            double const c = std::clamp(3.0 * q / (p * m), -1.0, 1.0);
+            double const phi = std::acos(c) / 3.0;
+            for (int k = 0; k < 3; ++k) {
+                lambda[k] = shift + m * std::cos(phi - 2.0 * ablastr::constant::math::pi * k / 3.0);
+            }
+        }
+        std::sort(lambda.begin(), lambda.end());
+
+        std::array<amrex::ParticleReal, 3> emittances;
+        for (int k = 0; k < 3; ++k) {
+            emittances[k] = amrex::ParticleReal(std::sqrt(std::max(lambda[k], 0.0)));
+        }
+        return emittances;
+    }
+
+    std::unordered_map<std::string, amrex::ParticleReal>
+    characteristics_from_moments (
+        amrex::Array1D<amrex::ParticleReal, 1, 6> const & mean,
+        amrex::Array1D<amrex::ParticleReal, 1, 6> const & min,
+        amrex::Array1D<amrex::ParticleReal, 1, 6> const & max,
+        CovarianceMatrix const & cm,
+        amrex::ParticleReal charge
+    )
+    {
         // mean square and correlation values
-        amrex::ParticleReal const x_ms   = values_per_rank_2nd.at(0) /= w_sum;
-        amrex::ParticleReal const y_ms   = values_per_rank_2nd.at(1) /= w_sum;
-        amrex::ParticleReal const t_ms   = values_per_rank_2nd.at(2) /= w_sum;
-        amrex::ParticleReal const px_ms  = values_per_rank_2nd.at(3) /= w_sum;
-        amrex::ParticleReal const py_ms  = values_per_rank_2nd.at(4) /= w_sum;
-        amrex::ParticleReal const pt_ms  = values_per_rank_2nd.at(5) /= w_sum;
-        amrex::ParticleReal const xpx    = values_per_rank_2nd.at(6) /= w_sum;
-        amrex::ParticleReal const ypy    = values_per_rank_2nd.at(7) /= w_sum;
-        amrex::ParticleReal const tpt    = values_per_rank_2nd.at(8) /= w_sum;
-        amrex::ParticleReal const xpt    = values_per_rank_2nd.at(9) /= w_sum;
-        amrex::ParticleReal const pxpt   = values_per_rank_2nd.at(10) /= w_sum;
-        amrex::ParticleReal const ypt    = values_per_rank_2nd.at(11) /= w_sum;
-        amrex::ParticleReal const pypt   = values_per_rank_2nd.at(12) /= w_sum;
-        amrex::ParticleReal const charge = values_per_rank_2nd.at(13);
+        amrex::ParticleReal const x_ms   = cm(1,1);
+        amrex::ParticleReal const y_ms   = cm(3,3);
+        amrex::ParticleReal const t_ms   = cm(5,5);
+        amrex::ParticleReal const px_ms  = cm(2,2);
+        amrex::ParticleReal const py_ms  = cm(4,4);
+        amrex::ParticleReal const pt_ms  = cm(6,6);
+        amrex::ParticleReal const xpx    = cm(1,2);
+        amrex::ParticleReal const ypy    = cm(3,4);
+        amrex::ParticleReal const tpt    = cm(5,6);
+        amrex::ParticleReal const xpt    = cm(1,6);
+        amrex::ParticleReal const pxpt   = cm(2,6);
+        amrex::ParticleReal const ypt    = cm(3,6);
+        amrex::ParticleReal const pypt   = cm(4,6);
         // standard deviations of positions
         amrex::ParticleReal const sig_x = std::sqrt(x_ms);
         amrex::ParticleReal const sig_y = std::sqrt(y_ms);
@@ -284,27 +390,27 @@ namespace impactx::diagnostics
         amrex::ParticleReal const alpha_t = - tpt / emittance_t;
 
         std::unordered_map<std::string, amrex::ParticleReal> data;
-        data["x_mean"] = x_mean;
-        data["x_min"] = x_min;
-        data["x_max"] = x_max;
-        data["y_mean"] = y_mean;
-        data["y_min"] = y_min;
-        data["y_max"] = y_max;
-        data["t_mean"] = t_mean;
-        data["t_min"] = t_min;
-        data["t_max"] = t_max;
+        data["x_mean"] = mean(1);
+        data["x_min"] = min(1);
+        data["x_max"] = max(1);
+        data["y_mean"] = mean(3);
+        data["y_min"] = min(3);
+        data["y_max"] = max(3);
+        data["t_mean"] = mean(5);
+        data["t_min"] = min(5);
+        data["t_max"] = max(5);
         data["sig_x"] = sig_x;
         data["sig_y"] = sig_y;
         data["sig_t"] = sig_t;
-        data["px_mean"] = px_mean;
-        data["px_min"] = px_min;
-        data["px_max"] = px_max;
-        data["py_mean"] = py_mean;
-        data["py_min"] = py_min;
-        data["py_max"] = py_max;
-        data["pt_mean"] = pt_mean;
-        data["pt_min"] = pt_min;
-        data["pt_max"] = pt_max;
+        data["px_mean"] = mean(2);
+        data["px_min"] = min(2);
+        data["px_max"] = max(2);
+        data["py_mean"] = mean(4);
+        data["py_min"] = min(4);
+        data["py_max"] = max(4);
+        data["pt_mean"] = mean(6);
+        data["pt_min"] = min(6);
+        data["pt_max"] = max(6);
         data["sig_px"] = sig_px;
         data["sig_py"] = sig_py;
         data["sig_pt"] = sig_pt;
@@ -323,6 +429,89 @@ namespace impactx::diagnostics
         data["dispersion_py"] = dispersion_py;
         data["charge_C"] = charge;
 
+        // eigen-emittances from the full covariance matrix, invariant under linear symplectic maps
+        auto const eigen = eigen_emittances(cm);
+        data["emittance_1"] = eigen[0];
+        data["emittance_2"] = eigen[1];
+        data["emittance_3"] = eigen[2];
+
         return data;
     }
+} // namespace detail
+
+    BeamMoments
+    beam_moments (ImpactXParticleContainer const & pc)
+    {
+        BL_PROFILE("impactx::diagnostics::beam_moments");
+
+        // one pass over all particles: moments per tile, merged pairwise
+        std::array<double, detail::moments_size> moments = detail::empty_moments();
+
+        int const nLevel = pc.finestLevel();
+        for (int lev = 0; lev <= nLevel; ++lev)
+        {
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+            {
+                std::array<double, detail::moments_size> thread_moments = detail::empty_moments();
+                for (ImpactXParticleContainer::const_iterator pti(pc, lev); pti.isValid(); ++pti) {
+                    std::array<double, detail::moments_size> const tile = detail::tile_moments(pti);
+                    detail::merge_moments(tile.data(), thread_moments.data());
+                }
+#ifdef AMREX_USE_OMP
+#pragma omp critical (impactx_beam_moments)
+#endif
+                detail::merge_moments(thread_moments.data(), moments.data());
+            }
+        }
+
+        // merge the moments of all MPI ranks in one reduction (allreduce)
+        detail::allreduce_moments(moments);
+
+        BeamMoments bm;
+        bm.w_sum = amrex::ParticleReal(moments[0]);
+        bm.charge = pc.GetRefParticle().charge * bm.w_sum;
+        for (int i = 1; i < 7; ++i) {
+            bm.mean(i) = amrex::ParticleReal(moments[i]);
+            bm.min(i) = amrex::ParticleReal(moments[detail::moments_min + i - 1]);
+            bm.max(i) = amrex::ParticleReal(moments[detail::moments_max + i - 1]);
+        }
+        int n = 7;
+        for (int i = 1; i < 7; ++i) {
+            for (int j = i; j < 7; ++j) {
+                bm.cm(i, j) = bm.cm(j, i) = amrex::ParticleReal(moments[n] / moments[0]);
+                ++n;
+            }
+        }
+
+        return bm;
+    }
+
+    std::unordered_map<std::string, amrex::ParticleReal>
+    reduced_beam_characteristics (ImpactXParticleContainer const & pc)
+    {
+        BL_PROFILE("impactx::diagnostics::reduced_beam_characteristics");
+
+        BeamMoments const bm = beam_moments(pc);
+
+        return detail::characteristics_from_moments(bm.mean, bm.min, bm.max, bm.cm, bm.charge);
+    }
+
+    std::unordered_map<std::string, amrex::ParticleReal>
+    reduced_beam_characteristics (envelope::Envelope const & env, RefPart const & ref_part)
+    {
+        BL_PROFILE("impactx::diagnostics::reduced_beam_characteristics(envelope)");
+
+        // the envelope does not define the extent of the beam
+        amrex::Array1D<amrex::ParticleReal, 1, 6> undefined;
+        for (int i = 1; i < 7; ++i) {
+            undefined(i) = std::numeric_limits<amrex::ParticleReal>::quiet_NaN();
+        }
+
+        // same definition as for particles: charge of the reference particle times the number of real particles
+        amrex::ParticleReal const charge = ref_part.charge_qe() * env.m_bunch_charge;
+
+        return detail::characteristics_from_moments(env.m_mean, undefined, undefined, env.m_cm, charge);
+    }
 } // namespace impactx::diagnostics
@@ -0,0 +1,158 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell
+ * License: BSD-3-Clause-LBNL
+ */
+#include "SlicedBeamCharacteristics.H"
+
+#include "particles/wakefields/ChargeBinning.H"
+
+#include <ablastr/constant.H>
+
+#include <AMReX_BLProfiler.H>           // for TinyProfiler
+#include <AMReX_GpuQualifiers.H>        // for AMREX_GPU_DEVICE
+#include <AMReX_ParallelDescriptor.H>   // for ParallelDescriptor
+#include <AMReX_ParallelReduce.H>       // for ParallelAllReduce
+#include <AMReX_ParticleReduce.H>       // for ParticleReduce
+#include <AMReX_Reduce.H>               // for ReduceOps
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+
+namespace impactx::diagnostics
+{
+    std::vector<std::string> const &
+    sliced_beam_characteristics_names ()
+    {
+        static std::vector<std::string> const names = {
+            "t", "count", "charge_C", "current_A",
+            "x_mean", "y_mean", "px_mean", "py_mean", "pt_mean",
+            "sig_x", "sig_y", "sig_px", "sig_py", "sig_pt",
+            "emittance_x", "emittance_y"
+        };
+        return names;
+    }
+
+    std::unordered_map<std::string, std::vector<amrex::ParticleReal>>
+    sliced_beam_characteristics (ImpactXParticleContainer const & pc, int num_bins)
+    {
+        BL_PROFILE("impactx::diagnostics::sliced_beam_characteristics");
+
+        using namespace amrex::literals; // for _rt and _prt
+        using particles::wakefields::SliceSum;
+
+        if (num_bins < 1) {
+            throw std::runtime_error("sliced_beam_characteristics: the number of slices must be at least 1.");
+        }
+
+        // extent of the beam in t and its mean values, the shift of the slice moments
+        using PType = typename ImpactXParticleContainer::SuperParticleType;
+        using ReducedDataT = amrex::ReduceData<amrex::ParticleReal, amrex::ParticleReal,
+                                               double, double, double, double, double, double>;
+        amrex::ReduceOps<amrex::ReduceOpMin, amrex::ReduceOpMax,
+                         amrex::ReduceOpSum, amrex::ReduceOpSum, amrex::ReduceOpSum,
+                         amrex::ReduceOpSum, amrex::ReduceOpSum, amrex::ReduceOpSum> reduce_ops;
+        auto r = amrex::ParticleReduce<ReducedDataT>(
+            pc,
+            [=] AMREX_GPU_DEVICE(const PType& p) noexcept -> ReducedDataT::Type
+            {
+                amrex::ParticleReal const t = p.rdata(RealSoA::t);
+                double const w = p.rdata(RealSoA::w);
+                return {t, t,
+                        w,
+                        w * p.rdata(RealSoA::x), w * p.rdata(RealSoA::y),
+                        w * p.rdata(RealSoA::px), w * p.rdata(RealSoA::py), w * p.rdata(RealSoA::pt)};
+            },
+            reduce_ops
+        );
+        amrex::ParticleReal t_min = amrex::get<0>(r);
+        amrex::ParticleReal t_max = amrex::get<1>(r);
+        amrex::ParallelAllReduce::Min(t_min, amrex::ParallelDescriptor::Communicator());
+        amrex::ParallelAllReduce::Max(t_max, amrex::ParallelDescriptor::Communicator());
+
+        std::array<double, 6> beam_sums = {amrex::get<2>(r), amrex::get<3>(r), amrex::get<4>(r),
+                                           amrex::get<5>(r), amrex::get<6>(r), amrex::get<7>(r)};
+        amrex::ParallelAllReduce::Sum(beam_sums.data(), static_cast<int>(beam_sums.size()),
+                                      amrex::ParallelDescriptor::Communicator());
+        amrex::GpuArray<double, 5> shift = {0.0, 0.0, 0.0, 0.0, 0.0};
+        if (beam_sums[0] > 0.0) {
+            for (int k = 0; k < 5; ++k) { shift[k] = beam_sums[1 + k] / beam_sums[0]; }
+        }
+
+        // empty beam or all particles at the same t: slices of unit width around it
+        if (t_min > t_max) { t_min = t_max = 0.0_prt; }
+        if (!(t_max > t_min)) {
+            t_min -= 0.5_prt * amrex::ParticleReal(num_bins);
+            t_max += 0.5_prt * amrex::ParticleReal(num_bins);
+        }
+
+        // widen the slices slightly, so that the particles at t_max are in the last slice
+        auto const bin_min = amrex::Real(t_min);
+        amrex::Real const bin_size = amrex::Real(t_max - t_min) / amrex::Real(num_bins)
+            * (1.0_rt + 4.0_rt * std::numeric_limits<amrex::Real>::epsilon());
+
+        // per-slice moments: one pass over the particles and one MPI reduction
+        std::vector<double> sums;
+        particles::wakefields::DepositMoments1D(pc, sums, bin_min, bin_size, num_bins, shift);
+        amrex::ParallelAllReduce::Sum(sums.data(), static_cast<int>(sums.size()),
+                                      amrex::ParallelDescriptor::Communicator());
+
+        std::unordered_map<std::string, std::vector<amrex::ParticleReal>> data;
+        for (auto const & name : sliced_beam_characteristics_names()) {
+            data[name].resize(num_bins);
+        }
+
+        double const charge = pc.GetRefParticle().charge;
+        double const c = ablastr::constant::SI::c;
+        for (int b = 0; b < num_bins; ++b)
+        {
+            double const * s = sums.data() + std::size_t(b) * SliceSum::nsums;
+            double const w = s[SliceSum::w];
+
+            // mean values and second central moments of this slice, from the shifted sums
+            auto shifted_mean = [=](int k) { return w > 0.0 ? s[k] / w : 0.0; };
+            auto mean = [=](int k) { return w > 0.0 ? shift[k - SliceSum::x] + shifted_mean(k) : 0.0; };
+            auto cov = [=](int kk, int k1, int k2) {
+                return w > 0.0 ? s[kk] / w - shifted_mean(k1) * shifted_mean(k2) : 0.0;
+            };
+            double const x_ms = std::max(cov(SliceSum::xx, SliceSum::x, SliceSum::x), 0.0);
+            double const px_ms = std::max(cov(SliceSum::pxpx, SliceSum::px, SliceSum::px), 0.0);
+            double const xpx = cov(SliceSum::xpx, SliceSum::x, SliceSum::px);
+            double const y_ms = std::max(cov(SliceSum::yy, SliceSum::y, SliceSum::y), 0.0);
+            double const py_ms = std::max(cov(SliceSum::pypy, SliceSum::py, SliceSum::py), 0.0);
+            double const ypy = cov(SliceSum::ypy, SliceSum::y, SliceSum::py);
+            double const pt_ms = std::max(cov(SliceSum::ptpt, SliceSum::pt, SliceSum::pt), 0.0);
+
+            // the t-coordinate is c times the arrival time: a slice passes within bin_size / c
+            double const slice_charge = charge * w;
+
+            data["t"][b] = amrex::ParticleReal(bin_min + (b + 0.5) * bin_size);
+            data["count"][b] = amrex::ParticleReal(s[SliceSum::count]);
+            data["charge_C"][b] = amrex::ParticleReal(slice_charge);
+            data["current_A"][b] = amrex::ParticleReal(slice_charge * c / bin_size);
+            data["x_mean"][b] = amrex::ParticleReal(mean(SliceSum::x));
+            data["y_mean"][b] = amrex::ParticleReal(mean(SliceSum::y));
+            data["px_mean"][b] = amrex::ParticleReal(mean(SliceSum::px));
+            data["py_mean"][b] = amrex::ParticleReal(mean(SliceSum::py));
+            data["pt_mean"][b] = amrex::ParticleReal(mean(SliceSum::pt));
+            data["sig_x"][b] = amrex::ParticleReal(std::sqrt(x_ms));
+            data["sig_y"][b] = amrex::ParticleReal(std::sqrt(y_ms));
+            data["sig_px"][b] = amrex::ParticleReal(std::sqrt(px_ms));
+            data["sig_py"][b] = amrex::ParticleReal(std::sqrt(py_ms));
+            data["sig_pt"][b] = amrex::ParticleReal(std::sqrt(pt_ms));
+            data["emittance_x"][b] = amrex::ParticleReal(std::sqrt(std::max(x_ms * px_ms - xpx * xpx, 0.0)));
+            data["emittance_y"][b] = amrex::ParticleReal(std::sqrt(std::max(y_ms * py_ms - ypy * ypy, 0.0)));
+        }
+
+        return data;
+    }
+
+} // namespace impactx::diagnostics
@@ -0,0 +1,214 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+
+#include "Plugin.H"
+#include "particles/PushAll.H"
+
+#if !defined(_WIN32)
+#   include <dlfcn.h>
+#endif
+
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+
+namespace impactx
+{
+namespace detail
+{
+    /** Load a plugin library once and return its description
+     *
+     * @param library path of the shared library
+     * @return the description of the plugin (throws on errors)
+     */
+    impactx_plugin const *
+    load_plugin (std::string const & library)
+    {
+        // loaded libraries stay loaded: their functions are used until the end of the program
+        static std::map<std::string, impactx_plugin const *> plugins;
+        static std::mutex plugins_mutex;
+        std::lock_guard<std::mutex> const lock(plugins_mutex);
+
+        auto const it = plugins.find(library);
+        if (it != plugins.end()) { return it->second; }
+
+#if defined(_WIN32)
+        throw std::runtime_error("Plugin: loading element plugins is not supported on Windows: " + library);
+#else
+        void * handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (handle == nullptr) {
+            char const * error = dlerror();
+            throw std::runtime_error("Plugin: cannot load " + library + ": " + (error ? error : "unknown error"));
+        }
+
+        using RegisterFunction = impactx_plugin const * (*)();
+        auto const register_plugin = reinterpret_cast<RegisterFunction>(dlsym(handle, IMPACTX_PLUGIN_REGISTER));
+        if (register_plugin == nullptr) {
+            dlclose(handle);
+            throw std::runtime_error("Plugin: " + library + " does not export " + IMPACTX_PLUGIN_REGISTER);
+        }
+
+        impactx_plugin const * plugin = register_plugin();
+        if (plugin == nullptr || plugin->abi_version != IMPACTX_PLUGIN_ABI_VERSION) {
+            dlclose(handle);
+            throw std::runtime_error("Plugin: " + library + " was built for another plugin ABI version, expected " +
+                                     std::to_string(IMPACTX_PLUGIN_ABI_VERSION));
+        }
+        if (plugin->real_size != int(sizeof(amrex::ParticleReal))) {
+            dlclose(handle);
+            throw std::runtime_error("Plugin: " + library + " was built for another precision of the particle data, "
+                                     "set IMPACTX_PLUGIN_REAL to the ParticleReal type of ImpactX");
+        }
+
+        plugins[library] = plugin;
+        return plugin;
+#endif
+    }
+
+    /** Copy the reference particle to its plugin representation */
+    impactx_plugin_refpart
+    to_plugin (RefPart const & ref_part)
+    {
+        return {ref_part.s, ref_part.x, ref_part.y, ref_part.z, ref_part.t,
+                ref_part.px, ref_part.py, ref_part.pz, ref_part.pt,
+                ref_part.mass, ref_part.charge, ref_part.sedge};
+    }
+} // namespace detail
+
+    Plugin::Plugin (
+        std::string const & library,
+        std::string const & element,
+        amrex::ParticleReal ds,
+        std::map<std::string, double> const & parameters,
+        int nslice
+    )
+      : Thick(ds, nslice),
+        m_id(PluginData::next_id)
+    {
+        // next created plugin element has another id for its data
+        PluginData::next_id++;
+
+        impactx_plugin const * plugin = detail::load_plugin(library);
+
+        impactx_plugin_element const * plugin_element = nullptr;
+        if (element.empty() && plugin->num_elements == 1) {
+            plugin_element = plugin->elements;
+        }
+        for (int i = 0; i < plugin->num_elements && plugin_element == nullptr; ++i) {
+            if (element == plugin->elements[i].name) {
+                plugin_element = plugin->elements + i;
+            }
+        }
+        if (plugin_element == nullptr) {
+            std::string known;
+            for (int i = 0; i < plugin->num_elements; ++i) {
+                known += std::string(" ") + plugin->elements[i].name;
+            }
+            throw std::runtime_error("Plugin: element '" + element + "' not found in " + library +
+                                     ", available:" + known);
+        }
+
+        std::vector<char const *> names;
+        std::vector<double> values;
+        for (auto const & [name, value] : parameters) {
+            names.push_back(name.c_str());
+            values.push_back(value);
+        }
+        void * state = plugin_element->create(double(ds), int(names.size()), names.data(), values.data());
+        if (state == nullptr) {
+            throw std::runtime_error("Plugin: element '" + std::string(plugin_element->name) +
+                                     "' of " + library + " rejected its parameters");
+        }
+
+        PluginData::instances[m_id] = {library, plugin_element, state};
+    }
+
+    void
+    Plugin::operator() (
+        ImpactXParticleContainer & pc,
+        int step
+    ) const
+    {
+        // plugins guarantee that tiles can be pushed concurrently
+        push_all(pc, *this, step);
+    }
+
+    void
+    Plugin::operator() (
+        ImpactXParticleContainer::iterator & pti,
+        RefPart & ref_part
+    ) const
+    {
+        PluginData::Instance const & instance = PluginData::instances.at(m_id);
+
+        const long np = pti.numParticles();
+        auto & soa_real = pti.GetStructOfArrays().GetRealData();
+        uint64_t * const part_idcpu = pti.GetStructOfArrays().GetIdCPUData().dataPtr();
+
+        impactx_plugin_refpart const ref = detail::to_plugin(ref_part);
+        instance.element->push_particles(
+            instance.state, np,
+            soa_real[RealSoA::x].dataPtr(),
+            soa_real[RealSoA::y].dataPtr(),
+            soa_real[RealSoA::t].dataPtr(),
+            soa_real[RealSoA::px].dataPtr(),
+            soa_real[RealSoA::py].dataPtr(),
+            soa_real[RealSoA::pt].dataPtr(),
+            part_idcpu,
+            &ref,
+            double(m_ds / nslice())
+        );
+    }
+
+    void
+    Plugin::operator() (RefPart & ref_part) const
+    {
+        PluginData::Instance const & instance = PluginData::instances.at(m_id);
+
+        impactx_plugin_refpart ref = detail::to_plugin(ref_part);
+        instance.element->push_reference(instance.state, &ref, double(m_ds / nslice()));
+
+        ref_part.s = ref.s;
+        ref_part.x = ref.x;
+        ref_part.y = ref.y;
+        ref_part.z = ref.z;
+        ref_part.t = ref.t;
+        ref_part.px = ref.px;
+        ref_part.py = ref.py;
+        ref_part.pz = ref.pz;
+        ref_part.pt = ref.pt;
+    }
+
+    std::string
+    Plugin::library () const
+    {
+        return PluginData::instances.at(m_id).library;
+    }
+
+    std::string
+    Plugin::element () const
+    {
+        return PluginData::instances.at(m_id).element->name;
+    }
+
+    void
+    Plugin::finalize ()
+    {
+        // remove from unique data map
+        auto const it = PluginData::instances.find(m_id);
+        if (it != PluginData::instances.end()) {
+            it->second.element->destroy(it->second.state);
+            PluginData::instances.erase(it);
+        }
+    }
+
+} // namespace impactx
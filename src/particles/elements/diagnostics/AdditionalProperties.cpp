@@ -92,7 +92,7 @@ namespace impactx::diagnostics
             // loop over all particle boxes
             using ParIt = ImpactXParticleContainer::iterator;
             for (ParIt pti(pc, lev); pti.isValid(); ++pti) {
-                const int np = pti.numParticles();
+                const long np = pti.numParticles();
 
                 // preparing access to particle data: SoA of Reals
                 auto & soa = pti.GetStructOfArrays();
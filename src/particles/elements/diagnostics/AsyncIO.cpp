@@ -0,0 +1,255 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "AsyncIO.H"
+
+#include <ablastr/warn_manager/WarnManager.H>
+
+#include <AMReX.H>
+#include <AMReX_GpuContainers.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_ParmParse.H>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+namespace impactx::diagnostics::async_io
+{
+namespace
+{
+    /** Staging buffer in pinned host memory: fast device-to-host copies */
+    using Buffer = amrex::Gpu::PinnedVector<char>;
+
+    /** The I/O thread, its task queue and the staging buffer pool */
+    struct State
+    {
+        std::thread thread; ///< the I/O thread, started on the first task
+        std::mutex mutex; ///< guards all members below
+        std::condition_variable task_queued; ///< a task was queued or the thread shall stop
+        std::condition_variable task_done; ///< a task finished and released its buffer
+
+        std::deque<std::pair<std::function<void()>, int>> queue; ///< pending tasks and their buffers
+        bool busy = false; ///< the I/O thread runs a task
+        bool stop = false; ///< stop the I/O thread after the pending tasks
+        std::exception_ptr error; ///< first exception of a task
+
+        std::vector<std::unique_ptr<Buffer>> buffers; ///< staging buffer pool
+        std::vector<bool> buffer_free; ///< staging buffers not in use
+
+#if defined(AMREX_USE_MPI)
+        MPI_Comm comm = MPI_COMM_NULL; ///< duplicate of the AMReX communicator for openPMD
+#endif
+    };
+
+    State & state ()
+    {
+        static State s;
+        return s;
+    }
+
+    /** Does MPI allow calls from the I/O thread? */
+    bool
+    thread_multiple ()
+    {
+#if defined(AMREX_USE_MPI)
+        int provided = MPI_THREAD_SINGLE;
+        MPI_Query_thread(&provided);
+        return provided >= MPI_THREAD_MULTIPLE;
+#else
+        return true;
+#endif
+    }
+
+    /** Main loop of the I/O thread: run tasks until stopped */
+    void
+    worker ()
+    {
+        State & s = state();
+        while (true)
+        {
+            std::pair<std::function<void()>, int> item;
+            bool skip = false;
+            {
+                std::unique_lock<std::mutex> lock(s.mutex);
+                s.task_queued.wait(lock, [&s]() { return s.stop || !s.queue.empty(); });
+                if (s.queue.empty()) { return; }  // stopped and all tasks done
+                item = std::move(s.queue.front());
+                s.queue.pop_front();
+                s.busy = true;
+                // after an error, the series are in an unknown state: only release the buffers
+                skip = static_cast<bool>(s.error);
+            }
+
+            if (!skip) {
+                try {
+                    item.first();
+                } catch (...) {
+                    std::lock_guard<std::mutex> const lock(s.mutex);
+                    s.error = std::current_exception();
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> const lock(s.mutex);
+                if (item.second >= 0) { s.buffer_free.at(item.second) = true; }
+                s.busy = false;
+            }
+            s.task_done.notify_all();
+        }
+    }
+} // namespace
+
+    bool
+    enabled ()
+    {
+        bool async_io = false;
+        amrex::ParmParse("diag").queryAdd("async_io", async_io);
+        if (!async_io) { return false; }
+
+        if (!thread_multiple()) {
+            ablastr::warn_manager::WMRecordWarning(
+                "Diagnostics",
+                "diag.async_io needs MPI_THREAD_MULTIPLE, which MPI does not provide. "
+                "BeamMonitor output is written synchronously.",
+                ablastr::warn_manager::WarnPriority::medium
+            );
+            return false;
+        }
+        return true;
+    }
+
+#if defined(AMREX_USE_MPI)
+    MPI_Comm
+    communicator ()
+    {
+        if (!thread_multiple()) { return amrex::ParallelDescriptor::Communicator(); }
+
+        State & s = state();
+        if (s.comm == MPI_COMM_NULL) {
+            MPI_Comm_dup(amrex::ParallelDescriptor::Communicator(), &s.comm);
+        }
+        return s.comm;
+    }
+#endif
+
+    void
+    run (std::function<void()> task, int buffer)
+    {
+        State & s = state();
+
+        if (!enabled()) {
+            drain();
+            task();
+            if (buffer >= 0) {
+                std::lock_guard<std::mutex> const lock(s.mutex);
+                s.buffer_free.at(buffer) = true;
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> const lock(s.mutex);
+            if (s.error) {
+                if (buffer >= 0) { s.buffer_free.at(buffer) = true; }
+                std::rethrow_exception(std::exchange(s.error, nullptr));
+            }
+            if (!s.thread.joinable()) {
+                s.stop = false;
+                s.thread = std::thread(worker);
+            }
+            s.queue.emplace_back(std::move(task), buffer);
+        }
+        s.task_queued.notify_one();
+    }
+
+    int
+    acquire_buffer (std::size_t num_bytes)
+    {
+        State & s = state();
+        std::unique_lock<std::mutex> lock(s.mutex);
+
+        if (s.buffers.empty()) {
+            int num_buffers = 2;
+            amrex::ParmParse("diag").queryAdd("async_io_buffers", num_buffers);
+            AMREX_ALWAYS_ASSERT_WITH_MESSAGE(num_buffers >= 1,
+                                             "diag.async_io_buffers must be positive.");
+            for (int i = 0; i < num_buffers; ++i) {
+                s.buffers.push_back(std::make_unique<Buffer>());
+            }
+            s.buffer_free.assign(num_buffers, true);
+        }
+
+        // back-pressure: wait until the I/O thread released a buffer
+        s.task_done.wait(lock, [&s]() {
+            return std::find(s.buffer_free.begin(), s.buffer_free.end(), true) != s.buffer_free.end();
+        });
+        auto const buffer = static_cast<int>(
+            std::find(s.buffer_free.begin(), s.buffer_free.end(), true) - s.buffer_free.begin());
+        s.buffer_free.at(buffer) = false;
+        Buffer & b = *s.buffers.at(buffer);
+        lock.unlock();
+
+        // only this thread resizes the buffers, and only while they are not in use
+        if (b.size() < num_bytes) { b.resize(num_bytes); }
+        return buffer;
+    }
+
+    char *
+    buffer_data (int buffer)
+    {
+        State & s = state();
+        std::lock_guard<std::mutex> const lock(s.mutex);
+        return s.buffers.at(buffer)->data();
+    }
+
+    void
+    drain ()
+    {
+        State & s = state();
+        std::unique_lock<std::mutex> lock(s.mutex);
+        s.task_done.wait(lock, [&s]() { return s.queue.empty() && !s.busy; });
+        if (s.error) {
+            std::rethrow_exception(std::exchange(s.error, nullptr));
+        }
+    }
+
+    void
+    shutdown ()
+    {
+        State & s = state();
+        {
+            std::lock_guard<std::mutex> const lock(s.mutex);
+            s.stop = true;
+        }
+        s.task_queued.notify_one();
+        if (s.thread.joinable()) { s.thread.join(); }
+
+        std::lock_guard<std::mutex> const lock(s.mutex);
+        s.stop = false;
+        s.busy = false;
+        s.error = nullptr;
+        s.buffers.clear();
+        s.buffer_free.clear();
+#if defined(AMREX_USE_MPI)
+        if (s.comm != MPI_COMM_NULL) {
+            MPI_Comm_free(&s.comm);
+            s.comm = MPI_COMM_NULL;
+        }
+#endif
+    }
+
+} // namespace impactx::diagnostics::async_io
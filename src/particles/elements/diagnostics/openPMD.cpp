@@ -9,30 +9,56 @@
  */
 
 #include "openPMD.H"
+#include "AsyncIO.H"
 #include "ImpactXVersion.H"
 #include "particles/ImpactXParticleContainer.H"
+#include "particles/diagnostics/PhaseSpaceHistogram.H"
+#include "particles/distribution/Random.H"
 #include "particles/diagnostics/ReducedBeamCharacteristics.H"
 
 #include <AMReX.H>
 #include <AMReX_BLProfiler.H>
+#include <AMReX_GpuContainers.H>
+#include <AMReX_GpuLaunch.H>
+#include <AMReX_GpuQualifiers.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_Particle.H>
 #include <AMReX_REAL.H>
 #include <AMReX_ParmParse.H>
+#include <AMReX_Utility.H>
 
 #ifdef ImpactX_USE_OPENPMD
+#   include <openPMD/auxiliary/JSON.hpp>
 #   include <openPMD/openPMD.hpp>
+#   include <nlohmann/json.hpp>
 namespace io = openPMD;
 #endif
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 
 namespace impactx::diagnostics
 {
+    // The write paths below (dataset declaration, direct and staged
+    // writes) only handle runtime int components, e.g., the ensemble
+    // member. When compile-time int attributes are added to IntSoA, their
+    // write path still has to be added to all of them.
+    static_assert(IntSoA::nattribs == 0, "add the write path of compile-time int attributes");
+
 namespace detail
 {
-    ImpactXParticleCounter::ImpactXParticleCounter (ParticleContainer & pc)
+    ImpactXParticleCounter::ImpactXParticleCounter (ParticleContainerBase const & pc)
     {
         m_MPISize = amrex::ParallelDescriptor::NProcs();
         m_MPIRank = amrex::ParallelDescriptor::MyProc();
@@ -43,12 +69,10 @@ namespace detail
 
         for (auto currentLevel = 0; currentLevel <= pc.finestLevel(); currentLevel++)
         {
-            long numParticles = 0; // numParticles in this processor
-
-            for (ParticleIter pti(pc, currentLevel); pti.isValid(); ++pti) {
-                auto numParticleOnTile = pti.numParticles();
-                numParticles += numParticleOnTile;
-            }
+            // numParticles in this processor
+            bool const only_valid = true;
+            bool const only_local = true;
+            amrex::Long const numParticles = pc.NumberOfParticlesAtLevel(currentLevel, only_valid, only_local);
 
             unsigned long long offset=0; // offset of this level
             unsigned long long sum=0; // numParticles in this level (sum from all processors)
@@ -80,25 +104,22 @@ namespace detail
 //
     void
     ImpactXParticleCounter::GetParticleOffsetOfProcessor (
-            const long& numParticles,
+            const amrex::Long& numParticles,
             unsigned long long& offset,
             unsigned long long& sum
     ) const
     {
         offset = 0;
+        sum = static_cast<unsigned long long>(numParticles);
 #if defined(AMREX_USE_MPI)
-        std::vector<long> result(m_MPISize, 0);
-    amrex::ParallelGather::Gather (numParticles, result.data(), -1, amrex::ParallelDescriptor::Communicator());
-
-    sum = 0;
-    int const num_results = result.size();
-    for (int i=0; i<num_results; i++) {
-        sum += result[i];
-        if (i<m_MPIRank)
-            offset += result[i];
-    }
-#else
-        sum = numParticles;
+        auto const num = static_cast<unsigned long long>(numParticles);
+        MPI_Comm const comm = amrex::ParallelDescriptor::Communicator();
+
+        // exclusive prefix sum: the result on rank 0 is undefined
+        MPI_Exscan(&num, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+        if (m_MPIRank == 0) { offset = 0; }
+
+        MPI_Allreduce(&num, &sum, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
 #endif
     }
 
@@ -125,6 +146,413 @@ namespace detail
         return make_pair(record_name, component_name);
     }
 
+    /** Write the reference particle as attributes
+     *
+     * @param record openPMD particle species or mesh
+     * @param ref_part reference particle
+     */
+    template<typename T_Record>
+    void set_ref_attributes (T_Record & record, RefPart const & ref_part)
+    {
+        record.setAttribute( "beta_ref", ref_part.beta() );
+        record.setAttribute( "gamma_ref", ref_part.gamma() );
+        record.setAttribute( "beta_gamma_ref", ref_part.beta_gamma() );
+        record.setAttribute( "s_ref", ref_part.s );
+        record.setAttribute( "x_ref", ref_part.x );
+        record.setAttribute( "y_ref", ref_part.y );
+        record.setAttribute( "z_ref", ref_part.z );
+        record.setAttribute( "t_ref", ref_part.t );
+        record.setAttribute( "px_ref", ref_part.px );
+        record.setAttribute( "py_ref", ref_part.py );
+        record.setAttribute( "pz_ref", ref_part.pz );
+        record.setAttribute( "pt_ref", ref_part.pt );
+        record.setAttribute( "mass_ref", ref_part.mass );
+        record.setAttribute( "charge_ref", ref_part.charge );
+    }
+
+    /** Copy the component of a tile to host memory, converting its precision if needed
+     *
+     * On GPU, the copy is asynchronous if the precision is unchanged:
+     * synchronize the stream before using the data.
+     *
+     * @tparam T data type in the file
+     * @tparam T_Data data type in the particle container
+     * @param src component of the tile, device memory
+     * @param n number of particles of the tile
+     * @param dst host memory
+     */
+    template<typename T, typename T_Data>
+    void copy_tile_to_host (T_Data const * src, uint64_t n, T * dst)
+    {
+        if constexpr (std::is_same_v<T, T_Data>)
+        {
+#ifdef AMREX_USE_GPU
+            amrex::Gpu::copyAsync(amrex::Gpu::deviceToHost, src, src + n, dst);
+#else
+            std::copy(src, src + n, dst);
+#endif
+        }
+        else
+        {
+            // reduced precision: convert on the device, which also halves the device-to-host copy
+#ifdef AMREX_USE_GPU
+            amrex::Gpu::DeviceVector<T> converted(n);
+            T * const converted_data = converted.data();
+            amrex::ParallelFor(static_cast<amrex::Long>(n), [=] AMREX_GPU_DEVICE (amrex::Long i) {
+                converted_data[i] = static_cast<T>(src[i]);
+            });
+            amrex::Gpu::copyAsync(amrex::Gpu::deviceToHost, converted_data, converted_data + n, dst);
+            amrex::Gpu::streamSynchronize();
+#else
+            std::transform(src, src + n, dst, [](T_Data v) { return static_cast<T>(v); });
+#endif
+        }
+    }
+
+    /** Store one component of all particles of this rank on a level as a single chunk
+     *
+     * The chunk is a span of the I/O backend (zero-copy with ADIOS2), into
+     * which the data of each tile is copied directly from the particle
+     * container.
+     *
+     * @tparam T data type of the component in the file
+     * @param rc record component to write
+     * @param offset offset of this rank in the MPI-global particle array
+     * @param np number of particles of this rank on this level
+     * @param pc particle container
+     * @param lev mesh-refinement level
+     * @param get_data returns the pointer to the component of a tile, for its struct of arrays
+     */
+    template<typename T, typename F_GetData>
+    void store_component (
+        io::RecordComponent rc,
+        uint64_t offset,
+        uint64_t np,
+        ParticleContainerBase const & pc,
+        int lev,
+        F_GetData && get_data
+    )
+    {
+        // Do not call storeChunk() with zero-sized particle tiles:
+        //   https://github.com/openPMD/openPMD-api/issues/1147
+        if (np == 0) { return; }
+
+        auto view = rc.storeChunk<T>({offset}, {np});
+
+        uint64_t pos = 0;
+        for (ParConstIterSoA pti(pc, lev); pti.isValid(); ++pti)
+        {
+            auto const numParticleOnTile = static_cast<uint64_t>(pti.numParticles());
+            if (numParticleOnTile == 0) { continue; }
+
+            auto const * src = get_data(pti.GetStructOfArrays());
+            // note: the buffer of a span can move, so query it per tile
+            T * dst = view.currentBuffer().data() + pos;
+            copy_tile_to_host(src, numParticleOnTile, dst);
+            pos += numParticleOnTile;
+        }
+        amrex::Gpu::streamSynchronize();
+    }
+
+    /** Select the particles that a BeamMonitor writes
+     *
+     * A particle is selected if it passes all filters. All filters are a
+     * pure function of the particle id and its phase space coordinates, so
+     * the same tracer particles are selected in every step, on any number
+     * of MPI ranks.
+     *
+     * This is evaluated on device, while the selected particles are copied.
+     */
+    struct ParticleFilter
+    {
+        amrex::ParticleReal m_fraction = 1; ///< random fraction of the particles to select, in (0, 1]
+        uint64_t m_seed = 0; ///< random seed of the fraction filter
+        amrex::Long m_every_nth_id = 1; ///< select particles with a particle number (id) that is a multiple of this
+        /** phase space region to select, for x, y, t, px, py, pt */
+        amrex::GpuArray<amrex::ParticleReal, 6> m_lower = {
+            std::numeric_limits<amrex::ParticleReal>::lowest(), std::numeric_limits<amrex::ParticleReal>::lowest(),
+            std::numeric_limits<amrex::ParticleReal>::lowest(), std::numeric_limits<amrex::ParticleReal>::lowest(),
+            std::numeric_limits<amrex::ParticleReal>::lowest(), std::numeric_limits<amrex::ParticleReal>::lowest()};
+        amrex::GpuArray<amrex::ParticleReal, 6> m_upper = {
+            std::numeric_limits<amrex::ParticleReal>::max(), std::numeric_limits<amrex::ParticleReal>::max(),
+            std::numeric_limits<amrex::ParticleReal>::max(), std::numeric_limits<amrex::ParticleReal>::max(),
+            std::numeric_limits<amrex::ParticleReal>::max(), std::numeric_limits<amrex::ParticleReal>::max()};
+        uint64_t const * m_ids = nullptr; ///< sorted device array of particle idcpu values to select, nullptr: all
+        int m_num_ids = 0; ///< number of entries in m_ids
+
+        /** Is a particle selected?
+         *
+         * @param src particle tile data
+         * @param i particle index in the tile
+         * @return 1 if the particle is selected, else 0
+         */
+        template<typename T_SrcData>
+        AMREX_GPU_HOST_DEVICE AMREX_FORCE_INLINE
+        int operator() (T_SrcData const & src, int i) const
+        {
+            uint64_t const idcpu = src.m_idcpu[i];
+            amrex::Long const id = amrex::ConstParticleIDWrapper(idcpu);
+
+            if (id % m_every_nth_id != 0) { return 0; }
+
+            static_assert(RealSoA::x == 0 && RealSoA::pt == 5);
+            for (int comp = RealSoA::x; comp <= RealSoA::pt; ++comp) {
+                amrex::ParticleReal const v = src.m_rdata[comp][i];
+                if (v < m_lower[comp] || v > m_upper[comp]) { return 0; }
+            }
+
+            if (m_ids != nullptr) {
+                // binary search in the sorted id list
+                int lo = 0;
+                int hi = m_num_ids;
+                while (lo < hi) {
+                    int const mid = lo + (hi - lo) / 2;
+                    if (m_ids[mid] < idcpu) { lo = mid + 1; } else { hi = mid; }
+                }
+                if (lo == m_num_ids || m_ids[lo] != idcpu) { return 0; }
+            }
+
+            if (m_fraction < 1) {
+                distribution::PhiloxEngine const engine(m_seed, idcpu);
+                if (engine.uniform() >= m_fraction) { return 0; }
+            }
+
+            return 1;
+        }
+    };
+
+    /** Read the particle filter options <element_name>.filter_*
+     *
+     * @param[in] element_name name of the element (for input queries)
+     * @param[out] filter the particle filter
+     * @param[out] ids device storage of the particle idcpu list of the filter
+     * @return true if any filter is enabled
+     */
+    bool
+    read_particle_filter (
+        std::string const & element_name,
+        ParticleFilter & filter,
+        amrex::Gpu::DeviceVector<uint64_t> & ids
+    )
+    {
+        amrex::ParmParse pp_element(element_name);
+        bool enabled = false;
+
+        amrex::ParticleReal fraction = 1;
+        pp_element.queryAdd("filter_fraction", fraction);
+        if (!(fraction > 0 && fraction <= 1)) {
+            throw std::runtime_error(element_name + ".filter_fraction must be in (0, 1].");
+        }
+        int seed = 0;
+        pp_element.queryAdd("filter_seed", seed);
+        filter.m_fraction = fraction;
+        filter.m_seed = static_cast<uint64_t>(seed);
+        enabled = enabled || fraction < 1;
+
+        amrex::Long every_nth_id = 1;
+        pp_element.queryAdd("filter_every_nth_id", every_nth_id);
+        if (every_nth_id < 1) {
+            throw std::runtime_error(element_name + ".filter_every_nth_id must be positive.");
+        }
+        filter.m_every_nth_id = every_nth_id;
+        enabled = enabled || every_nth_id > 1;
+
+        // phase space region, e.g., <element_name>.filter_region_x = -1e-3 1e-3
+        std::array<std::string, 6> const components = {"x", "y", "t", "px", "py", "pt"};
+        for (int comp = 0; comp < 6; ++comp) {
+            std::vector<amrex::ParticleReal> range;
+            pp_element.queryarr(("filter_region_" + components[comp]).c_str(), range);
+            if (range.empty()) { continue; }
+            if (range.size() != 2u || range[0] > range[1]) {
+                throw std::runtime_error(element_name + ".filter_region_" + components[comp] +
+                                         " must be two values: lower upper.");
+            }
+            filter.m_lower[comp] = range[0];
+            filter.m_upper[comp] = range[1];
+            enabled = true;
+        }
+
+        // tracer particles: the values of the openPMD id record, which do not fit a signed integer
+        std::vector<std::string> id_strings;
+        pp_element.queryarr("filter_ids", id_strings);
+        if (!id_strings.empty()) {
+            std::vector<uint64_t> id_list;
+            for (auto const & id_string : id_strings) {
+                id_list.push_back(std::stoull(id_string));
+            }
+            std::sort(id_list.begin(), id_list.end());
+            ids.resize(id_list.size());
+            amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, id_list.begin(), id_list.end(), ids.begin());
+            amrex::Gpu::streamSynchronize();
+            filter.m_ids = ids.data();
+            filter.m_num_ids = static_cast<int>(ids.size());
+            enabled = true;
+        }
+
+        return enabled;
+    }
+
+    /** A component of the particles of this rank on a level, in a staging buffer */
+    struct StagedChunk
+    {
+        enum class Type { id, real, real32, integer };
+
+        std::string name; ///< component name
+        Type type; ///< data type of the component
+        std::size_t byte_offset; ///< position in the staging buffer
+        uint64_t offset; ///< offset of this rank in the MPI-global particle array
+        uint64_t np; ///< number of particles of this rank on this level
+    };
+
+    /** Copy one component of all particles of this rank on a level into a staging buffer
+     *
+     * On GPU, the copies are asynchronous: synchronize the stream before using the buffer.
+     *
+     * @tparam T data type of the component in the file
+     * @param dst position of the chunk in the staging buffer, aligned for T
+     * @param pc particle container
+     * @param lev mesh-refinement level
+     * @param get_data returns the pointer to the component of a tile, for its struct of arrays
+     */
+    template<typename T, typename F_GetData>
+    void stage_component (
+        char * dst,
+        ParticleContainerBase const & pc,
+        int lev,
+        F_GetData && get_data
+    )
+    {
+        T * const dst_data = reinterpret_cast<T *>(dst);
+
+        uint64_t pos = 0;
+        for (ParConstIterSoA pti(pc, lev); pti.isValid(); ++pti)
+        {
+            auto const numParticleOnTile = static_cast<uint64_t>(pti.numParticles());
+            if (numParticleOnTile == 0) { continue; }
+
+            auto const * src = get_data(pti.GetStructOfArrays());
+            copy_tile_to_host(src, numParticleOnTile, dst_data + pos);
+            pos += numParticleOnTile;
+        }
+    }
+
+    /** Which ParticleReal components are written in single precision?
+     *
+     * @param element_name name of the element (for input queries)
+     * @param real_soa_names ParticleReal component names
+     * @return per component: true if listed in <element_name>.float32_records
+     */
+    std::vector<bool>
+    float32_components (
+        std::string const & element_name,
+        std::vector<std::string> const & real_soa_names
+    )
+    {
+        std::vector<std::string> float32_records;
+        amrex::ParmParse(element_name).queryarr("float32_records", float32_records);
+
+        std::vector<bool> to_float32(real_soa_names.size(), false);
+        for (auto const & name : float32_records) {
+            auto const it = std::find(real_soa_names.begin(), real_soa_names.end(), name);
+            if (it == real_soa_names.end()) {
+                throw std::runtime_error(element_name + ".float32_records: unknown particle component " + name);
+            }
+            to_float32.at(it - real_soa_names.begin()) = !std::is_same_v<amrex::ParticleReal, float>;
+        }
+        return to_float32;
+    }
+
+    /** Collect the ADIOS2 parameters <prefix>.<key> = <value> as JSON object
+     *
+     * @param prefix ParmParse prefix of the parameters, e.g., monitor.adios2_operator.parameters
+     * @return a JSON object with string values, e.g., {"clevel": "1"}
+     */
+    nlohmann::json
+    adios2_parameters (std::string const & prefix)
+    {
+        nlohmann::json parameters = nlohmann::json::object();
+        for (auto const & entry : amrex::ParmParse::getEntries(prefix)) {
+            std::string value;
+            amrex::ParmParse().get(entry.c_str(), value);
+            parameters[entry.substr(prefix.size() + 1u)] = value;
+        }
+        return parameters;
+    }
+
+    /** openPMD series options of a BeamMonitor, as JSON
+     *
+     * Defaults are merged with the ADIOS2 engine and operator options
+     * <element_name>.adios2_engine.* and <element_name>.adios2_operator.*
+     * and then with the openPMD configuration <element_name>.openpmd_config,
+     * which is inline JSON or TOML or, if prefixed with @, a file name.
+     *
+     * @param element_name name of the element (for input queries)
+     * @param streaming the series is an ADIOS2 SST stream instead of a file
+     * @return openPMD series options
+     */
+    std::string
+    series_options (std::string const & element_name, bool streaming)
+    {
+        amrex::ParmParse pp_element(element_name);
+
+        // adios2.engine.usesteps: write output steps with ADIOS2 steps, required for streaming
+        std::string options = R"({"adios2": {"engine": {"usesteps": true}}})";
+
+        // streaming: never block tracking on readers. Start without a reader, queue
+        // a few steps and drop the oldest ones a slow reader did not fetch yet.
+        // Sockets (WAN) work for local readers on all systems, unlike RDMA.
+        if (streaming) {
+            options = io::json::merge(options, R"({"adios2": {"engine": {"parameters": {)"
+                R"("RendezvousReaderCount": "0", "QueueLimit": "2", "QueueFullPolicy": "Discard", "DataTransport": "WAN"}}}})");
+        }
+
+        // ADIOS2 engine, e.g., the number of aggregators or subfiles
+        std::string engine_type;
+        pp_element.queryAdd("adios2_engine.type", engine_type);
+        nlohmann::json const engine_parameters = adios2_parameters(element_name + ".adios2_engine.parameters");
+        if (!engine_type.empty()) {
+            nlohmann::json engine;
+            engine["adios2"]["engine"]["type"] = engine_type;
+            options = io::json::merge(options, engine.dump());
+        }
+        if (!engine_parameters.empty()) {
+            nlohmann::json engine;
+            engine["adios2"]["engine"]["parameters"] = engine_parameters;
+            options = io::json::merge(options, engine.dump());
+        }
+
+        // ADIOS2 operator for compression, e.g., blosc, bzip2, zfp or sz
+        std::string operator_type;
+        pp_element.queryAdd("adios2_operator.type", operator_type);
+        if (!operator_type.empty()) {
+            nlohmann::json op;
+            op["type"] = operator_type;
+            op["parameters"] = adios2_parameters(element_name + ".adios2_operator.parameters");
+            nlohmann::json dataset;
+            dataset["adios2"]["dataset"]["operators"] = nlohmann::json::array({op});
+            options = io::json::merge(options, dataset.dump());
+        }
+
+        // openPMD configuration: inline JSON or TOML, or @file
+        // inputs files split values at spaces, so inline configurations are set from Python only
+        if (pp_element.countval("openpmd_config") > 1) {
+            throw std::runtime_error(element_name + ".openpmd_config: inline configurations are not supported "
+                                     "in inputs files, use @<file name> instead");
+        }
+        std::string config;
+        pp_element.queryAdd("openpmd_config", config);
+        if (!config.empty() && config.front() == '@') {
+            amrex::Vector<char> file_content;
+            amrex::ParallelDescriptor::ReadAndBcastFile(config.substr(1u), file_content);
+            config = std::string(file_content.dataPtr());
+        }
+        if (!config.empty()) {
+            options = io::json::merge(options, config);
+        }
+
+        return options;
+    }
+
     // TODO: move to ablastr
     io::RecordComponent get_component_record (
         io::ParticleSpecies & species,
@@ -140,6 +568,9 @@ namespace detail
     void BeamMonitor::finalize ()
     {
 #ifdef ImpactX_USE_OPENPMD
+        // write all pending output of the I/O thread
+        async_io::drain();
+
         // close shared series alias
         if (m_series.has_value())
         {
@@ -179,6 +610,12 @@ namespace detail
         else if ( "f" == encoding )
             series_encoding = openPMD::IterationEncoding::fileBased;
 
+        // streaming to readers that run at the same time, e.g., a live dashboard
+        bool const streaming = m_OpenPMDFileType == "sst";
+        if (streaming && series_encoding == openPMD::IterationEncoding::fileBased) {
+            throw std::runtime_error(m_series_name + ": the sst backend streams one series, file based encoding is not possible.");
+        }
+
         // legacy options from other diagnostics
         amrex::ParmParse pp_diag("diag");
         pp_diag.queryAdd("file_min_digits", m_file_min_digits);
@@ -200,11 +637,19 @@ namespace detail
             filepath = openPMD::auxiliary::replace_all(filepath, "/", "\\");
 #   endif
 
+            // openPMD calls are not thread-safe: wait for the I/O thread
+            async_io::drain();
+
+            // the SST contact file, which readers use to connect, is written next to the series
+            if (streaming) {
+                amrex::UtilCreateDirectory("diags/openPMD", 0755);
+            }
+
             auto series = io::Series(filepath, io::Access::CREATE
 #   if openPMD_HAVE_MPI==1
-                , amrex::ParallelDescriptor::Communicator()
+                , async_io::communicator()
 #   endif
-                , "adios2.engine.usesteps = true"
+                , detail::series_options(m_series_name, streaming)
             );
             series.setSoftware("ImpactX", IMPACTX_VERSION);
             series.setIterationEncoding( series_encoding );
@@ -220,7 +665,7 @@ namespace detail
     }
 
     void BeamMonitor::prepare (
-        PinnedContainer & pc,
+        ParticleContainerBase const & pc,
         std::vector<std::string> const & real_soa_names,
         std::vector<std::string> const & int_soa_names,
         RefPart const & ref_part,
@@ -229,12 +674,6 @@ namespace detail
 #ifdef ImpactX_USE_OPENPMD
         m_step = step;
 
-        // series & iteration
-        auto series = std::any_cast<io::Series>(m_series);
-        io::WriteIterations iterations = series.writeIterations();
-        io::Iteration iteration = iterations[m_step];
-        io::ParticleSpecies beam = iteration.particles["beam"];
-
         // calculate & update particle offset in MPI-global particle array, per level
         auto const num_levels = pc.finestLevel() + 1;
         m_offset = std::vector<uint64_t>(num_levels);
@@ -244,67 +683,79 @@ namespace detail
             m_offset.at(currentLevel) = static_cast<uint64_t>( counter.m_ParticleOffsetAtRank[currentLevel] );
         }
 
-        // helpers to parse strings to openPMD
-        auto const scalar = openPMD::RecordComponent::SCALAR;
-        auto const getComponentRecord = [&beam](std::string comp_name) {
-            return detail::get_component_record(beam, std::move(comp_name));
-        };
+        int const num_real_comps = pc.NumRealComps();
+        int const num_int_comps = pc.NumIntComps();
 
-        // define data set and metadata
-        io::Datatype const dtype_fl = io::determineDatatype<amrex::ParticleReal>();
-        io::Datatype const dtype_ui = io::determineDatatype<uint64_t>();
-        auto d_fl = io::Dataset(dtype_fl, {np});
-        auto d_ui = io::Dataset(dtype_ui, {np});
-
-        // reference particle information
-        beam.setAttribute( "beta_ref", ref_part.beta() );
-        beam.setAttribute( "gamma_ref", ref_part.gamma() );
-        beam.setAttribute( "beta_gamma_ref", ref_part.beta_gamma() );
-        beam.setAttribute( "s_ref", ref_part.s );
-        beam.setAttribute( "x_ref", ref_part.x );
-        beam.setAttribute( "y_ref", ref_part.y );
-        beam.setAttribute( "z_ref", ref_part.z );
-        beam.setAttribute( "t_ref", ref_part.t );
-        beam.setAttribute( "px_ref", ref_part.px );
-        beam.setAttribute( "py_ref", ref_part.py );
-        beam.setAttribute( "pz_ref", ref_part.pz );
-        beam.setAttribute( "pt_ref", ref_part.pt );
-        beam.setAttribute( "mass_ref", ref_part.mass );
-        beam.setAttribute( "charge_ref", ref_part.charge );
-
-        // total particle bunch information
-        //   @see impactx::diagnostics::reduced_beam_characteristics
-        for (const auto &kv : m_rbc) {
-            beam.setAttribute(kv.first, kv.second);
-        }
+        // optional: components written in single precision
+        std::vector<bool> const to_float32 = detail::float32_components(m_series_name, real_soa_names);
 
-        // openPMD coarse position: for global coordinates
+        // define data set and metadata: on the I/O thread, if enabled
+        async_io::run([
+            series = std::any_cast<io::Series>(m_series), step = m_step, np, ref_part,
+            rbc = m_rbc, real_soa_names, int_soa_names, num_real_comps, num_int_comps, to_float32
+        ]() mutable
         {
+            // series & iteration
+            io::WriteIterations iterations = series.writeIterations();
+            io::Iteration iteration = iterations[step];
+            io::ParticleSpecies beam = iteration.particles["beam"];
+
+            // helpers to parse strings to openPMD
+            auto const scalar = openPMD::RecordComponent::SCALAR;
+            auto const getComponentRecord = [&beam](std::string comp_name) {
+                return detail::get_component_record(beam, std::move(comp_name));
+            };
+
+            // define data set and metadata
+            io::Datatype const dtype_fl = io::determineDatatype<amrex::ParticleReal>();
+            io::Datatype const dtype_ui = io::determineDatatype<uint64_t>();
+            auto d_fl = io::Dataset(dtype_fl, {np});
+            auto d_fl32 = io::Dataset(io::determineDatatype<float>(), {np});
+            auto d_ui = io::Dataset(dtype_ui, {np});
+            io::Datatype const dtype_in = io::determineDatatype<int>();
+            auto d_in = io::Dataset(dtype_in, {np});
+
+            // reference particle information
+            detail::set_ref_attributes(beam, ref_part);
+
+            // total particle bunch information
+            //   @see impactx::diagnostics::reduced_beam_characteristics
+            for (const auto &kv : rbc) {
+                beam.setAttribute(kv.first, kv.second);
+            }
 
-            beam["positionOffset"]["x"].resetDataset(d_fl);
-            beam["positionOffset"]["x"].makeConstant(ref_part.x);
-            beam["positionOffset"]["y"].resetDataset(d_fl);
-            beam["positionOffset"]["y"].makeConstant(ref_part.y);
-            beam["positionOffset"]["t"].resetDataset(d_fl);
-            beam["positionOffset"]["t"].makeConstant(ref_part.t);
-        }
+            // openPMD coarse position: for global coordinates
+            {
 
-        // unique, global particle index
-        beam["id"][scalar].resetDataset(d_ui);
+                beam["positionOffset"]["x"].resetDataset(d_fl);
+                beam["positionOffset"]["x"].makeConstant(ref_part.x);
+                beam["positionOffset"]["y"].resetDataset(d_fl);
+                beam["positionOffset"]["y"].makeConstant(ref_part.y);
+                beam["positionOffset"]["t"].resetDataset(d_fl);
+                beam["positionOffset"]["t"].makeConstant(ref_part.t);
+            }
 
-        // SoA: Real
-        {
-            for (auto real_idx = 0; real_idx < pc.NumRealComps(); real_idx++) {
-                auto const component_name = real_soa_names.at(real_idx);
-                getComponentRecord(component_name).resetDataset(d_fl);
+            // unique, global particle index
+            beam["id"][scalar].resetDataset(d_ui);
+
+            // SoA: Real
+            {
+                for (auto real_idx = 0; real_idx < num_real_comps; real_idx++) {
+                    auto const component_name = real_soa_names.at(real_idx);
+                    getComponentRecord(component_name).resetDataset(to_float32.at(real_idx) ? d_fl32 : d_fl);
+                }
             }
-        }
-        // SoA: Int
-        static_assert(IntSoA::nattribs == 0); // not yet used
-        if (!int_soa_names.empty())
-            throw std::runtime_error("BeamMonitor: int_soa_names output not yet implemented!");
+            // SoA: Int
+            //   only runtime attributes, e.g., the ensemble member
+            {
+                for (auto int_idx = 0; int_idx < num_int_comps; int_idx++) {
+                    auto const component_name = int_soa_names.at(int_idx);
+                    getComponentRecord(component_name).resetDataset(d_in);
+                }
+            }
+        });
 #else
-        amrex::ignore_unused(pc, step);
+        amrex::ignore_unused(pc, real_soa_names, int_soa_names, ref_part, step);
 #endif // ImpactX_USE_OPENPMD
     }
 
@@ -321,6 +772,43 @@ namespace detail
         // preparing to access reference particle data: RefPart
         RefPart & ref_part = pc.GetRefParticle();
 
+        amrex::ParmParse pp_element(m_series_name);
+
+        // optional: write only every N-th time the beam passes, e.g., every N-th period of a ring
+        int period_interval = 1;
+        pp_element.queryAdd("period_interval", period_interval);
+        AMREX_ALWAYS_ASSERT_WITH_MESSAGE(period_interval >= 1,
+                                         m_series_name + ".period_interval must be positive.");
+        int const visit = m_num_visits++;
+        if (visit % period_interval != 0) { return; }
+
+        bool particles_enabled = true;
+        pp_element.queryAdd("write_particles", particles_enabled);
+
+        // optional: phase space histograms, computed in situ
+        //   written first: the histogramming does not change the particles
+        m_step = step;
+        write_histograms(pc);
+
+        if (!particles_enabled) {
+            // optional: total particle bunch information only, e.g., for a lightweight stream
+            bool write_rbc = false;
+            pp_element.queryAdd("write_reduced_beam_characteristics", write_rbc);
+            std::unordered_map<std::string, amrex::ParticleReal> rbc;
+            if (write_rbc) {
+                rbc = diagnostics::reduced_beam_characteristics(pc);
+            }
+
+            async_io::run([series = std::any_cast<io::Series>(m_series), step = m_step, rbc = std::move(rbc)]() mutable {
+                io::Iteration iteration = series.writeIterations()[step];
+                for (auto const & kv : rbc) {
+                    iteration.setAttribute(kv.first, kv.second);
+                }
+                iteration.close();
+            });
+            return;
+        }
+
         // optional: add and calculate additional particle properties
         add_optional_properties(m_series_name, pc);
 
@@ -332,126 +820,273 @@ namespace detail
         std::vector<std::string> real_soa_names = pc.RealSoA_names();
         std::vector<std::string> int_soa_names = pc.intSoA_names();
 
-        // pinned memory copy
-        PinnedContainer pinned_pc = pc.make_alike<amrex::PinnedArenaAllocator>();
-        pinned_pc.copyParticles(pc, true);  // no filtering
-
-        // TODO: filtering
-        /*
-        using SrcData = WarpXParticleContainer::ParticleTileType::ConstParticleTileDataType;
-        tmp.copyParticles(*pc,
-                          [=] AMREX_GPU_HOST_DEVICE (const SrcData& src, int ip, const amrex::RandomEngine& engine)
-                          {
-                              const SuperParticleType& p = src.getSuperParticle(ip);
-                              return random_filter(p, engine) * uniform_filter(p, engine)
-                                     * parser_filter(p, engine) * geometry_filter(p, engine);
-                          }, true);
-        */
-
-        // prepare element access & write reference particle
-        this->prepare(pinned_pc, real_soa_names, int_soa_names, ref_part, step);
-
-        // loop over refinement levels
-        int const nLevel = pinned_pc.finestLevel();
-        for (int lev = 0; lev <= nLevel; ++lev)
+        // optional: select a subset of the particles, e.g., tracer particles
+        detail::ParticleFilter filter;
+        amrex::Gpu::DeviceVector<uint64_t> filter_ids;
+        bool const filtered = detail::read_particle_filter(m_series_name, filter, filter_ids);
+
+        if (filtered) {
+            // copy the selected particles on device, keeping the tile layout of this rank
+            auto selected = pc.make_alike();
+            bool const local = true;
+            selected.copyParticles(pc, filter, local);
+
+            this->prepare(selected, real_soa_names, int_soa_names, ref_part, step);
+            this->write_particles(selected, real_soa_names, int_soa_names);
+        } else {
+            // prepare element access & write reference particle
+            this->prepare(pc, real_soa_names, int_soa_names, ref_part, step);
+
+            // write beam particles relative to reference particle
+            this->write_particles(pc, real_soa_names, int_soa_names);
+        }
+#else
+        amrex::ignore_unused(pc, step);
+#endif // ImpactX_USE_OPENPMD
+    }
+
+    void
+    BeamMonitor::write_histograms (ImpactXParticleContainer & pc)
+    {
+#ifdef ImpactX_USE_OPENPMD
+        amrex::ParmParse pp_element(m_series_name);
+        std::vector<std::string> histograms;
+        pp_element.queryarr("histograms", histograms);
+        if (histograms.empty()) { return; }
+
+        std::string profile_name = "impactx::Push::" + std::string(BeamMonitor::type) + "::write_histograms";
+        BL_PROFILE(profile_name);
+
+        int num_bins = 64;
+        pp_element.queryAdd("histogram_bins", num_bins);
+
+        // keep the data alive until the series is flushed
+        auto hists = std::make_shared<std::vector<PhaseSpaceHistogram>>();
+        hists->reserve(histograms.size());
+
+        for (auto const & spec : histograms)
         {
-            // loop over all particle boxes
-            //using ParIt = ImpactXParticleContainer::iterator;
-            using ParIt = PinnedContainer::ParIterType;
-            // note: openPMD-api is not thread-safe, so do not run OMP parallel here
-            for (ParIt pti(pinned_pc, lev); pti.isValid(); ++pti) {
-                // write beam particles relative to reference particle
-                this->operator()(pti, real_soa_names, int_soa_names, ref_part);
-            } // end loop over all particle boxes
-        } // end mesh-refinement level loop
+            // components of the axes, separated by colons, e.g., x:px
+            std::vector<std::string> components;
+            std::istringstream ss(spec);
+            for (std::string comp; std::getline(ss, comp, ':');) {
+                components.push_back(comp);
+            }
 
-        auto series = std::any_cast<io::Series>(m_series);
-        io::WriteIterations iterations = series.writeIterations();
-        io::Iteration iteration = iterations[m_step];
+            // optional fixed ranges, e.g., <element_name>.histogram_range_px = -1e-3 1e-3
+            std::vector<std::array<amrex::ParticleReal, 2>> ranges;
+            for (auto const & comp : components) {
+                std::vector<amrex::ParticleReal> range;
+                pp_element.queryarr(("histogram_range_" + comp).c_str(), range);
+                if (range.size() == 2u) {
+                    ranges.push_back({range[0], range[1]});
+                } else {
+                    ranges.push_back({0, 0});  // extent of the beam
+                }
+            }
+
+            hists->push_back(phase_space_histogram(
+                pc, components, std::vector<int>(components.size(), num_bins), ranges));
+        }
+
+        // write: on the I/O thread, if enabled
+        async_io::run([
+            series = std::any_cast<io::Series>(m_series), step = m_step, hists, ref_part = pc.GetRefParticle()
+        ]() mutable
+        {
+            io::WriteIterations iterations = series.writeIterations();
+            io::Iteration iteration = iterations[step];
 
-        // close iteration
-        iteration.close();
+            for (PhaseSpaceHistogram const & hist : *hists)
+            {
+                auto const & components = hist.components;
+
+                // one openPMD mesh record per histogram, e.g., phase_space_x_px
+                std::string mesh_name = "phase_space";
+                for (auto const & comp : components) { mesh_name.append("_").append(comp); }
+
+                io::Mesh mesh = iteration.meshes[mesh_name];
+                mesh.setGeometry(io::Mesh::Geometry::cartesian);
+                mesh.setDataOrder(io::Mesh::DataOrder::C);
+                mesh.setAxisLabels(hist.components);
+                std::vector<double> spacing;
+                std::vector<double> offset;
+                io::Extent extent;
+                for (std::size_t d = 0; d < components.size(); ++d) {
+                    spacing.push_back(double(hist.upper[d] - hist.lower[d]) / double(hist.num_bins[d]));
+                    offset.push_back(double(hist.lower[d]));
+                    extent.push_back(static_cast<std::uint64_t>(hist.num_bins[d]));
+                }
+                mesh.setGridSpacing(spacing);
+                mesh.setGridGlobalOffset(offset);
+                mesh.setGridUnitSI(1.0);
+                detail::set_ref_attributes(mesh, ref_part);
+
+                // sum of the weights (number of real particles) per bin, at the bin centers
+                io::MeshRecordComponent mrc = mesh[io::MeshRecordComponent::SCALAR];
+                mrc.setPosition(std::vector<double>(components.size(), 0.5));
+                mrc.resetDataset(io::Dataset(io::determineDatatype<double>(), extent));
+                if (amrex::ParallelDescriptor::IOProcessor()) {
+                    mrc.storeChunkRaw(hist.data.data(), io::Offset(extent.size(), 0u), extent);
+                }
+            }
+
+            series.flush();
+        });
 #else
-        amrex::ignore_unused(pc, step);
+        amrex::ignore_unused(pc);
 #endif // ImpactX_USE_OPENPMD
     }
 
     void
-    BeamMonitor::operator() (
-        PinnedContainer::ParIterType & pti,
+    BeamMonitor::write_particles (
+        ParticleContainerBase const & pc,
         std::vector<std::string> const & real_soa_names,
-        std::vector<std::string> const & int_soa_names,
-        RefPart const & ref_part
+        std::vector<std::string> const & int_soa_names
     )
     {
 #ifdef ImpactX_USE_OPENPMD
-        int const currentLevel = pti.GetLevel();
-
-        auto & offset = m_offset.at(currentLevel); // ...
-
-        // series & iteration
         auto series = std::any_cast<io::Series>(m_series);
-        io::WriteIterations iterations = series.writeIterations();
-        io::Iteration iteration = iterations[m_step];
+        int const nLevel = pc.finestLevel();
+        auto const scalar = openPMD::RecordComponent::SCALAR;
 
-        // writing
-        io::ParticleSpecies beam = iteration.particles["beam"];
+        // optional: components written in single precision
+        std::vector<bool> const to_float32 = detail::float32_components(m_series_name, real_soa_names);
 
-        auto const numParticleOnTile = pti.numParticles();
-        uint64_t const numParticleOnTile64 = static_cast<uint64_t>( numParticleOnTile );
+        if (!async_io::enabled())
+        {
+            // series & iteration
+            io::WriteIterations iterations = series.writeIterations();
+            io::Iteration iteration = iterations[m_step];
 
-        // Do not call storeChunk() with zero-sized particle tiles:
-        //   https://github.com/openPMD/openPMD-api/issues/1147
-        //if (numParticleOnTile == 0) continue;
+            // writing
+            io::ParticleSpecies beam = iteration.particles["beam"];
 
-        auto const scalar = openPMD::RecordComponent::SCALAR;
-        auto const getComponentRecord = [&beam](std::string comp_name) {
-            return detail::get_component_record(beam, std::move(comp_name));
-        };
+            auto const getComponentRecord = [&beam](std::string comp_name) {
+                return detail::get_component_record(beam, std::move(comp_name));
+            };
 
-        // SoA
-        auto const& soa = pti.GetStructOfArrays();
-        //   particle id arrays
-        {
-            beam["id"][scalar].storeChunkRaw(soa.GetIdCPUData().data(), {offset}, {numParticleOnTile64});
+            // loop over refinement levels
+            //   note: openPMD-api is not thread-safe, so do not run OMP parallel here
+            for (int lev = 0; lev <= nLevel; ++lev)
+            {
+                bool const only_valid = true;
+                bool const only_local = true;
+                auto const np = static_cast<uint64_t>(pc.NumberOfParticlesAtLevel(lev, only_valid, only_local));
+                uint64_t const offset = m_offset.at(lev);
+
+                //   particle id arrays
+                detail::store_component<uint64_t>(beam["id"][scalar], offset, np, pc, lev,
+                    [](auto const & soa) { return soa.GetIdCPUData().data(); });
+
+                //   SoA floating point (ParticleReal) properties
+                for (auto real_idx = 0; real_idx < pc.NumRealComps(); real_idx++) {
+                    auto const component_name = real_soa_names.at(real_idx);
+                    auto const get_data = [real_idx](auto const & soa) { return soa.GetRealData(real_idx).data(); };
+                    if (to_float32.at(real_idx)) {
+                        detail::store_component<float>(getComponentRecord(component_name), offset, np, pc, lev, get_data);
+                    } else {
+                        detail::store_component<amrex::ParticleReal>(getComponentRecord(component_name), offset, np, pc, lev, get_data);
+                    }
+                }
+
+                //   SoA integer (int) properties: only runtime attributes, e.g., the ensemble member
+                for (auto int_idx = 0; int_idx < pc.NumIntComps(); int_idx++) {
+                    auto const component_name = int_soa_names.at(int_idx);
+                    detail::store_component<int>(getComponentRecord(component_name), offset, np, pc, lev,
+                        [int_idx](auto const & soa) { return soa.GetIntData(int_idx).data(); });
+                }
+            } // end mesh-refinement level loop
+
+            // close iteration: the only flush of the particle data of this step
+            iteration.close();
+            return;
         }
-        //   SoA floating point (ParticleReal) properties
+
+        // asynchronous output: copy all components into a staging buffer,
+        // one contiguous chunk per component and level, and let the I/O thread write it
+        std::vector<detail::StagedChunk> chunks;
+        std::size_t num_bytes = 0;
+        auto const add_chunk = [&](std::string name, detail::StagedChunk::Type type, std::size_t type_size,
+                                   uint64_t offset, uint64_t np) {
+            chunks.push_back({std::move(name), type, num_bytes, offset, np});
+            // keep all chunks 8-byte aligned
+            num_bytes += (np * type_size + 7u) / 8u * 8u;
+        };
+        for (int lev = 0; lev <= nLevel; ++lev)
         {
-            for (auto real_idx=0; real_idx < soa.NumRealComps(); real_idx++) {
-                auto const component_name = real_soa_names.at(real_idx);
-                getComponentRecord(component_name).storeChunkRaw(
-                soa.GetRealData(real_idx).data(), {offset}, {numParticleOnTile64});
+            bool const only_valid = true;
+            bool const only_local = true;
+            auto const np = static_cast<uint64_t>(pc.NumberOfParticlesAtLevel(lev, only_valid, only_local));
+            uint64_t const offset = m_offset.at(lev);
+
+            add_chunk("id", detail::StagedChunk::Type::id, sizeof(uint64_t), offset, np);
+            for (auto real_idx = 0; real_idx < pc.NumRealComps(); real_idx++) {
+                if (to_float32.at(real_idx)) {
+                    add_chunk(real_soa_names.at(real_idx), detail::StagedChunk::Type::real32, sizeof(float), offset, np);
+                } else {
+                    add_chunk(real_soa_names.at(real_idx), detail::StagedChunk::Type::real, sizeof(amrex::ParticleReal), offset, np);
+                }
+            }
+            for (auto int_idx = 0; int_idx < pc.NumIntComps(); int_idx++) {
+                add_chunk(int_soa_names.at(int_idx), detail::StagedChunk::Type::integer, sizeof(int), offset, np);
             }
         }
-        //   SoA integer (int) properties (not yet used)
+
+        // back-pressure: waits if all staging buffers are still being written
+        int const buffer = async_io::acquire_buffer(num_bytes);
+        char * const data = async_io::buffer_data(buffer);
+
+        std::size_t c = 0;
+        for (int lev = 0; lev <= nLevel; ++lev)
         {
-            static_assert(IntSoA::nattribs == 0); // not yet used
-            if (!int_soa_names.empty())
-                throw std::runtime_error("BeamMonitor: int_soa_names output not yet implemented!");
-            /*
-            // comment this in once IntSoA::nattribs is > 0
-
-            std::copy(IntSoA::names_s.begin(), IntSoA::names_s.end(), int_soa_names.begin());
-
-            for (auto int_idx=0; int_idx < RealSoA::nattribs; int_idx++) {
-                auto const component_name = int_soa_names.at(int_idx);
-                getComponentRecord(component_name).storeChunkRaw(
-                    soa.GetIntData(int_idx).data(), {offset}, {numParticleOnTile64});
+            detail::stage_component<uint64_t>(data + chunks[c++].byte_offset, pc, lev,
+                [](auto const & soa) { return soa.GetIdCPUData().data(); });
+            for (auto real_idx = 0; real_idx < pc.NumRealComps(); real_idx++) {
+                auto const get_data = [real_idx](auto const & soa) { return soa.GetRealData(real_idx).data(); };
+                if (to_float32.at(real_idx)) {
+                    detail::stage_component<float>(data + chunks[c++].byte_offset, pc, lev, get_data);
+                } else {
+                    detail::stage_component<amrex::ParticleReal>(data + chunks[c++].byte_offset, pc, lev, get_data);
+                }
+            }
+            for (auto int_idx = 0; int_idx < pc.NumIntComps(); int_idx++) {
+                detail::stage_component<int>(data + chunks[c++].byte_offset, pc, lev,
+                    [int_idx](auto const & soa) { return soa.GetIntData(int_idx).data(); });
             }
-            */
         }
+        amrex::Gpu::streamSynchronize();
 
-        // TODO
-        amrex::ignore_unused(ref_part);
+        async_io::run([series, step = m_step, chunks = std::move(chunks), data]() mutable
+        {
+            io::WriteIterations iterations = series.writeIterations();
+            io::Iteration iteration = iterations[step];
+            io::ParticleSpecies beam = iteration.particles["beam"];
 
-        // needs to be higher for next pti; must be reset for next step via prepare
-        offset += numParticleOnTile64;
+            for (auto const & chunk : chunks)
+            {
+                // Do not call storeChunk() with zero-sized particle tiles:
+                //   https://github.com/openPMD/openPMD-api/issues/1147
+                if (chunk.np == 0) { continue; }
+
+                char const * const src = data + chunk.byte_offset;
+                io::RecordComponent rc = detail::get_component_record(beam, chunk.name);
+                if (chunk.type == detail::StagedChunk::Type::id) {
+                    rc.storeChunkRaw(reinterpret_cast<uint64_t const *>(src), {chunk.offset}, {chunk.np});
+                } else if (chunk.type == detail::StagedChunk::Type::real) {
+                    rc.storeChunkRaw(reinterpret_cast<amrex::ParticleReal const *>(src), {chunk.offset}, {chunk.np});
+                } else if (chunk.type == detail::StagedChunk::Type::real32) {
+                    rc.storeChunkRaw(reinterpret_cast<float const *>(src), {chunk.offset}, {chunk.np});
+                } else {
+                    rc.storeChunkRaw(reinterpret_cast<int const *>(src), {chunk.offset}, {chunk.np});
+                }
+            }
 
-        // TODO could be done once after all pti are processed
-        // TODO at that point, we could also close the iteration/step
-        series.flush();
+            // close iteration: the only flush of the particle data of this step
+            iteration.close();
+        }, buffer);
 #else
-        amrex::ignore_unused(pti, ref_part);
+        amrex::ignore_unused(pc, real_soa_names, int_soa_names);
 #endif   // ImpactX_USE_OPENPMD
     }
 
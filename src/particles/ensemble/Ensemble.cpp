@@ -0,0 +1,69 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "Ensemble.H"
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+
+namespace impactx::ensemble
+{
+    void
+    validate (std::vector<Member> const & members)
+    {
+        if (members.empty()) { return; }
+
+        auto const & lattice_0 = members.front().m_lattice;
+        for (std::size_t k = 1; k < members.size(); ++k)
+        {
+            auto const & lattice_k = members[k].m_lattice;
+            if (lattice_k.size() != lattice_0.size()) {
+                throw std::runtime_error(
+                    "ensemble::validate: lattice of member " + std::to_string(k) +
+                    " has " + std::to_string(lattice_k.size()) + " elements, but member 0 has " +
+                    std::to_string(lattice_0.size()) + " elements.");
+            }
+
+            int position = 0;
+            auto it_0 = lattice_0.begin();
+            for (auto it_k = lattice_k.begin(); it_k != lattice_k.end(); ++it_k, ++it_0, ++position)
+            {
+                if (it_k->index() != it_0->index()) {
+                    throw std::runtime_error(
+                        "ensemble::validate: element " + std::to_string(position) +
+                        " of member " + std::to_string(k) + " has a different type than in member 0.");
+                }
+
+                int const nslice_0 = std::visit([](auto && element){ return element.nslice(); }, *it_0);
+                int const nslice_k = std::visit([](auto && element){ return element.nslice(); }, *it_k);
+                if (nslice_k != nslice_0) {
+                    throw std::runtime_error(
+                        "ensemble::validate: element " + std::to_string(position) +
+                        " of member " + std::to_string(k) + " has a different nslice than in member 0.");
+                }
+            }
+        }
+
+        for (auto const & element_variant : lattice_0)
+        {
+            if (std::holds_alternative<Programmable>(element_variant)) {
+                throw std::runtime_error(
+                    "ensemble::validate: Programmable elements are not supported in ensemble simulations.");
+            }
+            if (std::holds_alternative<Plugin>(element_variant)) {
+                throw std::runtime_error(
+                    "ensemble::validate: Plugin elements are not supported in ensemble simulations.");
+            }
+        }
+    }
+
+} // namespace impactx::ensemble
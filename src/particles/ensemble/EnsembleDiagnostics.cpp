@@ -0,0 +1,179 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "EnsembleDiagnostics.H"
+
+#include "particles/CovarianceMatrix.H"
+#include "particles/diagnostics/ReducedBeamCharacteristics.H"
+
+#include <AMReX_Array.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_GpuAtomic.H>
+#include <AMReX_GpuContainers.H>
+#include <AMReX_GpuControl.H>
+#include <AMReX_GpuLaunch.H>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+
+namespace impactx::ensemble
+{
+    std::vector<std::unordered_map<std::string, amrex::ParticleReal>>
+    reduced_beam_characteristics (
+        ImpactXParticleContainer & pc,
+        std::vector<Member> const & members
+    )
+    {
+        BL_PROFILE("impactx::ensemble::reduced_beam_characteristics");
+
+        using amrex::ParticleReal;
+        namespace detail = diagnostics::detail;
+
+        int const nmembers = static_cast<int>(members.size());
+        int const member_comp = pc.GetIntCompIndex(member_attribute);
+
+        // sums of an empty beam per member, the initial value of the accumulators of each tile
+        std::vector<double> empty_sums(std::size_t(nmembers) * detail::moments_size);
+        for (int m = 0; m < nmembers; ++m) {
+            auto const empty = detail::empty_moments();
+            std::copy(empty.begin(), empty.end(), empty_sums.begin() + m * detail::moments_size);
+        }
+
+        // one pass over the particles of each tile for all members: moments per tile, merged pairwise
+        std::vector<double> moments = empty_sums;
+
+        int const nLevel = pc.finestLevel();
+        for (int lev = 0; lev <= nLevel; ++lev)
+        {
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+            {
+                std::vector<double> thread_moments = empty_sums;
+                amrex::Gpu::DeviceVector<double> d_sums(empty_sums.size());
+                std::vector<double> h_sums(empty_sums.size());
+
+                for (ImpactXParticleContainer::const_iterator pti(pc, lev); pti.isValid(); ++pti) {
+                    long const np = pti.numParticles();
+                    if (np == 0) { continue; }
+
+                    // preparing access to particle data: SoA, in the basis (x,px,y,py,t,pt)
+                    auto const & soa = pti.GetStructOfArrays();
+                    auto const & soa_real = soa.GetRealData();
+                    amrex::GpuArray<amrex::ParticleReal const *, 6> const v = {
+                        soa_real[RealSoA::x].dataPtr(), soa_real[RealSoA::px].dataPtr(),
+                        soa_real[RealSoA::y].dataPtr(), soa_real[RealSoA::py].dataPtr(),
+                        soa_real[RealSoA::t].dataPtr(), soa_real[RealSoA::pt].dataPtr()
+                    };
+                    ParticleReal const * const AMREX_RESTRICT part_w = soa_real[RealSoA::w].dataPtr();
+                    int const * const AMREX_RESTRICT member = soa.GetIntData(member_comp).dataPtr();
+
+                    // sums relative to the first particle of the tile, against cancellation
+                    amrex::GpuArray<double, 6> const shift = detail::tile_shift(pti);
+
+                    amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, empty_sums.begin(), empty_sums.end(), d_sums.begin());
+                    double * const AMREX_RESTRICT acc = d_sums.data();
+
+                    auto const deposit = [=] AMREX_GPU_HOST_DEVICE (long i)
+                    {
+                        int const m = member[i];
+                        if (m < 0 || m >= nmembers) { return; }
+                        double * const sums = acc + std::size_t(m) * detail::moments_size;
+
+                        double const w = part_w[i];
+                        double d[6];
+                        for (int a = 0; a < 6; ++a) { d[a] = v[a][i] - shift[a]; }
+
+                        // weight, first and second moments in the layout of detail::merge_moments
+#ifdef AMREX_USE_GPU
+                        amrex::Gpu::Atomic::AddNoRet(&sums[0], w);
+#else
+                        sums[0] += w;
+#endif
+                        int n = 7;
+                        for (int a = 0; a < 6; ++a) {
+#ifdef AMREX_USE_GPU
+                            amrex::Gpu::Atomic::AddNoRet(&sums[1 + a], w * d[a]);
+                            for (int b = a; b < 6; ++b) { amrex::Gpu::Atomic::AddNoRet(&sums[n++], w * d[a] * d[b]); }
+                            amrex::Gpu::Atomic::Min(&sums[detail::moments_min + a], double(v[a][i]));
+                            amrex::Gpu::Atomic::Max(&sums[detail::moments_max + a], double(v[a][i]));
+#else
+                            sums[1 + a] += w * d[a];
+                            for (int b = a; b < 6; ++b) { sums[n++] += w * d[a] * d[b]; }
+                            sums[detail::moments_min + a] = std::min(sums[detail::moments_min + a], double(v[a][i]));
+                            sums[detail::moments_max + a] = std::max(sums[detail::moments_max + a], double(v[a][i]));
+#endif
+                        }
+                    };
+
+#ifdef AMREX_USE_GPU
+                    amrex::ParallelFor(np, deposit);
+#else
+                    // serial scatter: particles of one tile share the sums of their member
+                    for (long i = 0; i < np; ++i) { deposit(i); }
+#endif
+
+                    // one copy of the sums of all members
+                    amrex::Gpu::copy(amrex::Gpu::deviceToHost, d_sums.begin(), d_sums.end(), h_sums.begin());
+                    for (int m = 0; m < nmembers; ++m) {
+                        std::array<double, detail::moments_size> const tile =
+                            detail::moments_from_sums(h_sums.data() + m * detail::moments_size, shift);
+                        detail::merge_moments(tile.data(), thread_moments.data() + m * detail::moments_size);
+                    }
+                }
+#ifdef AMREX_USE_OMP
+#pragma omp critical (impactx_ensemble_moments)
+#endif
+                for (int m = 0; m < nmembers; ++m) {
+                    detail::merge_moments(thread_moments.data() + m * detail::moments_size,
+                                          moments.data() + m * detail::moments_size);
+                }
+            }
+        }
+
+        // merge the moments over mpi ranks (allreduce), for all members at once
+        detail::allreduce_moments(moments.data(), nmembers);
+
+        std::vector<std::unordered_map<std::string, ParticleReal>> data;
+        data.reserve(nmembers);
+        for (int m = 0; m < nmembers; ++m)
+        {
+            double const * const mm = moments.data() + m * detail::moments_size;
+            double const w_sum = mm[0];
+
+            amrex::Array1D<ParticleReal, 1, 6> mean_values, min_values, max_values;
+            for (int a = 0; a < 6; ++a) {
+                mean_values(a + 1) = ParticleReal(mm[1 + a]);
+                min_values(a + 1) = ParticleReal(mm[detail::moments_min + a]);
+                max_values(a + 1) = ParticleReal(mm[detail::moments_max + a]);
+            }
+
+            CovarianceMatrix cm;
+            int c = 7;
+            for (int a = 1; a < 7; ++a) {
+                for (int b = a; b < 7; ++b) {
+                    cm(a, b) = cm(b, a) = ParticleReal(mm[c] / w_sum);
+                    ++c;
+                }
+            }
+
+            // charge of the reference particle times the number of real particles
+            ParticleReal const charge = members[m].m_ref_part.charge * ParticleReal(w_sum);
+
+            data.push_back(detail::characteristics_from_moments(
+                mean_values, min_values, max_values, cm, charge));
+        }
+
+        return data;
+    }
+
+} // namespace impactx::ensemble
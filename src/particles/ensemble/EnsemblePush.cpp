@@ -0,0 +1,127 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "EnsemblePush.H"
+
+#include <ablastr/warn_manager/WarnManager.H>
+
+#include <AMReX_BLProfiler.H>
+#include <AMReX_GpuContainers.H>
+#include <AMReX_GpuLaunch.H>
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+
+namespace impactx::ensemble
+{
+    void Push (ImpactXParticleContainer & pc,
+               std::vector<Member> & members,
+               std::vector<KnownElements *> const & element_variants)
+    {
+        BL_PROFILE("impactx::ensemble::Push");
+
+        AMREX_ALWAYS_ASSERT(members.size() == element_variants.size());
+        if (members.empty()) { return; }
+
+        int const nmembers = static_cast<int>(members.size());
+        int const member_comp = pc.GetIntCompIndex(member_attribute);
+
+        std::visit([&](auto&& element_0)
+        {
+            using Element = std::remove_cv_t< std::remove_reference_t<decltype(element_0)> >;
+
+            if constexpr (std::is_same_v<Element, diagnostics::BeamMonitor>)
+            {
+                // skipped: particles of different members are relative
+                // to different reference particles
+                ablastr::warn_manager::WMRecordWarning(
+                    "Ensemble",
+                    "BeamMonitor elements are skipped in ensemble simulations: "
+                    "no particle output is written.",
+                    ablastr::warn_manager::WarnPriority::medium
+                );
+            }
+            else if constexpr (!std::is_trivially_copyable_v<Element> || std::is_same_v<Element, Plugin>)
+            {
+                throw std::runtime_error(
+                    std::string("ensemble::Push: ") + Element::type +
+                    " elements are not supported in ensemble simulations.");
+            }
+            else
+            {
+                // push the reference particles in global coordinates
+                std::vector<Element> h_elements;
+                std::vector<RefPart> h_ref_parts;
+                h_elements.reserve(nmembers);
+                h_ref_parts.reserve(nmembers);
+                {
+                    BL_PROFILE("impactx::ensemble::Push::RefPart");
+                    for (int k = 0; k < nmembers; ++k)
+                    {
+                        auto & element = std::get<Element>(*element_variants[k]);
+                        element(members[k].m_ref_part);
+
+                        h_elements.push_back(element);
+                        h_ref_parts.push_back(members[k].m_ref_part);
+                    }
+                }
+
+                // one copy of the elements and reference particles on the device
+                amrex::Gpu::DeviceVector<Element> d_elements(nmembers);
+                amrex::Gpu::DeviceVector<RefPart> d_ref_parts(nmembers);
+                amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice,
+                                      h_elements.begin(), h_elements.end(), d_elements.begin());
+                amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice,
+                                      h_ref_parts.begin(), h_ref_parts.end(), d_ref_parts.begin());
+                Element const * const elements_ptr = d_elements.data();
+                RefPart const * const ref_parts_ptr = d_ref_parts.data();
+
+                // loop over refinement levels
+                int const nLevel = pc.finestLevel();
+                for (int lev = 0; lev <= nLevel; ++lev)
+                {
+                    // loop over all particle boxes
+                    using ParIt = ImpactXParticleContainer::iterator;
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+                    for (ParIt pti(pc, lev); pti.isValid(); ++pti)
+                    {
+                        const long np = pti.numParticles();
+
+                        // preparing access to particle data: SoA of Reals and Ints
+                        auto& soa = pti.GetStructOfArrays();
+                        auto& soa_real = soa.GetRealData();
+                        int const * const AMREX_RESTRICT part_member = soa.GetIntData(member_comp).dataPtr();
+
+                        detail::PushEnsembleSingleParticle<Element> const pushSingleParticle(
+                            elements_ptr, ref_parts_ptr, part_member,
+                            soa_real[RealSoA::x].dataPtr(),
+                            soa_real[RealSoA::y].dataPtr(),
+                            soa_real[RealSoA::t].dataPtr(),
+                            soa_real[RealSoA::px].dataPtr(),
+                            soa_real[RealSoA::py].dataPtr(),
+                            soa_real[RealSoA::pt].dataPtr(),
+                            soa.GetIdCPUData().dataPtr());
+
+                        //   loop over beam particles in the box
+                        amrex::ParallelFor(np, pushSingleParticle);
+                    }
+                }
+
+                // the device copies go out of scope
+                amrex::Gpu::streamSynchronize();
+            }
+        }, *element_variants.front());
+    }
+
+} // namespace impactx::ensemble
@@ -0,0 +1,96 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell
+ * License: BSD-3-Clause-LBNL
+ */
+#include "Envelope.H"
+
+#include <ablastr/constant.H>
+
+#include <AMReX_BLProfiler.H>
+
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+
+namespace impactx::envelope
+{
+    Envelope
+    create_envelope (
+        distribution::KnownDistributions const & distr,
+        amrex::ParticleReal bunch_charge,
+        amrex::ParticleReal current
+    )
+    {
+        using namespace amrex::literals; // for _rt and _prt
+
+        Envelope env;
+        env.m_bunch_charge = bunch_charge;
+        env.m_current = current;
+        for (int i = 1; i < 7; ++i) {
+            env.m_mean(i) = 0.0_prt;
+            for (int j = 1; j < 7; ++j) {
+                env.m_cm(i, j) = 0.0_prt;
+            }
+        }
+
+        std::visit([&env](auto&& distribution){
+            using Distribution = std::remove_cv_t< std::remove_reference_t<decltype(distribution)> >;
+
+            if constexpr (std::is_same_v<Distribution, distribution::Empty> ||
+                          std::is_same_v<Distribution, distribution::Thermal>)
+            {
+                throw std::runtime_error(
+                    "create_envelope: only distributions that are described by a "
+                    "phase space ellipse are supported for envelope tracking.");
+            }
+            else
+            {
+                env.m_cm = distribution.covariance();
+            }
+        }, distr);
+
+        return env;
+    }
+
+    void
+    kv_space_charge_push (
+        Envelope & env,
+        RefPart const & refpart,
+        amrex::ParticleReal slice_ds
+    )
+    {
+        BL_PROFILE("impactx::envelope::kv_space_charge_push");
+
+        using namespace amrex::literals; // for _rt and _prt
+        using ablastr::constant::math::pi;
+        using ablastr::constant::SI::c;
+        using ablastr::constant::SI::ep0;
+
+        // generalized perveance of the beam
+        amrex::ParticleReal const bg = refpart.beta_gamma();
+        amrex::ParticleReal const perveance = std::abs(refpart.charge) * env.m_current
+            / (2.0_prt * pi * ep0 * refpart.mass * std::pow(c, 3) * std::pow(bg, 3));
+
+        // rms sizes of the beam envelope
+        amrex::ParticleReal const sigma_x = std::sqrt(env.m_cm(1, 1));
+        amrex::ParticleReal const sigma_y = std::sqrt(env.m_cm(3, 3));
+        if (sigma_x <= 0.0_prt || sigma_y <= 0.0_prt) { return; }
+
+        // linear focusing kick of a K-V beam with semi-axes 2*sigma_x and 2*sigma_y
+        Map6x6 R = identity_map();
+        R(2, 1) = perveance * slice_ds / (2.0_prt * sigma_x * (sigma_x + sigma_y));
+        R(4, 3) = perveance * slice_ds / (2.0_prt * sigma_y * (sigma_x + sigma_y));
+
+        // the self-fields are centered on the beam: only the second moments change
+        env.m_cm = transport(R, env.m_cm);
+    }
+
+} // namespace impactx::envelope
@@ -0,0 +1,53 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl, Chad Mitchell
+ * License: BSD-3-Clause-LBNL
+ */
+#include "EnvelopePush.H"
+
+#include <AMReX_BLProfiler.H>
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+
+namespace impactx::envelope
+{
+    void Push (Envelope & env,
+               RefPart & refpart,
+               KnownElements & element_variant)
+    {
+        BL_PROFILE("impactx::envelope::Push");
+
+        std::visit([&env, &refpart](auto&& element)
+        {
+            using Element = std::remove_cv_t< std::remove_reference_t<decltype(element)> >;
+
+            if constexpr (std::is_same_v<Element, diagnostics::BeamMonitor>)
+            {
+                // nothing to do: there are no particles to write
+            }
+            else if constexpr (std::is_same_v<Element, Programmable>)
+            {
+                throw std::runtime_error(
+                    "envelope::Push: Programmable elements are not supported in envelope tracking.");
+            }
+            else if constexpr (std::is_same_v<Element, Plugin>)
+            {
+                throw std::runtime_error(
+                    "envelope::Push: Plugin elements are not supported in envelope tracking.");
+            }
+            else
+            {
+                push_envelope(env, refpart, element);
+            }
+        }, element_variant);
+    }
+
+} // namespace impactx::envelope
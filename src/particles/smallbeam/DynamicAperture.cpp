@@ -0,0 +1,264 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "DynamicAperture.H"
+#include "SmallBeam.H"
+
+#include <ablastr/constant.H>
+
+#include <AMReX_BLassert.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_INT.H>
+#include <AMReX_ParallelDescriptor.H>
+#include <AMReX_Particle.H>
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <variant>
+#include <vector>
+
+
+namespace impactx::small_beam
+{
+    DynamicAperture::DynamicAperture (
+        std::string plane,
+        amrex::ParticleReal x_min,
+        amrex::ParticleReal x_max,
+        int num_x,
+        amrex::ParticleReal v_min,
+        amrex::ParticleReal v_max,
+        int num_v,
+        amrex::ParticleReal pt,
+        amrex::ParticleReal max_amplitude
+    )
+    : m_plane(std::move(plane)),
+      m_x_min(x_min), m_x_max(x_max), m_num_x(num_x),
+      m_v_min(v_min), m_v_max(v_max), m_num_v(num_v),
+      m_pt(pt), m_max_amplitude(max_amplitude)
+    {
+        if (m_plane != "xy" && m_plane != "xpx") {
+            throw std::runtime_error("da.plane must be xy or xpx but is: " + m_plane);
+        }
+        if (m_num_x < 1 || m_num_v < 1) {
+            throw std::runtime_error("DynamicAperture: the number of probes per direction must be positive.");
+        }
+        if (!(m_max_amplitude > 0)) {
+            throw std::runtime_error("da.max_amplitude must be positive.");
+        }
+    }
+
+    std::array<amrex::ParticleReal, 6>
+    DynamicAperture::probe (int probe) const
+    {
+        auto const coordinate = [](amrex::ParticleReal min, amrex::ParticleReal max, int num, int i) {
+            return num > 1 ? min + (max - min) * amrex::ParticleReal(i) / amrex::ParticleReal(num - 1) : min;
+        };
+        amrex::ParticleReal const x = coordinate(m_x_min, m_x_max, m_num_x, probe % m_num_x);
+        amrex::ParticleReal const v = coordinate(m_v_min, m_v_max, m_num_v, probe / m_num_x);
+
+        amrex::ParticleReal const zero = 0.0;
+        if (m_plane == "xy") {
+            return {x, v, zero, zero, zero, m_pt};
+        }
+        return {x, zero, zero, v, zero, m_pt};
+    }
+
+    void
+    DynamicAperture::add_probes (ImpactXParticleContainer & pc)
+    {
+        BL_PROFILE("impactx::small_beam::DynamicAperture::add_probes");
+
+        // an even share of the grid for each MPI rank
+        auto const nprocs = amrex::Long(amrex::ParallelDescriptor::NProcs());
+        auto const myproc = amrex::Long(amrex::ParallelDescriptor::MyProc());
+        auto const num_probes = amrex::Long(this->num_probes());
+        m_first_probe = static_cast<int>(num_probes * myproc / nprocs);
+        int const end_probe = static_cast<int>(num_probes * (myproc + 1) / nprocs);
+        int const np = end_probe - m_first_probe;
+
+        m_turn_lost.assign(np, -1);
+        m_s_lost.assign(np, amrex::ParticleReal(0));
+        if (np == 0) { return; }
+
+        std::array<std::vector<amrex::ParticleReal>, 6> coords;
+        for (auto & c : coords) { c.resize(np); }
+        for (int i = 0; i < np; ++i) {
+            auto const p = probe(m_first_probe + i);
+            for (int c = 0; c < 6; ++c) { coords[c][i] = p[c]; }
+        }
+
+        // each probe has a weight of one particle
+        RefPart const & ref = pc.GetRefParticle();
+        amrex::ParticleReal const bchchg = ablastr::constant::SI::q_e * amrex::ParticleReal(np);
+        pc.AddNParticles(np, coords[0].data(), coords[1].data(), coords[2].data(),
+                         coords[3].data(), coords[4].data(), coords[5].data(),
+                         ref.qm_ratio_SI(), bchchg, false);
+    }
+
+    int
+    DynamicAperture::track (
+        ImpactXParticleContainer & pc,
+        std::list<KnownElements> & lattice,
+        int periods
+    )
+    {
+        BL_PROFILE("impactx::small_beam::DynamicAperture::track");
+
+        // runtime attributes would not follow their particles when lost particles are removed
+        if (pc.NumRuntimeRealComps() > 0 || pc.NumRuntimeIntComps() > 0) {
+            throw std::runtime_error(
+                "algo.track = dynamic_aperture: particles with runtime attributes, e.g., from "
+                "nonlinear_lens_invariants of beam monitors, are not supported.");
+        }
+
+        std::vector<Step> const steps = flatten(lattice);
+        for (Step const & step : steps) {
+            if (!step.push && !std::holds_alternative<diagnostics::BeamMonitor>(*step.element_variant)) {
+                throw std::runtime_error(
+                    std::string("algo.track = dynamic_aperture: element type not supported: ") + step.type);
+            }
+        }
+
+        RefPart & ref_part = pc.GetRefParticle();
+
+        Beam beam;
+        beam.load(pc);
+        AMREX_ALWAYS_ASSERT(beam.size() == m_turn_lost.size());
+
+        // index of the probe of each particle of the beam: beam monitors remove the lost probes
+        std::vector<std::size_t> probe_index(beam.size());
+        for (std::size_t i = 0; i < probe_index.size(); ++i) { probe_index[i] = i; }
+
+        // record a lost probe, once
+        auto const record_lost = [&](std::size_t i, int turn) {
+            std::size_t const p = probe_index[i];
+            if (m_turn_lost[p] < 0) {
+                m_turn_lost[p] = turn;
+                m_s_lost[p] = beam.m_s_lost[i];
+            }
+        };
+
+        amrex::Long num_alive = amrex::Long(beam.size());
+        amrex::ParallelDescriptor::ReduceLongSum(num_alive);
+
+        int global_step = 0;
+        int turn = 0;
+        for (; turn < periods && num_alive > 0; ++turn) {
+            for (Step const & step : steps) {
+                global_step++;
+
+                // update element edge of the reference particle
+                if (step.first_slice) { ref_part.sedge = ref_part.s; }
+
+                if (step.push) {
+                    step.push(step.element, beam, ref_part);
+                } else {
+                    // beam monitors: the lost probes move to the lost particle container
+                    std::vector<std::size_t> remaining;
+                    for (std::size_t i = 0; i < beam.size(); ++i) {
+                        if (amrex::ConstParticleIDWrapper{beam.m_idcpu[i]}.is_valid()) {
+                            remaining.push_back(probe_index[i]);
+                        } else {
+                            record_lost(i, turn);
+                        }
+                    }
+                    beam.store(pc);
+                    std::visit([&pc, global_step](auto && element) {
+                        element(pc, global_step);
+                    }, *step.element_variant);
+                    beam.load(pc);
+                    AMREX_ALWAYS_ASSERT(beam.size() == remaining.size());
+                    probe_index = std::move(remaining);
+                }
+            }
+
+            // record the probes lost in this turn, including the ones that left the
+            // maximum amplitude or became unstable
+            num_alive = 0;
+            for (std::size_t i = 0; i < beam.size(); ++i) {
+                uint64_t & idcpu = beam.m_idcpu[i];
+                if (amrex::ConstParticleIDWrapper{idcpu}.is_valid()) {
+                    bool finite = true;
+                    for (auto const & comp : beam.m_real) { finite = finite && std::isfinite(comp[i]); }
+                    if (!finite ||
+                        std::abs(beam.m_real[RealSoA::x][i]) > m_max_amplitude ||
+                        std::abs(beam.m_real[RealSoA::y][i]) > m_max_amplitude)
+                    {
+                        amrex::ParticleIDWrapper{idcpu}.make_invalid();
+                        beam.m_s_lost[i] = ref_part.s;
+                    }
+                }
+
+                if (amrex::ConstParticleIDWrapper{idcpu}.is_valid()) {
+                    num_alive++;
+                } else {
+                    record_lost(i, turn);
+                }
+            }
+
+            // all MPI ranks stop at the same turn
+            amrex::ParallelDescriptor::ReduceLongSum(num_alive);
+        }
+        m_turns_tracked = turn;
+
+        // the surviving probes and the lost probes, once
+        beam.store(pc);
+
+        return m_turns_tracked;
+    }
+
+    int
+    DynamicAperture::write (std::string const & file_name) const
+    {
+        BL_PROFILE("impactx::small_beam::DynamicAperture::write");
+
+        // each probe is on one MPI rank: sum the local results on the I/O rank
+        int const num_probes = this->num_probes();
+        std::vector<int> turns(num_probes, 0);
+        std::vector<int> lost(num_probes, 0);
+        std::vector<double> s_lost(num_probes, 0.0);
+        for (std::size_t i = 0; i < m_turn_lost.size(); ++i) {
+            std::size_t const p = m_first_probe + i;
+            lost[p] = m_turn_lost[i] >= 0 ? 1 : 0;
+            turns[p] = m_turn_lost[i] >= 0 ? m_turn_lost[i] : m_turns_tracked;
+            s_lost[p] = m_s_lost[i];
+        }
+        int const io_proc = amrex::ParallelDescriptor::IOProcessorNumber();
+        amrex::ParallelDescriptor::ReduceIntSum(turns.data(), num_probes, io_proc);
+        amrex::ParallelDescriptor::ReduceIntSum(lost.data(), num_probes, io_proc);
+        amrex::ParallelDescriptor::ReduceRealSum(s_lost.data(), num_probes, io_proc);
+
+        int num_survived = 0;
+        for (int l : lost) { num_survived += 1 - l; }
+        amrex::ParallelDescriptor::Bcast(&num_survived, 1, io_proc);
+
+        if (!amrex::ParallelDescriptor::IOProcessor()) { return num_survived; }
+
+        std::ofstream ofs(file_name, std::ofstream::out | std::ofstream::trunc);
+        if (!ofs) {
+            throw std::runtime_error("DynamicAperture: cannot open file " + file_name);
+        }
+        ofs.precision(std::numeric_limits<double>::max_digits10);
+
+        ofs << "probe x y t px py pt survived turns s_lost\n";
+        for (int p = 0; p < num_probes; ++p) {
+            auto const c = probe(p);
+            double const s = lost[p] ? s_lost[p] : std::numeric_limits<double>::quiet_NaN();
+            ofs << p << " " << c[0] << " " << c[1] << " " << c[2] << " " << c[3] << " "
+                << c[4] << " " << c[5] << " " << 1 - lost[p] << " " << turns[p] << " " << s << "\n";
+        }
+
+        return num_survived;
+    }
+
+} // namespace impactx::small_beam
@@ -0,0 +1,223 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "SmallBeam.H"
+
+#include <AMReX_BLProfiler.H>
+#include <AMReX_GpuContainers.H>
+#include <AMReX_GpuDevice.H>
+
+#include <stdexcept>
+#include <string>
+#include <variant>
+
+
+namespace impactx::small_beam
+{
+    void
+    Beam::load (ImpactXParticleContainer & pc)
+    {
+        BL_PROFILE("impactx::small_beam::Beam::load");
+
+        // the tiles of this MPI rank, one after the other
+        m_tiles.clear();
+        std::size_t np_total = 0;
+        int const nLevel = pc.finestLevel();
+        for (int lev = 0; lev <= nLevel; ++lev) {
+            for (auto const & [index, ptile] : pc.GetParticles(lev)) {
+                std::size_t const np = ptile.numParticles();
+                m_tiles.push_back({lev, index, np_total, np});
+                np_total += np;
+            }
+        }
+
+        for (auto & comp : m_real) { comp.resize(np_total); }
+        m_idcpu.resize(np_total);
+        m_s_lost.assign(np_total, amrex::ParticleReal(0));
+
+        for (auto const & tile : m_tiles) {
+            auto const & soa = pc.GetParticles(tile.lev).at(tile.index).GetStructOfArrays();
+            for (int comp = 0; comp < RealSoA::nattribs; ++comp) {
+                amrex::ParticleReal const * src = soa.GetRealData(comp).dataPtr();
+                amrex::Gpu::copyAsync(amrex::Gpu::deviceToHost, src, src + tile.size, m_real[comp].data() + tile.begin);
+            }
+            uint64_t const * src = soa.GetIdCPUData().dataPtr();
+            amrex::Gpu::copyAsync(amrex::Gpu::deviceToHost, src, src + tile.size, m_idcpu.data() + tile.begin);
+        }
+        amrex::Gpu::streamSynchronize();
+    }
+
+    void
+    Beam::store (ImpactXParticleContainer & pc)
+    {
+        BL_PROFILE("impactx::small_beam::Beam::store");
+
+        ImpactXParticleContainer & dest = *pc.GetLostParticleContainer();
+        int const s_lost_comp = dest.GetRealCompIndex("s_lost");
+        bool dest_resized = false;
+
+        for (auto const & tile : m_tiles) {
+            // keep the particles that are not lost at the front of the tile range,
+            // collect the lost ones separately
+            std::array<std::vector<amrex::ParticleReal>, RealSoA::nattribs> lost_real;
+            std::vector<uint64_t> lost_idcpu;
+            std::vector<amrex::ParticleReal> lost_s;
+            std::size_t num_valid = 0;
+            for (std::size_t i = tile.begin; i < tile.begin + tile.size; ++i) {
+                if (amrex::ConstParticleIDWrapper{m_idcpu[i]}.is_valid()) {
+                    std::size_t const dst = tile.begin + num_valid;
+                    for (auto & comp : m_real) { comp[dst] = comp[i]; }
+                    m_idcpu[dst] = m_idcpu[i];
+                    ++num_valid;
+                } else {
+                    for (int comp = 0; comp < RealSoA::nattribs; ++comp) {
+                        lost_real[comp].push_back(m_real[comp][i]);
+                    }
+                    // flip id to positive in destination
+                    lost_idcpu.push_back(m_idcpu[i]);
+                    amrex::ParticleIDWrapper{lost_idcpu.back()}.make_valid();
+                    lost_s.push_back(m_s_lost[i]);
+                }
+            }
+
+            auto & ptile = pc.GetParticles(tile.lev).at(tile.index);
+            ptile.resize(num_valid);
+            auto & soa = ptile.GetStructOfArrays();
+            for (int comp = 0; comp < RealSoA::nattribs; ++comp) {
+                amrex::ParticleReal const * src = m_real[comp].data() + tile.begin;
+                amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, src, src + num_valid, soa.GetRealData(comp).dataPtr());
+            }
+            uint64_t const * src = m_idcpu.data() + tile.begin;
+            amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, src, src + num_valid, soa.GetIdCPUData().dataPtr());
+
+            // move lost particles to the lost particle container
+            std::size_t const num_lost = lost_idcpu.size();
+            if (num_lost > 0) {
+                // have to resize here, not in the constructor because grids have not
+                // been built when constructor was called.
+                if (!dest_resized) {
+                    dest.reserveData();
+                    dest.resizeData();
+                    dest_resized = true;
+                }
+
+                auto & ptile_dest = dest.DefineAndReturnParticleTile(tile.lev, tile.index.first, tile.index.second);
+                std::size_t const dst_index = ptile_dest.numParticles();
+                ptile_dest.resize(dst_index + num_lost);
+                auto & soa_dest = ptile_dest.GetStructOfArrays();
+                for (int comp = 0; comp < RealSoA::nattribs; ++comp) {
+                    amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, lost_real[comp].begin(), lost_real[comp].end(),
+                                          soa_dest.GetRealData(comp).dataPtr() + dst_index);
+                }
+                amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, lost_idcpu.begin(), lost_idcpu.end(),
+                                      soa_dest.GetIdCPUData().dataPtr() + dst_index);
+                amrex::Gpu::copyAsync(amrex::Gpu::hostToDevice, lost_s.begin(), lost_s.end(),
+                                      soa_dest.GetRealData(s_lost_comp).dataPtr() + dst_index);
+            }
+
+            // the lost particles of this tile go out of scope
+            amrex::Gpu::streamSynchronize();
+        }
+
+        // the host arrays are out of date until the next load()
+        m_tiles.clear();
+        for (auto & comp : m_real) { comp.clear(); }
+        m_idcpu.clear();
+        m_s_lost.clear();
+    }
+
+    std::vector<Step>
+    flatten (std::list<KnownElements> & lattice)
+    {
+        std::vector<Step> steps;
+        int element_index = 0;
+        for (auto & element_variant : lattice)
+        {
+            std::visit([&](auto & element)
+            {
+                using Element = std::remove_cv_t< std::remove_reference_t<decltype(element)> >;
+
+                Step step{&element_variant, &element, Element::type, element_index, true, nullptr};
+
+                // elements that push each particle independently are pushed on the host
+                if constexpr (std::is_base_of_v<elements::BeamOptic<Element>, Element> ||
+                              std::is_same_v<Element, Empty>)
+                {
+                    step.push = &push<Element>;
+                }
+
+                int const nslice = element.nslice();
+                for (int slice_step = 0; slice_step < nslice; ++slice_step) {
+                    step.first_slice = slice_step == 0;
+                    steps.push_back(step);
+                }
+            }, element_variant);
+
+            ++element_index;
+        }
+        return steps;
+    }
+
+    int
+    track (
+        ImpactXParticleContainer & pc,
+        std::list<KnownElements> & lattice,
+        int periods,
+        int global_step,
+        diagnostics::LossMap * loss_map
+    )
+    {
+        BL_PROFILE("impactx::small_beam::track");
+
+        // runtime attributes would not follow their particles when lost particles are removed
+        if (pc.NumRuntimeRealComps() > 0 || pc.NumRuntimeIntComps() > 0) {
+            throw std::runtime_error(
+                "algo.small_beam: particles with runtime attributes, e.g., from "
+                "nonlinear_lens_invariants of beam monitors, are not supported.");
+        }
+
+        std::vector<Step> const steps = flatten(lattice);
+        RefPart & ref_part = pc.GetRefParticle();
+
+        Beam beam;
+        beam.load(pc);
+
+        for (int period = 0; period < periods; ++period) {
+            for (Step const & step : steps) {
+                global_step++;
+
+                // update element edge of the reference particle
+                if (step.first_slice) { ref_part.sedge = ref_part.s; }
+
+                LostParticles lost;
+                if (step.push) {
+                    lost = step.push(step.element, beam, ref_part);
+                } else {
+                    // elements that need the particle container, e.g., beam monitors
+                    beam.store(pc);
+                    std::visit([&pc, global_step](auto && element) {
+                        element(pc, global_step);
+                    }, *step.element_variant);
+                    lost = collect_lost_particles(pc);
+                    beam.load(pc);
+                }
+
+                if (loss_map) {
+                    loss_map->add(lost, period, step.element_index, step.type, ref_part.s, ref_part.charge);
+                }
+            }
+        }
+
+        // the final beam and its lost particles
+        beam.store(pc);
+
+        return global_step;
+    }
+
+} // namespace impactx::small_beam
@@ -47,7 +47,7 @@ namespace impactx::spacecharge
 #pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
 #endif
             for (ParIt pti(pc, lev); pti.isValid(); ++pti) {
-                const int np = pti.numParticles();
+                const long np = pti.numParticles();
 
                 // get the device pointer-wrapper Array4 for 3D field access
                 auto const scf_arr_x = space_charge_field.at(lev).at("x")[pti].array();
@@ -76,7 +76,7 @@ namespace impactx::spacecharge
                 amrex::ParticleReal const push_consts = dt * charge * inv_gamma2 / pz_ref_SI;
 
                 // gather to each particle and push momentum
-                amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i) {
+                amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (long i) {
                     // access SoA Real data
                     amrex::ParticleReal & AMREX_RESTRICT x = part_x[i];
                     amrex::ParticleReal & AMREX_RESTRICT y = part_y[i];
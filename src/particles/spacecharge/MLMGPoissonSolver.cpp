@@ -0,0 +1,273 @@
+/* Copyright 2022-2023 The Regents of the University of California, through Lawrence
+ *           Berkeley National Laboratory (subject to receipt of any required
+ *           approvals from the U.S. Dept. of Energy). All rights reserved.
+ *
+ * This file is part of ImpactX.
+ *
+ * Authors: Axel Huebl
+ * License: BSD-3-Clause-LBNL
+ */
+#include "MLMGPoissonSolver.H"
+
+#include <ablastr/constant.H>
+
+#include <AMReX_Algorithm.H>
+#include <AMReX_BLProfiler.H>
+#include <AMReX_GpuQualifiers.H>
+#include <AMReX_MFIter.H>
+#include <AMReX_Vector.H>
+
+#include <cmath>
+
+
+namespace impactx::spacecharge
+{
+namespace
+{
+    /** Compare the index space and physical extent of two geometries */
+    bool
+    same_geometry (amrex::Geometry const & a, amrex::Geometry const & b)
+    {
+        if (a.Domain() != b.Domain()) { return false; }
+        for (int d = 0; d < AMREX_SPACEDIM; ++d) {
+            if (a.ProbLo(d) != b.ProbLo(d) || a.ProbHi(d) != b.ProbHi(d)) { return false; }
+        }
+        return true;
+    }
+
+    /** Interpolate the previous solution onto a resized geometry
+     *
+     * The geometries differ in their physical extent but not in the
+     * number of cells. Nodes on the domain boundary are set to zero
+     * (Dirichlet). The guard nodes of phi are used to interpolate across
+     * box boundaries; beyond them, the closest available nodes are used.
+     * This is only an initial guess for the next solve.
+     *
+     * @param[inout] phi the previous solution
+     * @param[in] old_geom geometry of the previous solution
+     * @param[in] new_geom geometry of the next solve
+     */
+    void
+    remap (
+        amrex::MultiFab & phi,
+        amrex::Geometry const & old_geom,
+        amrex::Geometry const & new_geom
+    )
+    {
+        BL_PROFILE("impactx::spacecharge::MLMGPoissonSolver::remap");
+
+        using namespace amrex::literals;
+
+        amrex::MultiFab phi_old(phi.boxArray(), phi.DistributionMap(), 1, phi.nGrowVect());
+        amrex::MultiFab::Copy(phi_old, phi, 0, 0, 1, phi.nGrowVect());
+        phi_old.FillBoundary(old_geom.periodicity());
+
+        auto const old_lo = old_geom.ProbLoArray();
+        auto const old_inv_dx = old_geom.InvCellSizeArray();
+        auto const new_lo = new_geom.ProbLoArray();
+        auto const new_dx = new_geom.CellSizeArray();
+
+        // nodal index range of the domain: the outermost nodes are Dirichlet boundaries
+        amrex::Box const old_domain = amrex::surroundingNodes(old_geom.Domain());
+        amrex::Box const new_domain = amrex::surroundingNodes(new_geom.Domain());
+        amrex::GpuArray<int, 3> const old_dom_lo = {old_domain.smallEnd(0), old_domain.smallEnd(1), old_domain.smallEnd(2)};
+        amrex::GpuArray<int, 3> const old_dom_hi = {old_domain.bigEnd(0), old_domain.bigEnd(1), old_domain.bigEnd(2)};
+        amrex::GpuArray<int, 3> const new_dom_lo = {new_domain.smallEnd(0), new_domain.smallEnd(1), new_domain.smallEnd(2)};
+        amrex::GpuArray<int, 3> const new_dom_hi = {new_domain.bigEnd(0), new_domain.bigEnd(1), new_domain.bigEnd(2)};
+
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+        for (amrex::MFIter mfi(phi, amrex::TilingIfNotGPU()); mfi.isValid(); ++mfi)
+        {
+            amrex::Box const bx = mfi.tilebox();
+            amrex::Array4<amrex::Real const> const src = phi_old.const_array(mfi);
+            amrex::Array4<amrex::Real> const dst = phi.array(mfi);
+
+            // valid and guard nodes of the previous solution in this box
+            amrex::Box const src_box = phi_old[mfi].box();
+            amrex::GpuArray<int, 3> const src_lo = {src_box.smallEnd(0), src_box.smallEnd(1), src_box.smallEnd(2)};
+            amrex::GpuArray<int, 3> const src_hi = {src_box.bigEnd(0), src_box.bigEnd(1), src_box.bigEnd(2)};
+
+            amrex::ParallelFor(bx, [=] AMREX_GPU_DEVICE (int i, int j, int k) noexcept
+            {
+                int const idx[3] = {i, j, k};
+                int i0[3];
+                amrex::Real w[3];
+
+                for (int d = 0; d < 3; ++d) {
+                    // Dirichlet boundary of the new domain
+                    if (idx[d] <= new_dom_lo[d] || idx[d] >= new_dom_hi[d]) {
+                        dst(i, j, k) = 0.0_rt;
+                        return;
+                    }
+
+                    // position of the node in the index space of the previous solution
+                    amrex::Real const pos = new_lo[d] + amrex::Real(idx[d]) * new_dx[d];
+                    amrex::Real const s = (pos - old_lo[d]) * old_inv_dx[d];
+
+                    // outside of the previous domain, the previous solution is zero
+                    if (s <= amrex::Real(old_dom_lo[d]) || s >= amrex::Real(old_dom_hi[d])) {
+                        dst(i, j, k) = 0.0_rt;
+                        return;
+                    }
+
+                    int const c = amrex::Clamp(static_cast<int>(std::floor(s)), src_lo[d], src_hi[d] - 1);
+                    i0[d] = c;
+                    w[d] = amrex::Clamp(s - amrex::Real(c), 0.0_rt, 1.0_rt);
+                }
+
+                // trilinear interpolation
+                amrex::Real value = 0.0_rt;
+                for (int kk = 0; kk < 2; ++kk) {
+                    amrex::Real const wz = kk ? w[2] : 1.0_rt - w[2];
+                    for (int jj = 0; jj < 2; ++jj) {
+                        amrex::Real const wy = jj ? w[1] : 1.0_rt - w[1];
+                        for (int ii = 0; ii < 2; ++ii) {
+                            amrex::Real const wx = ii ? w[0] : 1.0_rt - w[0];
+                            value += wx * wy * wz * src(i0[0] + ii, i0[1] + jj, i0[2] + kk);
+                        }
+                    }
+                }
+                dst(i, j, k) = value;
+            });
+        }
+    }
+} // namespace
+
+    bool
+    MLMGPoissonSolver::define_if_changed (
+        amrex::Geometry const & geom,
+        amrex::BoxArray const & grids,
+        amrex::DistributionMapping const & dmap,
+        std::array<amrex::Real, 3> const & beta_xyz
+    )
+    {
+        using namespace amrex::literals;
+
+        bool const rebuild = !m_linop || !m_geom.has_value() || m_geom->Domain() != geom.Domain() ||
+                             m_grids != grids || m_dmap != dmap;
+
+        if (rebuild)
+        {
+            BL_PROFILE("impactx::spacecharge::MLMGPoissonSolver::define");
+
+            // the solver references the operator: destruct it first
+            m_mlmg.reset();
+
+            amrex::LPInfo const info;
+            m_linop = std::make_unique<amrex::MLNodeTensorLaplacian>(
+                amrex::Vector<amrex::Geometry>{geom},
+                amrex::Vector<amrex::BoxArray>{grids},
+                amrex::Vector<amrex::DistributionMapping>{dmap},
+                info
+            );
+
+            amrex::Array<amrex::LinOpBCType, AMREX_SPACEDIM> const lobc = {
+                amrex::LinOpBCType::Dirichlet,
+                amrex::LinOpBCType::Dirichlet,
+                amrex::LinOpBCType::Dirichlet
+            };
+            amrex::Array<amrex::LinOpBCType, AMREX_SPACEDIM> const hibc = lobc;
+            m_linop->setDomainBC(lobc, hibc);
+
+            m_mlmg = std::make_unique<amrex::MLMG>(*m_linop);
+
+            m_geom = geom;
+            m_grids = grids;
+            m_dmap = dmap;
+        }
+
+        // The operator keeps the cell size of the geometry it was built with.
+        // With Dirichlet boundaries, the solution on the nodes only depends on
+        // the cell size, which we absorb into the tensor coefficients:
+        //   sigma_ij d_i d_j phi  with  sigma_ij = (delta_ij - beta_i beta_j) dx0_i dx0_j / (dx_i dx_j)
+        auto const dx0 = m_geom->CellSizeArray();
+        auto const dx = geom.CellSizeArray();
+        amrex::Real const r[3] = {dx0[0] / dx[0], dx0[1] / dx[1], dx0[2] / dx[2]};
+        auto const & b = beta_xyz;
+        m_linop->setSigma({
+            (1.0_rt - b[0] * b[0]) * r[0] * r[0],  // xx
+            -b[0] * b[1] * r[0] * r[1],         // xy
+            -b[0] * b[2] * r[0] * r[2],         // xz
+            (1.0_rt - b[1] * b[1]) * r[1] * r[1],  // yy
+            -b[1] * b[2] * r[1] * r[2],         // yz
+            (1.0_rt - b[2] * b[2]) * r[2] * r[2]   // zz
+        });
+
+        return rebuild;
+    }
+
+    int
+    MLMGPoissonSolver::solve (
+        amrex::MultiFab & phi,
+        amrex::MultiFab & rho,
+        amrex::Geometry const & geom,
+        std::array<amrex::Real, 3> const & beta_xyz,
+        amrex::Real relative_tolerance,
+        amrex::Real absolute_tolerance,
+        int max_iters,
+        int verbosity
+    )
+    {
+        BL_PROFILE("impactx::spacecharge::MLMGPoissonSolver::solve");
+
+        using namespace amrex::literals;
+        using ablastr::constant::SI::ep0;
+
+        // initial guess: the previous solution, on the current geometry
+        if (m_phi_geom.has_value() && m_grids == phi.boxArray() && m_dmap == phi.DistributionMap()) {
+            if (!same_geometry(*m_phi_geom, geom)) {
+                remap(phi, *m_phi_geom, geom);
+            }
+        } else {
+            phi.setVal(0.0_rt);
+        }
+
+        // right-hand side of the Poisson equation: div(grad(phi)) = -rho/ep0
+        rho.mult(-1._rt / ep0);
+
+        amrex::Real const max_norm_b = rho.norm0();
+        if (max_norm_b > 0.0_rt)
+        {
+            define_if_changed(geom, phi.boxArray(), phi.DistributionMap(), beta_xyz);
+
+            m_mlmg->setVerbose(verbosity);
+            m_mlmg->setMaxIter(max_iters);
+            m_mlmg->setAlwaysUseBNorm(true);
+            m_mlmg->solve(
+                amrex::Vector<amrex::MultiFab*>{&phi},
+                amrex::Vector<amrex::MultiFab const*>{&rho},
+                relative_tolerance,
+                absolute_tolerance
+            );
+            m_last_num_iters = m_mlmg->getNumIters();
+        }
+        else
+        {
+            // no charge: nothing to solve
+            phi.setVal(0.0_rt);
+            m_last_num_iters = 0;
+        }
+
+        // undo the scaling of rho
+        rho.mult(-1._rt * ep0);
+
+        m_phi_geom = geom;
+
+        return m_last_num_iters;
+    }
+
+    void
+    MLMGPoissonSolver::reset ()
+    {
+        m_mlmg.reset();
+        m_linop.reset();
+        m_geom.reset();
+        m_grids = amrex::BoxArray();
+        m_dmap = amrex::DistributionMapping();
+        m_phi_geom.reset();
+        m_last_num_iters = 0;
+    }
+
+} // namespace impactx::spacecharge
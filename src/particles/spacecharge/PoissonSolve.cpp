@@ -19,27 +19,25 @@
 #include <AMReX_REAL.H>       // for ParticleReal
 
 #include <cmath>
+#include <stdexcept>
+#include <string>
 
 
 namespace impactx::spacecharge
 {
-    void PoissonSolve (
+    int PoissonSolve (
         ImpactXParticleContainer const & pc,
         std::unordered_map<int, amrex::MultiFab> & rho,
         std::unordered_map<int, amrex::MultiFab> & phi,
-        amrex::Vector<amrex::IntVect> rel_ref_ratio
+        amrex::Vector<amrex::IntVect> rel_ref_ratio,
+        MLMGPoissonSolver & mlmg_solver
     )
     {
+        BL_PROFILE("impactx::spacecharge::PoissonSolve");
+
         using namespace amrex::literals;
 
-        // set space charge field to zero
-        //   loop over refinement levels
         int const finest_level = phi.size() - 1u;
-        for (int lev = 0; lev <= finest_level; ++lev) {
-            amrex::MultiFab &phi_at_level = phi.at(lev);
-            // reset the values in phi to zero
-            phi_at_level.setVal(0.);
-        }
 
         // prepare parameters of the MLMG Poisson Solver
         //   relativistic beta=v/c of the reference particle
@@ -71,6 +69,35 @@ namespace impactx::spacecharge
         pp_algo.queryAdd("mlmg_max_iters", mlmg_max_iters);
         pp_algo.queryAdd("mlmg_verbosity", mlmg_verbosity);
 
+        // persistent, warm-started multigrid solver
+        if (!is_solver_igf_on_lev0 && finest_level == 0)
+        {
+            int const num_iters = mlmg_solver.solve(
+                phi.at(0),
+                rho.at(0),
+                pc.GetParGDB()->Geom(0),
+                beta_xyz,
+                mlmg_relative_tolerance,
+                mlmg_absolute_tolerance,
+                mlmg_max_iters,
+                mlmg_verbosity
+            );
+
+            phi.at(0).FillBoundary(pc.GetParGDB()->Geom(0).periodicity());
+
+            return num_iters;
+        }
+
+        // FFT and mesh-refinement: solve from scratch
+        mlmg_solver.reset();
+
+        //   loop over refinement levels
+        for (int lev = 0; lev <= finest_level; ++lev) {
+            amrex::MultiFab &phi_at_level = phi.at(lev);
+            // reset the values in phi to zero
+            phi_at_level.setVal(0.);
+        }
+
         struct PoissonBoundaryHandler {
             amrex::Array<amrex::LinOpBCType, AMREX_SPACEDIM> const lobc = {
                 amrex::LinOpBCType::Dirichlet,
@@ -132,5 +159,7 @@ namespace impactx::spacecharge
             amrex::MultiFab & phi_at_level = phi.at(lev);
             phi_at_level.FillBoundary(pc.GetParGDB()->Geom()[lev].periodicity());
         }
+
+        return 0;
     }
 } // impactx::spacecharge
@@ -10,7 +10,12 @@
 #include "ChargeBinning.H"
 #include "particles/ImpactXParticleContainer.H"
 
+#include <AMReX_BLProfiler.H>
+#include <AMReX_GpuAtomic.H>
+#include <AMReX_GpuContainers.H>
+
 #include <cmath>
+#include <cstddef>
 
 
 namespace impactx::particles::wakefields
@@ -51,7 +56,7 @@ namespace impactx::particles::wakefields
                     amrex::ParticleReal* const AMREX_RESTRICT pos_z = soa.GetRealData(impactx::RealSoA::z).dataPtr();
 
                     // Parallel loop over particles
-                    amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE(int i)
+                    amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE(long i)
                     {
                         // Access particle z-position directly
                         amrex::ParticleReal const z = pos_z[i];  // (Macro)Particle longitudinal position at i
@@ -64,8 +69,8 @@ namespace impactx::particles::wakefields
                         */
 
                         // Calculate bin index based on z-position
-                        int const bin = int(amrex::Math::floor((z - bin_min) / bin_size));  // Round to nearest bin index integer
-                        if (bin < 0 || bin >= num_bins) { return; }  // Discard if bin index is out of range
+                        int const bin = BinIndex1D(z, bin_min, bin_size, num_bins);
+                        if (bin < 0) { return; }  // Discard if bin index is out of range
 
                         // Divide charge by bin size to get binned charge density
                         amrex::Real add_value = ablastr::constant::SI::q_e / bin_size;
@@ -155,15 +160,15 @@ namespace impactx::particles::wakefields
                     amrex::Real* const AMREX_RESTRICT pos_z = soa.GetRealData(impactx::RealSoA::z).dataPtr();
                     amrex::Real* const AMREX_RESTRICT d_w = soa.GetRealData(impactx::RealSoA::w).dataPtr();
 
-                    amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE(int i)
+                    amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE(long i)
                     {
                         amrex::Real const w = d_w[i];
                         amrex::Real const x = pos_x[i];
                         amrex::Real const y = pos_y[i];
                         amrex::Real const z = pos_z[i];
 
-                        int const bin = int(amrex::Math::floor((z - bin_min) / bin_size));
-                        if (bin < 0 || bin >= num_bins) { return; }
+                        int const bin = BinIndex1D(z, bin_min, bin_size, num_bins);
+                        if (bin < 0) { return; }
 
                         amrex::Real const weight = is_unity_particle_weight ? 1.0_rt : w;  // Check is macroparticle made up of 1 or more particles
 
@@ -189,4 +194,107 @@ namespace impactx::particles::wakefields
             }
         });
     }
+
+    void DepositMoments1D (
+        impactx::ImpactXParticleContainer const & myspc,
+        std::vector<double> & sums,
+        amrex::Real bin_min,
+        amrex::Real bin_size,
+        int num_bins,
+        amrex::GpuArray<double, 5> const & shift
+    )
+    {
+        BL_PROFILE("impactx::wakefields::DepositMoments1D");
+
+        sums.assign(std::size_t(num_bins) * SliceSum::nsums, 0.0);
+
+#ifdef AMREX_USE_GPU
+        amrex::Gpu::DeviceVector<double> d_sums(sums.size(), 0.0);
+        double * const d_sums_ptr = d_sums.data();
+#endif
+
+        int const nlevs = myspc.finestLevel();
+        for (int lev = 0; lev <= nlevs; ++lev)
+        {
+#ifdef AMREX_USE_OMP
+#pragma omp parallel if (amrex::Gpu::notInLaunchRegion())
+#endif
+            {
+#ifdef AMREX_USE_GPU
+                double * const acc = d_sums_ptr;
+#else
+                // thread-private accumulators
+                std::vector<double> thread_sums(sums.size(), 0.0);
+                double * const acc = thread_sums.data();
+#endif
+
+                for (impactx::ParConstIterSoA pti(myspc, lev); pti.isValid(); ++pti)
+                {
+                    auto const & soa = pti.GetStructOfArrays();
+                    long const np = pti.numParticles();
+
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_x = soa.GetRealData(impactx::RealSoA::x).dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_y = soa.GetRealData(impactx::RealSoA::y).dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_t = soa.GetRealData(impactx::RealSoA::t).dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_px = soa.GetRealData(impactx::RealSoA::px).dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_py = soa.GetRealData(impactx::RealSoA::py).dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_pt = soa.GetRealData(impactx::RealSoA::pt).dataPtr();
+                    amrex::ParticleReal const * const AMREX_RESTRICT part_w = soa.GetRealData(impactx::RealSoA::w).dataPtr();
+
+                    auto const deposit = [=] AMREX_GPU_HOST_DEVICE (long i)
+                    {
+                        int const bin = BinIndex1D(part_t[i], bin_min, bin_size, num_bins);
+                        if (bin < 0) { return; }
+
+                        // relative to the shift, against cancellation in the second moments
+                        double const w = part_w[i];
+                        double const x = part_x[i] - shift[0];
+                        double const y = part_y[i] - shift[1];
+                        double const px = part_px[i] - shift[2];
+                        double const py = part_py[i] - shift[3];
+                        double const pt = part_pt[i] - shift[4];
+
+                        double const values[SliceSum::nsums] = {
+                            w, 1.0,
+                            w*x, w*y, w*px, w*py, w*pt,
+                            w*x*x, w*x*px, w*px*px,
+                            w*y*y, w*y*py, w*py*py,
+                            w*pt*pt
+                        };
+
+                        double * const bin_sums = acc + std::size_t(bin) * SliceSum::nsums;
+                        for (int k = 0; k < SliceSum::nsums; ++k)
+                        {
+#ifdef AMREX_USE_GPU
+                            amrex::Gpu::Atomic::AddNoRet(&bin_sums[k], values[k]);
+#else
+                            bin_sums[k] += values[k];
+#endif
+                        }
+                    };
+
+#ifdef AMREX_USE_GPU
+                    amrex::ParallelFor(np, deposit);
+#else
+                    // serial scatter into the thread-private bins: particles of one tile can share a bin
+                    for (long i = 0; i < np; ++i) { deposit(i); }
+#endif
+                }
+
+#ifndef AMREX_USE_GPU
+                // merge the thread-private accumulators
+#ifdef AMREX_USE_OMP
+#pragma omp critical (impactx_deposit_moments_1d)
+#endif
+                for (std::size_t k = 0; k < sums.size(); ++k) {
+                    sums[k] += thread_sums[k];
+                }
+#endif
+            }
+        }
+
+#ifdef AMREX_USE_GPU
+        amrex::Gpu::copy(amrex::Gpu::deviceToHost, d_sums.begin(), d_sums.end(), sums.begin());
+#endif
+    }
 }
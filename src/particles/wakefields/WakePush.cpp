@@ -46,7 +46,7 @@ namespace impactx::particles::wakefields
 #endif
             for (ParIt pti(pc, lev); pti.isValid(); ++pti)
             {
-                const int np = pti.numParticles();
+                const long np = pti.numParticles();
 
                 // Physical constants and reference quantities
                 amrex::ParticleReal const mc_SI = pc.GetRefParticle().mass * (ablastr::constant::SI::c);
@@ -63,7 +63,7 @@ namespace impactx::particles::wakefields
 
                 // Gather particles and push momentum
                 const amrex::Real* wakefield_ptr = convolved_wakefield.data();
-                amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (int i)
+                amrex::ParallelFor(np, [=] AMREX_GPU_DEVICE (long i)
                 {
                     // Access SoA Real data
                     amrex::ParticleReal const & AMREX_RESTRICT t = part_t[i];
@@ -6,6 +6,7 @@
 #include "pyImpactX.H"
 
 #include <ImpactX.H>
+#include <particles/spacecharge/PoissonSolve.H>
 #include <particles/transformation/CoordinateTransformation.H>
 
 #include <AMReX.H>
@@ -16,6 +17,7 @@
 #   include <cstdio>
 #endif
 #include <string>
+#include <type_traits>
 
 
 namespace py = pybind11;
@@ -233,6 +235,173 @@ void init_ImpactX (py::module& m)
              },
              "Enable or disable space charge calculations (default: enabled)."
         )
+        .def_property("small_beam",
+             [](ImpactX & /* ix */) {
+                 return detail::get_or_throw<bool>("algo", "small_beam");
+             },
+             [](ImpactX & /* ix */, bool const enable) {
+                 amrex::ParmParse pp_algo("algo");
+                 pp_algo.add("small_beam", enable);
+             },
+             "Track small beams on the host, with low overhead per slice step (default: disabled).\n"
+             "Not possible with space charge, CSR or slice step diagnostics."
+        )
+        .def_property("track",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<std::string>("algo", "track");
+            },
+            [](ImpactX & /* ix */, std::string const track) {
+                if (track != "particles" && track != "envelope" && track != "dynamic_aperture") {
+                    throw std::runtime_error("Tracking mode must be particles, envelope or dynamic_aperture but is: " + track);
+                }
+
+                amrex::ParmParse pp_algo("algo");
+                pp_algo.add("track", track);
+            },
+            "The tracking mode: particles (default), envelope or dynamic_aperture.\n\n"
+            "In envelope mode, the beam centroid and 6x6 covariance matrix are tracked with linear maps.\n"
+            "In dynamic_aperture mode, a grid of probe particles is tracked, see the ``da_`` properties."
+        )
+        .def_property("da_plane",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<std::string>("da", "plane");
+            },
+            [](ImpactX & /* ix */, std::string const plane) {
+                if (plane != "xy" && plane != "xpx") {
+                    throw std::runtime_error("Dynamic aperture plane must be xy or xpx but is: " + plane);
+                }
+
+                amrex::ParmParse pp_da("da");
+                pp_da.add("plane", plane);
+            },
+            "Dynamic aperture scan: the plane of the grid of probes, xy (default) or xpx."
+        )
+        .def_property("da_x_min",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<amrex::ParticleReal>("da", "x_min");
+            },
+            [](ImpactX & /* ix */, amrex::ParticleReal const x_min) {
+                amrex::ParmParse pp_da("da");
+                pp_da.add("x_min", x_min);
+            },
+            "Dynamic aperture scan: smallest x of the probes in m."
+        )
+        .def_property("da_x_max",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<amrex::ParticleReal>("da", "x_max");
+            },
+            [](ImpactX & /* ix */, amrex::ParticleReal const x_max) {
+                amrex::ParmParse pp_da("da");
+                pp_da.add("x_max", x_max);
+            },
+            "Dynamic aperture scan: largest x of the probes in m."
+        )
+        .def_property("da_num_x",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<int>("da", "num_x");
+            },
+            [](ImpactX & /* ix */, int const num_x) {
+                amrex::ParmParse pp_da("da");
+                pp_da.add("num_x", num_x);
+            },
+            "Dynamic aperture scan: number of probes along x."
+        )
+        .def_property("da_v_min",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<amrex::ParticleReal>("da", "v_min");
+            },
+            [](ImpactX & /* ix */, amrex::ParticleReal const v_min) {
+                amrex::ParmParse pp_da("da");
+                pp_da.add("v_min", v_min);
+            },
+            "Dynamic aperture scan: smallest second coordinate of the probes, y in m or px."
+        )
+        .def_property("da_v_max",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<amrex::ParticleReal>("da", "v_max");
+            },
+            [](ImpactX & /* ix */, amrex::ParticleReal const v_max) {
+                amrex::ParmParse pp_da("da");
+                pp_da.add("v_max", v_max);
+            },
+            "Dynamic aperture scan: largest second coordinate of the probes, y in m or px."
+        )
+        .def_property("da_num_v",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<int>("da", "num_v");
+            },
+            [](ImpactX & /* ix */, int const num_v) {
+                amrex::ParmParse pp_da("da");
+                pp_da.add("num_v", num_v);
+            },
+            "Dynamic aperture scan: number of probes along the second coordinate."
+        )
+        .def_property("da_pt",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<amrex::ParticleReal>("da", "pt");
+            },
+            [](ImpactX & /* ix */, amrex::ParticleReal const pt) {
+                amrex::ParmParse pp_da("da");
+                pp_da.add("pt", pt);
+            },
+            "Dynamic aperture scan: energy deviation pt of all probes (default: 0)."
+        )
+        .def_property("da_max_amplitude",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<amrex::ParticleReal>("da", "max_amplitude");
+            },
+            [](ImpactX & /* ix */, amrex::ParticleReal const max_amplitude) {
+                amrex::ParmParse pp_da("da");
+                pp_da.add("max_amplitude", max_amplitude);
+            },
+            "Dynamic aperture scan: probes with larger |x| or |y| in m are lost (default: 1)."
+        )
+        .def_property("ensemble_ranks_per_member",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<int>("algo", "ensemble_ranks_per_member");
+            },
+            [](ImpactX & /* ix */, int const ranks_per_member) {
+                amrex::ParmParse pp_algo("algo");
+                pp_algo.add("ensemble_ranks_per_member", ranks_per_member);
+            },
+            "Number of MPI ranks that hold the particles of one ensemble member (default: all ranks)."
+        )
+        .def_property("rng_seed",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<amrex::Long>("algo", "rng_seed");
+            },
+            [](ImpactX & /* ix */, amrex::Long const seed) {
+                amrex::ParmParse pp_algo("algo");
+                pp_algo.add("rng_seed", seed);
+            },
+            "Random seed for the initial beam distribution (default: 0).\n\n"
+            "The initial beam is the same for any number of MPI ranks, threads or GPUs."
+        )
+        .def_property("init_sampling",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<std::string>("algo", "init_sampling");
+            },
+            [](ImpactX & /* ix */, std::string const sampling) {
+                if (sampling != "random" && sampling != "halton") {
+                    throw std::runtime_error("init_sampling must be random or halton but is: " + sampling);
+                }
+
+                amrex::ParmParse pp_algo("algo");
+                pp_algo.add("init_sampling", sampling);
+            },
+            "Sampling of the initial beam: random (default) or halton (quasi-random)."
+        )
+        .def_property("init_chunk_size",
+            [](ImpactX & /* ix */) {
+                return detail::get_or_throw<amrex::Long>("algo", "init_chunk_size");
+            },
+            [](ImpactX & /* ix */, amrex::Long const chunk_size) {
+                amrex::ParmParse pp_algo("algo");
+                pp_algo.add("init_chunk_size", chunk_size);
+            },
+            "Maximum number of particles sampled per kernel launch on each MPI rank during beam initialization (default: 0, all at once). "
+            "This limits the launch size, not the peak memory."
+        )
         .def_property("poisson_solver",
             [](ImpactX & /* ix */) {
                 return detail::get_or_throw<std::string>("algo", "poisson_solver");
@@ -332,6 +501,37 @@ void init_ImpactX (py::module& m)
              "The minimum number of digits (default: 6) used for the step\n"
              "number appended to the diagnostic file names."
         )
+        .def_property("diag_async_io",
+             [](ImpactX & /* ix */) {
+                 return detail::get_or_throw<bool>("diag", "async_io");
+             },
+             [](ImpactX & /* ix */, bool const async_io) {
+                 amrex::ParmParse pp_diag("diag");
+                 pp_diag.add("async_io", async_io);
+             },
+             "Write BeamMonitor output on a background thread (default: disabled),\n"
+             "while the simulation continues. Needs MPI_THREAD_MULTIPLE."
+        )
+        .def_property("diag_loss_map",
+             [](ImpactX & /* ix */) {
+                 return detail::get_or_throw<bool>("diag", "loss_map");
+             },
+             [](ImpactX & /* ix */, bool const loss_map) {
+                 amrex::ParmParse pp_diag("diag");
+                 pp_diag.add("loss_map", loss_map);
+             },
+             "Write a loss map of the lost particles per element, s-bin and period (default: disabled)."
+        )
+        .def_property("diag_loss_map_ds",
+             [](ImpactX & /* ix */) {
+                 return detail::get_or_throw<amrex::ParticleReal>("diag", "loss_map_ds");
+             },
+             [](ImpactX & /* ix */, amrex::ParticleReal const loss_map_ds) {
+                 amrex::ParmParse pp_diag("diag");
+                 pp_diag.add("loss_map_ds", loss_map_ds);
+             },
+             "Width of the bins in s of the loss map, in meters (default: 0.1)."
+        )
         .def_property("particle_lost_diagnostics_backend",
                       [](ImpactX & /* ix */) {
                           return detail::get_or_throw<std::string>("diag", "backend");
@@ -420,6 +620,30 @@ void init_ImpactX (py::module& m)
             },
             "Deposit charge in x,y,z."
         )
+        .def("poisson_solve",
+            [](ImpactX & ix) {
+                return spacecharge::PoissonSolve(*ix.amr_data->m_particle_container,
+                                                 ix.amr_data->m_rho,
+                                                 ix.amr_data->m_phi,
+                                                 ix.amr_data->refRatio(),
+                                                 ix.amr_data->m_poisson_solver);
+            },
+            "Solve the Poisson equation for phi from the deposited charge density rho.\n\n"
+            "The multigrid solver is warm-started from the previous phi.\n"
+            "Returns the number of MLMG iterations (0 for the FFT solver)."
+        )
+        .def("reset_poisson_solver",
+            [](ImpactX & ix) {
+                ix.amr_data->m_poisson_solver.reset();
+            },
+            "Forget the multigrid operator and the previous phi, so that the next solve starts cold."
+        )
+        .def_property_readonly("mlmg_num_iters",
+            [](ImpactX & ix) {
+                return ix.amr_data->m_poisson_solver.last_num_iters();
+            },
+            "Number of MLMG iterations of the last multigrid Poisson solve."
+        )
 
         .def("finalize", &ImpactX::finalize,
              "Deallocate all contexts and data."
@@ -438,6 +662,47 @@ void init_ImpactX (py::module& m)
              "distribution's extent and then redistribute particles in according\n"
              "AMReX grid boxes."
         )
+        .def("add_particles_from_openpmd", &ImpactX::add_particles_from_openpmd,
+             py::arg("filepath"), py::arg("species") = "beam",
+             py::arg("iteration") = -1, py::arg("bunch_charge") = -1.0,
+             "Read particles from an openPMD series and add them to the particle container.\n\n"
+             "The series uses the schema of the BeamMonitor. The particles are converted\n"
+             "to the reference particle of the simulation. Each MPI rank reads its own slice.\n"
+             "A negative iteration reads the last iteration. A negative bunch charge (C)\n"
+             "keeps the weights of the file, otherwise they are rescaled to it."
+        )
+        .def("init_envelope", &ImpactX::init_envelope,
+             py::arg("bunch_charge"),
+             py::arg("distr"), py::arg("current") = 0.0,
+             "Initialize the beam envelope for envelope tracking.\n\n"
+             "The first and second moments of the beam are calculated from the\n"
+             "distribution parameters. The beam current (A) is used for\n"
+             "envelope space charge."
+        )
+        .def("add_ensemble_member", &ImpactX::add_ensemble_member,
+             py::arg("ref"), py::arg("lattice"), py::arg("bunch_charge"),
+             py::arg("distr"), py::arg("npart"),
+             "Add a member to the ensemble of simulations and generate its particles.\n\n"
+             "Each member has its own reference particle and lattice variant.\n"
+             "All members are tracked together in one call to evolve.\n"
+             "Returns the index of the new member."
+        )
+        .def("ensemble_reduced_beam_characteristics", &ImpactX::ensemble_reduced_beam_characteristics,
+             "Compute reduced beam characteristics of all ensemble members.\n\n"
+             "Returns a list with one dictionary per member."
+        )
+        .def("ensemble_ref_particle",
+             [](ImpactX & ix, int const member) -> RefPart & {
+                 return ix.m_ensemble.at(member).m_ref_part;
+             },
+             py::arg("member"),
+             py::return_value_policy::reference_internal,
+             "Access the reference particle of an ensemble member."
+        )
+        .def_property_readonly("ensemble_size",
+             [](ImpactX const & ix) { return ix.m_ensemble.size(); },
+             "The number of ensemble members."
+        )
 
         .def("evolve", &ImpactX::evolve,
              "Run the main simulation loop for a number of steps."
@@ -556,5 +821,11 @@ void init_ImpactX (py::module& m)
                 return py::none();
 #endif
             })
+        .def_property_readonly_static(
+            "precision",
+            [](py::object const &){
+                return std::is_same_v<amrex::ParticleReal, float> ? "SINGLE" : "DOUBLE";
+            },
+            "Floating point precision of the particle data: SINGLE or DOUBLE")
         ;
 }
@@ -6,19 +6,117 @@
 #include "pyImpactX.H"
 
 #include <particles/ImpactXParticleContainer.H>
+#include <particles/diagnostics/PhaseSpaceHistogram.H>
 #include <particles/diagnostics/ReducedBeamCharacteristics.H>
+#include <particles/diagnostics/SlicedBeamCharacteristics.H>
 
 #include <AMReX.H>
+#include <AMReX_GpuContainers.H>
 #include <AMReX_MFIter.H>
+#include <AMReX_ParallelDescriptor.H>
 #include <AMReX_ParticleContainer.H>
 
+#include <pybind11/numpy.h>
+
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 namespace py = pybind11;
 using namespace impactx;
 
+namespace
+{
+    /** A contiguous, one-dimensional array of particle attributes from Python */
+    struct ArrayView
+    {
+        amrex::ParticleReal const * ptr = nullptr; ///< first element
+        std::size_t size = 0; ///< number of elements
+        bool device_memory = false; ///< the data is in device memory
+        py::object owner; ///< keeps the data alive
+    };
+
+    /** Access the data of a Python array without copying it
+     *
+     * Objects with a ``__cuda_array_interface__`` (e.g., CuPy, PyTorch,
+     * Numba) are accessed in device memory, all other objects through the
+     * buffer protocol (e.g., NumPy) in host memory.
+     *
+     * @param obj the Python array
+     * @param name the attribute name, for error messages
+     */
+    ArrayView
+    array_view (py::object const & obj, std::string const & name)
+    {
+        ArrayView view;
+
+        if (py::hasattr(obj, "__cuda_array_interface__"))
+        {
+#ifndef AMREX_USE_GPU
+            throw std::runtime_error("add_n_particles: " + name +
+                " is a device array, but ImpactX was built without GPU support.");
+#else
+            auto const cai = obj.attr("__cuda_array_interface__").cast<py::dict>();
+
+            std::string const typestr = cai["typestr"].cast<std::string>();
+            std::string const expected = "<f" + std::to_string(sizeof(amrex::ParticleReal));
+            if (typestr != expected) {
+                throw std::runtime_error("add_n_particles: " + name + " has type " + typestr +
+                                         ", but " + expected + " is required.");
+            }
+
+            auto const shape = cai["shape"].cast<py::tuple>();
+            if (shape.size() != 1) {
+                throw std::runtime_error("add_n_particles: " + name + " must be one-dimensional.");
+            }
+            if (cai.contains("strides") && !cai["strides"].is_none()) {
+                auto const strides = cai["strides"].cast<py::tuple>();
+                if (strides[0].cast<std::size_t>() != sizeof(amrex::ParticleReal)) {
+                    throw std::runtime_error("add_n_particles: " + name + " must be contiguous.");
+                }
+            }
+
+            auto const data = cai["data"].cast<py::tuple>();
+            view.ptr = reinterpret_cast<amrex::ParticleReal const *>(data[0].cast<std::uintptr_t>());
+            view.size = shape[0].cast<std::size_t>();
+            view.device_memory = true;
+            view.owner = obj;
+#endif
+        }
+        else
+        {
+            // no silent conversion: the array is used in place and must already
+            // be contiguous and of the floating point type of the particle data
+            auto arr = py::array::ensure(obj);
+            if (!arr) {
+                throw std::runtime_error("add_n_particles: " + name +
+                    " does not support the buffer protocol or __cuda_array_interface__.");
+            }
+            if (arr.dtype().kind() != 'f' || arr.itemsize() != py::ssize_t(sizeof(amrex::ParticleReal))) {
+                throw std::runtime_error("add_n_particles: " + name + " has type " +
+                    std::string(py::str(arr.dtype())) + ", but float" +
+                    std::to_string(8 * sizeof(amrex::ParticleReal)) + " is required.");
+            }
+            if (arr.ndim() != 1) {
+                throw std::runtime_error("add_n_particles: " + name + " must be one-dimensional.");
+            }
+            if (arr.size() > 1 && arr.strides(0) != py::ssize_t(sizeof(amrex::ParticleReal))) {
+                throw std::runtime_error("add_n_particles: " + name + " must be contiguous.");
+            }
+
+            view.ptr = static_cast<amrex::ParticleReal const *>(arr.data());
+            view.size = arr.size();
+            view.device_memory = false;
+            view.owner = std::move(arr);
+        }
+
+        return view;
+    }
+} // namespace
+
 
 void init_impactxparticlecontainer(py::module& m)
 {
@@ -74,7 +172,16 @@ void init_impactxparticlecontainer(py::module& m)
         )
 
         .def("add_n_particles",
-             &ImpactXParticleContainer::AddNParticles,
+             py::overload_cast<
+                 amrex::Gpu::DeviceVector<amrex::ParticleReal> const &,
+                 amrex::Gpu::DeviceVector<amrex::ParticleReal> const &,
+                 amrex::Gpu::DeviceVector<amrex::ParticleReal> const &,
+                 amrex::Gpu::DeviceVector<amrex::ParticleReal> const &,
+                 amrex::Gpu::DeviceVector<amrex::ParticleReal> const &,
+                 amrex::Gpu::DeviceVector<amrex::ParticleReal> const &,
+                 amrex::ParticleReal,
+                 amrex::ParticleReal
+             >(&ImpactXParticleContainer::AddNParticles),
              py::arg("x"), py::arg("y"), py::arg("t"),
              py::arg("px"), py::arg("py"), py::arg("pt"),
              py::arg("qm"), py::arg("bchchg"),
@@ -91,6 +198,61 @@ void init_impactxparticlecontainer(py::module& m)
              ":param qm: charge over mass in 1/eV\n"
              ":param bchchg: total charge within a bunch in C"
         )
+        .def("add_n_particles",
+             [](ImpactXParticleContainer & pc,
+                py::object const & x_arr, py::object const & y_arr, py::object const & t_arr,
+                py::object const & px_arr, py::object const & py_arr, py::object const & pt_arr,
+                amrex::ParticleReal qm, amrex::ParticleReal bchchg,
+                bool rank_slice)
+             {
+                 std::array<ArrayView, 6> const views = {
+                     array_view(x_arr, "x"), array_view(y_arr, "y"), array_view(t_arr, "t"),
+                     array_view(px_arr, "px"), array_view(py_arr, "py"), array_view(pt_arr, "pt")
+                 };
+                 for (auto const & view : views) {
+                     if (view.size != views[0].size || view.device_memory != views[0].device_memory) {
+                         throw std::runtime_error(
+                             "add_n_particles: all arrays must have the same length and memory location.");
+                     }
+                 }
+
+                 // all ranks pass the same arrays: every rank adds its own slice
+                 std::size_t offset = 0;
+                 std::size_t count = views[0].size;
+                 if (rank_slice && count > 0) {
+                     auto const myproc = static_cast<std::size_t>(amrex::ParallelDescriptor::MyProc());
+                     auto const nprocs = static_cast<std::size_t>(amrex::ParallelDescriptor::NProcs());
+                     std::size_t const navg = views[0].size / nprocs;
+                     std::size_t const nleft = views[0].size - navg * nprocs;
+                     count = (myproc < nleft) ? navg+1 : navg;
+                     offset = myproc * navg + std::min(myproc, nleft);
+                     bchchg *= amrex::ParticleReal(count) / amrex::ParticleReal(views[0].size);
+                 }
+
+                 pc.AddNParticles(static_cast<amrex::Long>(count),
+                                  views[0].ptr + offset, views[1].ptr + offset, views[2].ptr + offset,
+                                  views[3].ptr + offset, views[4].ptr + offset, views[5].ptr + offset,
+                                  qm, bchchg, views[0].device_memory);
+             },
+             py::arg("x"), py::arg("y"), py::arg("t"),
+             py::arg("px"), py::arg("py"), py::arg("pt"),
+             py::arg("qm"), py::arg("bchchg"), py::arg("rank_slice") = false,
+             "Add new particles to the container for fixed s, from NumPy, CuPy or other arrays.\n\n"
+             "The particle attributes are copied directly into the particle tile,\n"
+             "without intermediate buffers. Host arrays are accessed via the buffer\n"
+             "protocol, device arrays via ``__cuda_array_interface__``. The arrays\n"
+             "are not converted: they must be one-dimensional, contiguous and of the\n"
+             "floating point type of the particle data.\n\n"
+             ":param x: positions in x\n"
+             ":param y: positions in y\n"
+             ":param t: positions as time-of-flight in c*t\n"
+             ":param px: momentum in x\n"
+             ":param py: momentum in y\n"
+             ":param pt: momentum in t\n"
+             ":param qm: charge over mass in 1/eV\n"
+             ":param bchchg: total charge of the particles in the arrays in C\n"
+             ":param rank_slice: all MPI ranks pass the same arrays and each rank adds only its own slice"
+        )
         .def("ref_particle",
             py::overload_cast<>(&ImpactXParticleContainer::GetRefParticle),
             py::return_value_policy::reference_internal,
@@ -117,6 +279,52 @@ void init_impactxparticlecontainer(py::module& m)
              },
              "Compute reduced beam characteristics like the position and momentum moments of the particle distribution, as well as emittance and Twiss parameters."
         )
+        .def("covariance_matrix",
+             [](ImpactXParticleContainer & pc) {
+                 auto const cm = diagnostics::beam_moments(pc).cm;
+                 std::array<std::array<amrex::ParticleReal, 6>, 6> rows;
+                 for (int i = 0; i < 6; ++i) {
+                     for (int j = 0; j < 6; ++j) {
+                         rows[i][j] = cm(i + 1, j + 1);
+                     }
+                 }
+                 return rows;
+             },
+             "Compute the 6x6 covariance matrix of the particle distribution in the basis (x, px, y, py, t, pt)."
+        )
+        .def("phase_space_histogram",
+             [](ImpactXParticleContainer & pc,
+                std::vector<std::string> const & components,
+                int num_bins,
+                std::vector<std::array<amrex::ParticleReal, 2>> const & ranges)
+             {
+                 auto const hist = diagnostics::phase_space_histogram(
+                     pc, components, std::vector<int>(components.size(), num_bins), ranges);
+
+                 std::vector<py::ssize_t> shape(hist.num_bins.begin(), hist.num_bins.end());
+                 py::array_t<double> data(shape);
+                 std::copy(hist.data.begin(), hist.data.end(), data.mutable_data());
+
+                 std::vector<std::array<amrex::ParticleReal, 2>> extent;
+                 for (std::size_t d = 0; d < hist.components.size(); ++d) {
+                     extent.push_back({hist.lower[d], hist.upper[d]});
+                 }
+                 return py::make_tuple(data, extent);
+             },
+             py::arg("components"),
+             py::arg("num_bins") = 64,
+             py::arg("ranges") = std::vector<std::array<amrex::ParticleReal, 2>>{},
+             "Compute a weighted histogram of 1 to 4 particle components, e.g., [\"x\", \"px\"], on the device.\n\n"
+             "The histogram is summed over all MPI ranks.\n"
+             ":return: the sum of the particle weights per bin (numpy array with one axis per component) and the [lower, upper] extent of each axis"
+        )
+        .def("sliced_beam_characteristics",
+             [](ImpactXParticleContainer & pc, int num_bins) {
+                 return diagnostics::sliced_beam_characteristics(pc, num_bins);
+             },
+             py::arg("num_bins") = 64,
+             "Compute beam characteristics of num_bins longitudinal slices of equal width along t, like the charge, current, rms sizes, energy spread and emittances per slice."
+        )
 
         .def("redistribute",
              &ImpactXParticleContainer::Redistribute,
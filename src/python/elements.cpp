@@ -9,6 +9,9 @@
 #include <particles/elements/All.H>
 #include <AMReX.H>
 
+#include <cstdint>
+#include <map>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -136,10 +139,24 @@ void init_elements(py::module& m)
 
     py::class_<diagnostics::BeamMonitor, elements::Thin> py_BeamMonitor(me, "BeamMonitor");
     py_BeamMonitor
-        .def(py::init<std::string, std::string, std::string>(),
+        .def(py::init([](
+                std::string const & name,
+                std::string const & backend,
+                std::string const & encoding,
+                std::string const & config
+             )
+             {
+                 // read by the constructor, which creates the openPMD series
+                 if (!config.empty()) {
+                     amrex::ParmParse pp_element(name);
+                     pp_element.add("openpmd_config", config);
+                 }
+                 return new diagnostics::BeamMonitor(name, backend, encoding);
+             }),
              py::arg("name"),
              py::arg("backend") = "default",
              py::arg("encoding") = "g",
+             py::arg("config") = "",
              "This element writes the particle beam out to openPMD data."
         )
         .def_property_readonly("name",
@@ -188,8 +205,124 @@ void init_elements(py::module& m)
             },
             "Scale factor (in meters^(1/2)) of the IOTA nonlinear magnetic insert element used for computing H and I."
         )
+        .def_property("histograms",
+            [](diagnostics::BeamMonitor & bm) {
+                std::vector<std::string> histograms;
+                amrex::ParmParse(bm.series_name()).queryarr("histograms", histograms);
+                return histograms;
+            },
+            [](diagnostics::BeamMonitor & bm, std::vector<std::string> const & histograms) {
+                amrex::ParmParse pp_element(bm.series_name());
+                pp_element.addarr("histograms", histograms);
+            },
+            "Phase space histograms to compute in situ, e.g., [\"x:px\", \"x:y:px:py\"], with 1 to 4 particle components separated by colons."
+        )
+        .def_property("histogram_bins",
+            [](diagnostics::BeamMonitor & bm) { return detail::get_or_throw<int>(bm.series_name(), "histogram_bins"); },
+            [](diagnostics::BeamMonitor & bm, int histogram_bins) {
+                amrex::ParmParse pp_element(bm.series_name());
+                pp_element.add("histogram_bins", histogram_bins);
+            },
+            "Number of bins per axis of the phase space histograms."
+        )
+        .def_property("write_particles",
+            [](diagnostics::BeamMonitor & bm) { return detail::get_or_throw<bool>(bm.series_name(), "write_particles"); },
+            [](diagnostics::BeamMonitor & bm, bool write_particles) {
+                amrex::ParmParse pp_element(bm.series_name());
+                pp_element.add("write_particles", write_particles);
+            },
+            "Write the beam particles (default: true). Disable to write only the phase space histograms."
+        )
+        .def_property("write_reduced_beam_characteristics",
+            [](diagnostics::BeamMonitor & bm) { return detail::get_or_throw<bool>(bm.series_name(), "write_reduced_beam_characteristics"); },
+            [](diagnostics::BeamMonitor & bm, bool write_rbc) {
+                amrex::ParmParse pp_element(bm.series_name());
+                pp_element.add("write_reduced_beam_characteristics", write_rbc);
+            },
+            "Without particles, write the reduced beam characteristics as attributes of each step (default: false)."
+        )
+        .def_property("period_interval",
+            [](diagnostics::BeamMonitor & bm) { return detail::get_or_throw<int>(bm.series_name(), "period_interval"); },
+            [](diagnostics::BeamMonitor & bm, int period_interval) {
+                amrex::ParmParse pp_element(bm.series_name());
+                pp_element.add("period_interval", period_interval);
+            },
+            "Write only every N-th time the beam passes this element, e.g., every N-th period of a ring (default: 1)."
+        )
+        .def_property("filter_fraction",
+            [](diagnostics::BeamMonitor & bm) { return detail::get_or_throw<amrex::ParticleReal>(bm.series_name(), "filter_fraction"); },
+            [](diagnostics::BeamMonitor & bm, amrex::ParticleReal filter_fraction) {
+                amrex::ParmParse pp_element(bm.series_name());
+                pp_element.add("filter_fraction", filter_fraction);
+            },
+            "Write a random fraction of the particles, in (0, 1] (default: 1).\n"
+            "The selection depends only on the particle id and filter_seed: the same particles are written in every step."
+        )
+        .def_property("filter_seed",
+            [](diagnostics::BeamMonitor & bm) { return detail::get_or_throw<int>(bm.series_name(), "filter_seed"); },
+            [](diagnostics::BeamMonitor & bm, int filter_seed) {
+                amrex::ParmParse pp_element(bm.series_name());
+                pp_element.add("filter_seed", filter_seed);
+            },
+            "Random seed of filter_fraction (default: 0)."
+        )
+        .def_property("filter_every_nth_id",
+            [](diagnostics::BeamMonitor & bm) { return detail::get_or_throw<amrex::Long>(bm.series_name(), "filter_every_nth_id"); },
+            [](diagnostics::BeamMonitor & bm, amrex::Long filter_every_nth_id) {
+                amrex::ParmParse pp_element(bm.series_name());
+                pp_element.add("filter_every_nth_id", filter_every_nth_id);
+            },
+            "Write only particles with an id that is a multiple of N (default: 1)."
+        )
+        .def_property("filter_ids",
+            [](diagnostics::BeamMonitor & bm) {
+                std::vector<std::string> id_strings;
+                amrex::ParmParse(bm.series_name()).queryarr("filter_ids", id_strings);
+                std::vector<uint64_t> filter_ids;
+                for (auto const & id_string : id_strings) { filter_ids.push_back(std::stoull(id_string)); }
+                return filter_ids;
+            },
+            [](diagnostics::BeamMonitor & bm, std::vector<uint64_t> const & filter_ids) {
+                // note: ParmParse has no unsigned 64bit integers
+                std::vector<std::string> id_strings;
+                for (auto const id : filter_ids) { id_strings.push_back(std::to_string(id)); }
+                amrex::ParmParse pp_element(bm.series_name());
+                pp_element.addarr("filter_ids", id_strings);
+            },
+            "Write only the particles with these ids, as in the id record of the openPMD output, e.g., tracer particles (default: all)."
+        )
+        .def_property("float32_records",
+            [](diagnostics::BeamMonitor & bm) {
+                std::vector<std::string> float32_records;
+                amrex::ParmParse(bm.series_name()).queryarr("float32_records", float32_records);
+                return float32_records;
+            },
+            [](diagnostics::BeamMonitor & bm, std::vector<std::string> const & float32_records) {
+                amrex::ParmParse pp_element(bm.series_name());
+                pp_element.addarr("float32_records", float32_records);
+            },
+            "Particle components to write in single precision, e.g., [\"qm\", \"weighting\"] (default: none)."
+        )
     ;
 
+    // phase space region filters, e.g., filter_region_x = (-1e-3, 1e-3)
+    for (std::string const comp : {"x", "y", "t", "px", "py", "pt"})
+    {
+        std::string const name = "filter_region_" + comp;
+        py_BeamMonitor.def_property(name.c_str(),
+            [name](diagnostics::BeamMonitor & bm) {
+                std::vector<amrex::ParticleReal> range;
+                amrex::ParmParse(bm.series_name()).queryarr(name.c_str(), range);
+                return range;
+            },
+            [name](diagnostics::BeamMonitor & bm, std::vector<amrex::ParticleReal> const & range) {
+                amrex::ParmParse pp_element(bm.series_name());
+                pp_element.addarr(name.c_str(), range);
+            },
+            ("Write only particles with " + comp + " in [lower, upper] (default: all).").c_str()
+        );
+    }
+
     register_beamoptics_push(py_BeamMonitor);
 
     // beam optics
@@ -631,6 +764,64 @@ void init_elements(py::module& m)
     ;
     register_beamoptics_push(py_ExactSbend);
 
+    py::class_<ExpressionMap, elements::Thick, elements::Alignment> py_ExpressionMap(me, "ExpressionMap");
+    py_ExpressionMap
+        .def("__repr__",
+             [](ExpressionMap const & expression_map) {
+                 auto const e = expression_map.expressions();
+                 std::string r = "<impactx.elements.ExpressionMap (ds=";
+                 r.append(std::to_string(expression_map.ds()))
+                  .append(", x=").append(e[0])
+                  .append(", y=").append(e[1])
+                  .append(", t=").append(e[2])
+                  .append(", px=").append(e[3])
+                  .append(", py=").append(e[4])
+                  .append(", pt=").append(e[5])
+                  .append(")>");
+                 return r;
+             }
+        )
+        .def(py::init([](
+                amrex::ParticleReal ds,
+                std::string const & x_expression,
+                std::string const & y_expression,
+                std::string const & t_expression,
+                std::string const & px_expression,
+                std::string const & py_expression,
+                std::string const & pt_expression,
+                std::map<std::string, amrex::ParticleReal> const & parameters,
+                amrex::ParticleReal dx,
+                amrex::ParticleReal dy,
+                amrex::ParticleReal rotation_degree,
+                int nslice
+             )
+             {
+                 return new ExpressionMap(ds, {x_expression, y_expression, t_expression,
+                                               px_expression, py_expression, pt_expression}, parameters,
+                                          dx, dy, rotation_degree, nslice);
+             }),
+             py::arg("ds"),
+             py::arg("x") = "x",
+             py::arg("y") = "y",
+             py::arg("t") = "t",
+             py::arg("px") = "px",
+             py::arg("py") = "py",
+             py::arg("pt") = "pt",
+             py::arg("parameters") = std::map<std::string, amrex::ParticleReal>{},
+             py::arg("dx") = 0,
+             py::arg("dy") = 0,
+             py::arg("rotation") = 0,
+             py::arg("nslice") = 1,
+             "A user-defined map per slice, given as math expressions of x, y, t, px, py, pt, s, ds, beta, gamma, beta_gamma and the named parameters. "
+             "The expressions are compiled once and evaluated on the compute device. The reference particle drifts."
+        )
+        .def_property_readonly("expressions",
+            [](ExpressionMap & expression_map) { return expression_map.expressions(); },
+            "expressions for x, y, t, px, py, pt"
+        )
+    ;
+    register_beamoptics_push(py_ExpressionMap);
+
     py::class_<Kicker, elements::Thin, elements::Alignment> py_Kicker(me, "Kicker");
     py_Kicker
         .def("__repr__",
@@ -782,6 +973,45 @@ void init_elements(py::module& m)
     ;
     register_beamoptics_push(py_NonlinearLens);
 
+    py::class_<Plugin, elements::Thick> py_Plugin(me, "Plugin");
+    py_Plugin
+        .def("__repr__",
+             [](Plugin const & plugin) {
+                 std::string r = "<impactx.elements.Plugin (library=";
+                 r.append(plugin.library())
+                  .append(", element=")
+                  .append(plugin.element())
+                  .append(", ds=")
+                  .append(std::to_string(plugin.ds()))
+                  .append(")>");
+                 return r;
+             }
+        )
+        .def(py::init<
+                std::string const &,
+                std::string const &,
+                amrex::ParticleReal,
+                std::map<std::string, double> const &,
+                int
+             >(),
+             py::arg("library"),
+             py::arg("element") = "",
+             py::arg("ds") = 0.0,
+             py::arg("parameters") = std::map<std::string, double>{},
+             py::arg("nslice") = 1,
+             "An element of a plugin: a shared library that is loaded at runtime and pushes the particles in C/C++."
+        )
+        .def_property_readonly("library",
+            [](Plugin & plugin) { return plugin.library(); },
+            "path of the shared library"
+        )
+        .def_property_readonly("element",
+            [](Plugin & plugin) { return plugin.element(); },
+            "name of the element type in the plugin"
+        )
+    ;
+    register_beamoptics_push(py_Plugin);
+
     py::class_<Programmable>(me, "Programmable", py::dynamic_attr())
         .def("__repr__",
              [](Programmable const & prg) {
@@ -897,7 +1127,8 @@ void init_elements(py::module& m)
                 amrex::ParticleReal,
                 amrex::ParticleReal,
                 int,
-                int
+                int,
+                amrex::ParticleReal
              >(),
              py::arg("ds"),
              py::arg("escale"),
@@ -910,6 +1141,7 @@ void init_elements(py::module& m)
              py::arg("rotation") = 0,
              py::arg("mapsteps") = 1,
              py::arg("nslice") = 1,
+             py::arg("map_tolerance") = 0,
              "An RF cavity."
         )
         .def_property("escale",
@@ -934,6 +1166,15 @@ void init_elements(py::module& m)
             [](RFCavity & rfc, int mapsteps) { rfc.m_mapsteps = mapsteps; },
             "number of integration steps per slice used for map and reference particle push in applied fields"
         )
+        .def_property("map_tolerance",
+            [](RFCavity & rfc) { return rfc.m_map_tolerance; },
+            [](RFCavity & rfc, amrex::ParticleReal map_tolerance) { rfc.m_map_tolerance = map_tolerance; },
+            "tolerance of the relative error per integration step for an adaptive step size of the map and reference particle push; 0 uses mapsteps fixed steps"
+        )
+        .def_property_readonly("mapsteps_used",
+            [](RFCavity & rfc) { return rfc.m_mapsteps_used; },
+            "number of integration steps used for the map and reference particle push in the last slice"
+        )
     ;
     register_beamoptics_push(py_RFCavity);
 
@@ -1127,7 +1368,8 @@ void init_elements(py::module& m)
                  amrex::ParticleReal,
                  amrex::ParticleReal,
                  int,
-                 int
+                 int,
+                 amrex::ParticleReal
              >(),
              py::arg("ds"),
              py::arg("bscale"),
@@ -1139,6 +1381,7 @@ void init_elements(py::module& m)
              py::arg("rotation") = 0,
              py::arg("mapsteps") = 1,
              py::arg("nslice") = 1,
+             py::arg("map_tolerance") = 0,
              "A soft-edge solenoid."
         )
         .def_property("bscale",
@@ -1158,6 +1401,15 @@ void init_elements(py::module& m)
             [](SoftSolenoid & soft_sol, int mapsteps) { soft_sol.m_mapsteps = mapsteps; },
             "number of integration steps per slice used for map and reference particle push in applied fields"
         )
+        .def_property("map_tolerance",
+            [](SoftSolenoid & soft_sol) { return soft_sol.m_map_tolerance; },
+            [](SoftSolenoid & soft_sol, amrex::ParticleReal map_tolerance) { soft_sol.m_map_tolerance = map_tolerance; },
+            "tolerance of the relative error per integration step for an adaptive step size of the map and reference particle push; 0 uses mapsteps fixed steps"
+        )
+        .def_property_readonly("mapsteps_used",
+            [](SoftSolenoid & soft_sol) { return soft_sol.m_mapsteps_used; },
+            "number of integration steps used for the map and reference particle push in the last slice"
+        )
     ;
     register_beamoptics_push(py_SoftSolenoid);
 
@@ -1251,7 +1503,8 @@ void init_elements(py::module& m)
                  amrex::ParticleReal,
                  amrex::ParticleReal,
                  int,
-                 int
+                 int,
+                 amrex::ParticleReal
              >(),
              py::arg("ds"),
              py::arg("gscale"),
@@ -1262,6 +1515,7 @@ void init_elements(py::module& m)
              py::arg("rotation") = 0,
              py::arg("mapsteps") = 1,
              py::arg("nslice") = 1,
+             py::arg("map_tolerance") = 0,
              "A soft-edge quadrupole."
         )
         .def_property("gscale",
@@ -1276,6 +1530,15 @@ void init_elements(py::module& m)
             [](SoftQuadrupole & soft_quad, int mapsteps) { soft_quad.m_mapsteps = mapsteps; },
             "number of integration steps per slice used for map and reference particle push in applied fields"
         )
+        .def_property("map_tolerance",
+            [](SoftQuadrupole & soft_quad) { return soft_quad.m_map_tolerance; },
+            [](SoftQuadrupole & soft_quad, amrex::ParticleReal map_tolerance) { soft_quad.m_map_tolerance = map_tolerance; },
+            "tolerance of the relative error per integration step for an adaptive step size of the map and reference particle push; 0 uses mapsteps fixed steps"
+        )
+        .def_property_readonly("mapsteps_used",
+            [](SoftQuadrupole & soft_quad) { return soft_quad.m_mapsteps_used; },
+            "number of integration steps used for the map and reference particle push in the last slice"
+        )
     ;
     register_beamoptics_push(py_SoftQuadrupole);
 
@@ -17,6 +17,7 @@ from __future__ import annotations
 import os as os
 
 from amrex import space3d as amr
+from impactx.diagnostics_reader import read_diagnostics
 from impactx.distribution_input_helpers import twiss
 from impactx.extensions.ImpactXParIter import register_ImpactXParIter_extension
 from impactx.extensions.ImpactXParticleContainer import (
@@ -58,6 +59,7 @@ __all__ = [
     "amr",
     "coordinate_transformation",
     "cxx",
+    "diagnostics_reader",
     "distribution",
     "distribution_input_helpers",
     "elements",
@@ -67,6 +69,7 @@ __all__ = [
     "os",
     "push",
     "read_beam",
+    "read_diagnostics",
     "read_lattice",
     "register_ImpactXParIter_extension",
     "register_ImpactXParticleContainer_extension",
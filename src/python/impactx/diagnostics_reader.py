@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import os
+
+import numpy as np
+
+_BINARY_MAGIC = b"impactx-diag-v1\n"
+_BINARY_TYPES = {"f8": np.float64, "i8": np.int64, "u8": np.uint64}
+
+
+def _read_binary(path):
+    """Read a columnar binary diagnostics file, see read_diagnostics."""
+    with open(path, "rb") as f:
+        data = f.read()
+
+    columns = None
+    chunks = []
+    pos = 0
+    while pos < len(data):
+        # (repeated) header: magic line and a line of name:type pairs
+        if data.startswith(_BINARY_MAGIC, pos):
+            pos += len(_BINARY_MAGIC)
+            end = data.index(b"\n", pos)
+            header = [c.rsplit(":", 1) for c in data[pos:end].decode().split()]
+            pos = end + 1
+            if columns is None:
+                columns = [(name, np.dtype(_BINARY_TYPES[t])) for name, t in header]
+            elif [name for name, _ in columns] != [name for name, _ in header]:
+                raise RuntimeError(f"{path}: the columns change within the file")
+            continue
+        if columns is None:
+            raise RuntimeError(f"{path}: not an ImpactX binary diagnostics file")
+
+        # block: number of rows, then each column as a contiguous array
+        nrows = int(np.frombuffer(data, dtype=np.int64, count=1, offset=pos)[0])
+        pos += 8
+        block = {}
+        for name, dtype in columns:
+            block[name] = np.frombuffer(data, dtype=dtype, count=nrows, offset=pos)
+            pos += nrows * dtype.itemsize
+        chunks.append(block)
+
+    if columns is None:
+        return {}
+    return {
+        name: np.concatenate([c[name] for c in chunks])
+        if chunks
+        else np.empty(0, dtype=dtype)
+        for name, dtype in columns
+    }
+
+
+def _read_text(path):
+    """Read a whitespace-separated text diagnostics file, see read_diagnostics."""
+    names = None
+    rows = []
+    with open(path, "r") as f:
+        for line in f:
+            values = line.split()
+            if not values:
+                continue
+            # header lines are repeated when a file is appended to
+            try:
+                rows.append([float(v) for v in values])
+            except ValueError:
+                if names is None:
+                    names = values
+                continue
+
+    if names is None:
+        raise RuntimeError(f"{path}: no header line found")
+    table = np.array(rows, dtype=np.float64).reshape(-1, len(names))
+    data = {}
+    for i, name in enumerate(names):
+        column = table[:, i]
+        if name in ("step", "member"):
+            column = column.astype(np.int64)
+        data[name] = column
+    return data
+
+
+def read_diagnostics(path, as_dataframe=True):
+    """
+    Read a reduced diagnostics file, e.g., ``diags/reduced_beam_characteristics.0``.
+
+    Both output formats of ``diag.format`` are supported.
+    If ``path`` does not exist, but ``path + ".bin"`` does, the binary file is read.
+
+    :param path: path to the text or binary (``.bin``) diagnostics file of one MPI rank
+    :param as_dataframe: return a pandas DataFrame (True) or a dict of numpy arrays (False)
+    :return: the columns of the file
+    """
+    if not os.path.exists(path) and os.path.exists(path + ".bin"):
+        path = path + ".bin"
+
+    with open(path, "rb") as f:
+        binary = f.read(len(_BINARY_MAGIC)) == _BINARY_MAGIC
+
+    data = _read_binary(path) if binary else _read_text(path)
+
+    if as_dataframe:
+        import pandas as pd
+
+        return pd.DataFrame(data)
+    return data
@@ -0,0 +1,26 @@
+from __future__ import annotations
+
+import os as os
+
+import numpy as np
+
+__all__ = ["np", "os", "read_diagnostics"]
+
+def _read_binary(path): ...
+def _read_text(path): ...
+def read_diagnostics(path, as_dataframe=True):
+    """
+
+    Read a reduced diagnostics file, e.g., ``diags/reduced_beam_characteristics.0``.
+
+    Both output formats of ``diag.format`` are supported.
+    If ``path`` does not exist, but ``path + ".bin"`` does, the binary file is read.
+
+    :param path: path to the text or binary (``.bin``) diagnostics file of one MPI rank
+    :param as_dataframe: return a pandas DataFrame (True) or a dict of numpy arrays (False)
+    :return: the columns of the file
+
+    """
+
+_BINARY_MAGIC: bytes
+_BINARY_TYPES: dict
@@ -287,7 +287,61 @@ def ix_pc_plot_mpl_phasespace(self, num_bins=50, root_rank=0):
     return fig
 
 
+def ix_pc_to_arrays(self, level=0, copy=False):
+    """
+    Access the local particle attributes as NumPy (CPU) or CuPy (GPU) arrays.
+
+    If all local particles are in a single tile, the returned arrays are
+    views on the particle data, without a copy. Otherwise, the attributes
+    of all tiles are concatenated into new arrays.
+
+    Parameters
+    ----------
+    self : ImpactXParticleContainer_*
+        The particle container class in ImpactX
+    level : int, default=0
+        The mesh-refinement level of the particles.
+    copy : bool, default=False
+        Always return a copy of the particle data, even for a single tile.
+
+    Returns
+    -------
+    A dictionary of 1D arrays, keyed by the SoA component names,
+    e.g., "position_x" or "momentum_t".
+    """
+    from inspect import getmodule
+
+    ix = getmodule(self)
+
+    tiles = []
+    for pti in ix.ImpactXParIter(self, level=level):
+        soa = pti.soa().to_xp()  # automatic: NumPy (CPU) or CuPy (GPU)
+        if len(soa.real["position_x"]) > 0:
+            tiles.append({**soa.real, **soa.int})
+
+    if ix.Config.have_gpu:
+        import cupy as xp
+    else:
+        import numpy as xp
+
+    if len(tiles) == 0:
+        real_dtype = xp.float32 if ix.Config.precision == "SINGLE" else xp.float64
+        arrays = {name: xp.empty(0, dtype=real_dtype) for name in self.RealSoA_names}
+        arrays.update({name: xp.empty(0, dtype=xp.int32) for name in self.intSoA_names})
+        return arrays
+
+    if len(tiles) == 1:
+        if copy:
+            return {name: xp.copy(arr) for name, arr in tiles[0].items()}
+        return tiles[0]
+
+    return {
+        name: xp.concatenate([tile[name] for tile in tiles]) for name in tiles[0]
+    }
+
+
 def register_ImpactXParticleContainer_extension(ixpc):
     """ImpactXParticleContainer helper methods"""
     # register member functions for ImpactXParticleContainer
     ixpc.plot_phasespace = ix_pc_plot_mpl_phasespace
+    ixpc.to_arrays = ix_pc_to_arrays
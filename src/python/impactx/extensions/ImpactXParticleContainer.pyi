@@ -9,7 +9,11 @@ License: BSD-3-Clause-LBNL
 
 from __future__ import annotations
 
-__all__ = ["ix_pc_plot_mpl_phasespace", "register_ImpactXParticleContainer_extension"]
+__all__ = [
+    "ix_pc_plot_mpl_phasespace",
+    "ix_pc_to_arrays",
+    "register_ImpactXParticleContainer_extension",
+]
 
 def ix_pc_plot_mpl_phasespace(self, num_bins=50, root_rank=0):
     """
@@ -32,6 +36,31 @@ def ix_pc_plot_mpl_phasespace(self, num_bins=50, root_rank=0):
 
     """
 
+def ix_pc_to_arrays(self, level=0, copy=False):
+    """
+
+    Access the local particle attributes as NumPy (CPU) or CuPy (GPU) arrays.
+
+    If all local particles are in a single tile, the returned arrays are
+    views on the particle data, without a copy. Otherwise, the attributes
+    of all tiles are concatenated into new arrays.
+
+    Parameters
+    ----------
+    self : ImpactXParticleContainer_*
+        The particle container class in ImpactX
+    level : int, default=0
+        The mesh-refinement level of the particles.
+    copy : bool, default=False
+        Always return a copy of the particle data, even for a single tile.
+
+    Returns
+    -------
+    A dictionary of 1D arrays, keyed by the SoA component names,
+    e.g., "position_x" or "momentum_t".
+
+    """
+
 def register_ImpactXParticleContainer_extension(ixpc):
     """
     ImpactXParticleContainer helper methods
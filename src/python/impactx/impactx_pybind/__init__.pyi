@@ -46,6 +46,7 @@ class Config:
     have_gpu: typing.ClassVar[bool] = False
     have_mpi: typing.ClassVar[bool] = True
     have_omp: typing.ClassVar[bool] = True
+    precision: typing.ClassVar[str] = "DOUBLE"
 
 class CoordSystem:
     """
@@ -103,6 +104,21 @@ class ImpactX:
         distribution's extent and then redistribute particles in according
         AMReX grid boxes.
         """
+    def add_particles_from_openpmd(
+        self,
+        filepath: str,
+        species: str = "beam",
+        iteration: int = -1,
+        bunch_charge: float = -1.0,
+    ) -> None:
+        """
+        Read particles from an openPMD series and add them to the particle container.
+
+        The series uses the schema of the BeamMonitor. The particles are converted
+        to the reference particle of the simulation. Each MPI rank reads its own slice.
+        A negative iteration reads the last iteration. A negative bunch charge (C)
+        keeps the weights of the file, otherwise they are rescaled to it.
+        """
     def boxArray(self, lev: int) -> amrex.space3d.amrex_3d_pybind.BoxArray: ...
     def deposit_charge(self) -> None:
         """
@@ -133,6 +149,17 @@ class ImpactX:
         """
         scalar potential per level
         """
+    def poisson_solve(self) -> int:
+        """
+        Solve the Poisson equation for phi from the deposited charge density rho.
+
+        The multigrid solver is warm-started from the previous phi.
+        Returns the number of MLMG iterations (0 for the FFT solver).
+        """
+    def reset_poisson_solver(self) -> None:
+        """
+        Forget the multigrid operator and the previous phi, so that the next solve starts cold.
+        """
     def resize_mesh(self) -> None:
         """
         Resize the mesh :py:attr:`~domain` based on the :py:attr:`~dynamic_size` and related parameters.
@@ -208,6 +235,77 @@ class ImpactX:
     @csr_bins.setter
     def csr_bins(self, arg1: int) -> None: ...
     @property
+    def da_max_amplitude(self) -> float:
+        """
+        Dynamic aperture scan: probes with larger |x| or |y| in m are lost (default: 1).
+        """
+    @da_max_amplitude.setter
+    def da_max_amplitude(self, arg1: float) -> None: ...
+    @property
+    def da_num_v(self) -> int:
+        """
+        Dynamic aperture scan: number of probes along the second coordinate.
+        """
+    @da_num_v.setter
+    def da_num_v(self, arg1: int) -> None: ...
+    @property
+    def da_num_x(self) -> int:
+        """
+        Dynamic aperture scan: number of probes along x.
+        """
+    @da_num_x.setter
+    def da_num_x(self, arg1: int) -> None: ...
+    @property
+    def da_plane(self) -> str:
+        """
+        Dynamic aperture scan: the plane of the grid of probes, xy (default) or xpx.
+        """
+    @da_plane.setter
+    def da_plane(self, arg1: str) -> None: ...
+    @property
+    def da_pt(self) -> float:
+        """
+        Dynamic aperture scan: energy deviation pt of all probes (default: 0).
+        """
+    @da_pt.setter
+    def da_pt(self, arg1: float) -> None: ...
+    @property
+    def da_v_max(self) -> float:
+        """
+        Dynamic aperture scan: largest second coordinate of the probes, y in m or px.
+        """
+    @da_v_max.setter
+    def da_v_max(self, arg1: float) -> None: ...
+    @property
+    def da_v_min(self) -> float:
+        """
+        Dynamic aperture scan: smallest second coordinate of the probes, y in m or px.
+        """
+    @da_v_min.setter
+    def da_v_min(self, arg1: float) -> None: ...
+    @property
+    def da_x_max(self) -> float:
+        """
+        Dynamic aperture scan: largest x of the probes in m.
+        """
+    @da_x_max.setter
+    def da_x_max(self, arg1: float) -> None: ...
+    @property
+    def da_x_min(self) -> float:
+        """
+        Dynamic aperture scan: smallest x of the probes in m.
+        """
+    @da_x_min.setter
+    def da_x_min(self, arg1: float) -> None: ...
+    @property
+    def diag_async_io(self) -> bool:
+        """
+        Write BeamMonitor output on a background thread (default: disabled),
+        while the simulation continues. Needs MPI_THREAD_MULTIPLE.
+        """
+    @diag_async_io.setter
+    def diag_async_io(self, arg1: bool) -> None: ...
+    @property
     def diag_file_min_digits(self) -> int:
         """
         The minimum number of digits (default: 6) used for the step
@@ -216,6 +314,20 @@ class ImpactX:
     @diag_file_min_digits.setter
     def diag_file_min_digits(self, arg1: int) -> None: ...
     @property
+    def diag_loss_map(self) -> bool:
+        """
+        Write a loss map of the lost particles per element, s-bin and period (default: disabled).
+        """
+    @diag_loss_map.setter
+    def diag_loss_map(self, arg1: bool) -> None: ...
+    @property
+    def diag_loss_map_ds(self) -> float:
+        """
+        Width of the bins in s of the loss map, in meters (default: 0.1).
+        """
+    @diag_loss_map_ds.setter
+    def diag_loss_map_ds(self, arg1: float) -> None: ...
+    @property
     def diagnostics(self) -> bool:
         """
         Enable or disable diagnostics generally (default: enabled).
@@ -271,6 +383,11 @@ class ImpactX:
     @mlmg_max_iters.setter
     def mlmg_max_iters(self, arg1: int) -> None: ...
     @property
+    def mlmg_num_iters(self) -> int:
+        """
+        Number of MLMG iterations of the last multigrid Poisson solve.
+        """
+    @property
     def mlmg_relative_tolerance(self) -> bool:
         """
         The relative precision with which the electrostatic space-charge fields should be calculated. More specifically, the space-charge fields are computed with an iterative Multi-Level Multi-Grid (MLMG) solver. This solver can fail to reach the default precision within a reasonable time.
@@ -342,6 +459,14 @@ class ImpactX:
     @slice_step_diagnostics.setter
     def slice_step_diagnostics(self, arg1: bool) -> None: ...
     @property
+    def small_beam(self) -> bool:
+        """
+        Track small beams on the host, with low overhead per slice step (default: disabled).
+        Not possible with space charge, CSR or slice step diagnostics.
+        """
+    @small_beam.setter
+    def small_beam(self, arg1: bool) -> None: ...
+    @property
     def space_charge(self) -> bool:
         """
         Enable or disable space charge calculations (default: enabled).
@@ -420,6 +545,7 @@ class ImpactXParticleContainer(
 ):
     const_iterator = ImpactXParConstIter
     iterator = ImpactXParIter
+    @typing.overload
     def add_n_particles(
         self,
         x: amrex.space3d.amrex_3d_pybind.PODVector_real_std,
@@ -447,6 +573,42 @@ class ImpactXParticleContainer(
         :param qm: charge over mass in 1/eV
         :param bchchg: total charge within a bunch in C
         """
+    @typing.overload
+    def add_n_particles(
+        self,
+        x: typing.Any,
+        y: typing.Any,
+        t: typing.Any,
+        px: typing.Any,
+        py: typing.Any,
+        pt: typing.Any,
+        qm: float,
+        bchchg: float,
+        rank_slice: bool = False,
+    ) -> None:
+        """
+        Add new particles to the container for fixed s, from NumPy, CuPy or other arrays.
+
+        The particle attributes are copied directly into the particle tile,
+        without intermediate buffers. Host arrays are accessed via the buffer
+        protocol, device arrays via ``__cuda_array_interface__``. The arrays
+        are not converted: they must be one-dimensional, contiguous and of the
+        floating point type of the particle data.
+
+        :param x: positions in x
+        :param y: positions in y
+        :param t: positions as time-of-flight in c*t
+        :param px: momentum in x
+        :param py: momentum in y
+        :param pt: momentum in t
+        :param qm: charge over mass in 1/eV
+        :param bchchg: total charge of the particles in the arrays in C
+        :param rank_slice: all MPI ranks pass the same arrays and each rank adds only its own slice
+        """
+    def covariance_matrix(self) -> list[list[float]]:
+        """
+        Compute the 6x6 covariance matrix of the particle distribution in the basis (x, px, y, py, t, pt).
+        """
     def mean_and_std_positions(self) -> tuple[float, float, float, float, float, float]:
         """
         Compute the mean and std of the particle position in each dimension.
@@ -489,6 +651,18 @@ class ImpactXParticleContainer(
         """
         Compute reduced beam characteristics like the position and momentum moments of the particle distribution, as well as emittance and Twiss parameters.
         """
+    def phase_space_histogram(
+        self,
+        components: list[str],
+        num_bins: int = 64,
+        ranges: list[typing.Annotated[list[float], pybind11_stubgen.typing_ext.FixedSize(2)]] = [],
+    ) -> tuple:
+        """
+        Compute a weighted histogram of 1 to 4 particle components, e.g., ["x", "px"], on the device.
+
+        The histogram is summed over all MPI ranks.
+        :return: the sum of the particle weights per bin (numpy array with one axis per component) and the [lower, upper] extent of each axis
+        """
     def ref_particle(self) -> RefPart:
         """
         Access the reference particle.
@@ -497,6 +671,12 @@ class ImpactXParticleContainer(
         """
         Set reference particle attributes.
         """
+    def sliced_beam_characteristics(
+        self, num_bins: int = 64
+    ) -> dict[str, list[float]]:
+        """
+        Compute beam characteristics of num_bins longitudinal slices of equal width along t, like the charge, current, rms sizes, energy spread and emittances per slice.
+        """
     @property
     def RealSoA_names(self) -> list[str]:
         """
@@ -682,9 +862,11 @@ def push(
     | elements.Drift
     | elements.ExactDrift
     | elements.ExactSbend
+    | elements.ExpressionMap
     | elements.Kicker
     | elements.Multipole
     | elements.NonlinearLens
+    | elements.Plugin
     | elements.Programmable
     | elements.PRot
     | elements.Quad
@@ -24,10 +24,12 @@ __all__ = [
     "Empty",
     "ExactDrift",
     "ExactSbend",
+    "ExpressionMap",
     "Kicker",
     "KnownElementsList",
     "Multipole",
     "NonlinearLens",
+    "Plugin",
     "PRot",
     "Programmable",
     "Quad",
@@ -114,7 +116,11 @@ class Aperture(Thin, Alignment):
 
 class BeamMonitor(Thin):
     def __init__(
-        self, name: str, backend: str = "default", encoding: str = "g"
+        self,
+        name: str,
+        backend: str = "default",
+        encoding: str = "g",
+        config: str = "",
     ) -> None:
         """
         This element writes the particle beam out to openPMD data.
@@ -149,6 +155,98 @@ class BeamMonitor(Thin):
     @cn.setter
     def cn(self, arg1: float) -> None: ...
     @property
+    def filter_every_nth_id(self) -> int:
+        """
+        Write only particles with an id that is a multiple of N (default: 1).
+        """
+    @filter_every_nth_id.setter
+    def filter_every_nth_id(self, arg1: int) -> None: ...
+    @property
+    def filter_fraction(self) -> float:
+        """
+        Write a random fraction of the particles, in (0, 1] (default: 1).
+        The selection depends only on the particle id and filter_seed: the same particles are written in every step.
+        """
+    @filter_fraction.setter
+    def filter_fraction(self, arg1: float) -> None: ...
+    @property
+    def filter_ids(self) -> list[int]:
+        """
+        Write only the particles with these ids, as in the id record of the openPMD output, e.g., tracer particles (default: all).
+        """
+    @filter_ids.setter
+    def filter_ids(self, arg1: list[int]) -> None: ...
+    @property
+    def filter_region_pt(self) -> list[float]:
+        """
+        Write only particles with pt in [lower, upper] (default: all).
+        """
+    @filter_region_pt.setter
+    def filter_region_pt(self, arg1: list[float]) -> None: ...
+    @property
+    def filter_region_px(self) -> list[float]:
+        """
+        Write only particles with px in [lower, upper] (default: all).
+        """
+    @filter_region_px.setter
+    def filter_region_px(self, arg1: list[float]) -> None: ...
+    @property
+    def filter_region_py(self) -> list[float]:
+        """
+        Write only particles with py in [lower, upper] (default: all).
+        """
+    @filter_region_py.setter
+    def filter_region_py(self, arg1: list[float]) -> None: ...
+    @property
+    def filter_region_t(self) -> list[float]:
+        """
+        Write only particles with t in [lower, upper] (default: all).
+        """
+    @filter_region_t.setter
+    def filter_region_t(self, arg1: list[float]) -> None: ...
+    @property
+    def filter_region_x(self) -> list[float]:
+        """
+        Write only particles with x in [lower, upper] (default: all).
+        """
+    @filter_region_x.setter
+    def filter_region_x(self, arg1: list[float]) -> None: ...
+    @property
+    def filter_region_y(self) -> list[float]:
+        """
+        Write only particles with y in [lower, upper] (default: all).
+        """
+    @filter_region_y.setter
+    def filter_region_y(self, arg1: list[float]) -> None: ...
+    @property
+    def filter_seed(self) -> int:
+        """
+        Random seed of filter_fraction (default: 0).
+        """
+    @filter_seed.setter
+    def filter_seed(self, arg1: int) -> None: ...
+    @property
+    def float32_records(self) -> list[str]:
+        """
+        Particle components to write in single precision, e.g., ["qm", "weighting"] (default: none).
+        """
+    @float32_records.setter
+    def float32_records(self, arg1: list[str]) -> None: ...
+    @property
+    def histogram_bins(self) -> int:
+        """
+        Number of bins per axis of the phase space histograms.
+        """
+    @histogram_bins.setter
+    def histogram_bins(self, arg1: int) -> None: ...
+    @property
+    def histograms(self) -> list[str]:
+        """
+        Phase space histograms to compute in situ, e.g., ["x:px", "x:y:px:py"], with 1 to 4 particle components separated by colons.
+        """
+    @histograms.setter
+    def histograms(self, arg1: list[str]) -> None: ...
+    @property
     def name(self) -> str:
         """
         name of the series
@@ -161,12 +259,33 @@ class BeamMonitor(Thin):
     @nonlinear_lens_invariants.setter
     def nonlinear_lens_invariants(self, arg1: bool) -> None: ...
     @property
+    def period_interval(self) -> int:
+        """
+        Write only every N-th time the beam passes this element, e.g., every N-th period of a ring (default: 1).
+        """
+    @period_interval.setter
+    def period_interval(self, arg1: int) -> None: ...
+    @property
     def tn(self) -> float:
         """
         Dimensionless strength of the IOTA nonlinear magnetic insert element used for computing H and I.
         """
     @tn.setter
     def tn(self, arg1: float) -> None: ...
+    @property
+    def write_particles(self) -> bool:
+        """
+        Write the beam particles (default: true). Disable to write only the phase space histograms.
+        """
+    @write_particles.setter
+    def write_particles(self, arg1: bool) -> None: ...
+    @property
+    def write_reduced_beam_characteristics(self) -> bool:
+        """
+        Without particles, write the reduced beam characteristics as attributes of each step (default: false).
+        """
+    @write_reduced_beam_characteristics.setter
+    def write_reduced_beam_characteristics(self, arg1: bool) -> None: ...
 
 class Buncher(Thin, Alignment):
     def __init__(
@@ -544,6 +663,38 @@ class ExactSbend(Thick, Alignment):
     @phi.setter
     def phi(self, arg1: float) -> None: ...
 
+class ExpressionMap(Thick, Alignment):
+    def __init__(
+        self,
+        ds: float,
+        x: str = "x",
+        y: str = "y",
+        t: str = "t",
+        px: str = "px",
+        py: str = "py",
+        pt: str = "pt",
+        parameters: dict[str, float] = {},
+        dx: float = 0,
+        dy: float = 0,
+        rotation: float = 0,
+        nslice: int = 1,
+    ) -> None:
+        """
+        A user-defined map per slice, given as math expressions of x, y, t, px, py, pt, s, ds, beta, gamma, beta_gamma and the named parameters. The expressions are compiled once and evaluated on the compute device. The reference particle drifts.
+        """
+    def __repr__(self) -> str: ...
+    def push(
+        self, pc: impactx.impactx_pybind.ImpactXParticleContainer, step: int = 0
+    ) -> None:
+        """
+        Push first the reference particle, then all other particles.
+        """
+    @property
+    def expressions(self) -> list[str]:
+        """
+        expressions for x, y, t, px, py, pt
+        """
+
 class Kicker(Thin, Alignment):
     def __init__(
         self,
@@ -599,9 +750,11 @@ class KnownElementsList:
         | Drift
         | ExactDrift
         | ExactSbend
+        | ExpressionMap
         | Kicker
         | Multipole
         | NonlinearLens
+        | Plugin
         | Programmable
         | PRot
         | Quad
@@ -633,9 +786,11 @@ class KnownElementsList:
         | Drift
         | ExactDrift
         | ExactSbend
+        | ExpressionMap
         | Kicker
         | Multipole
         | NonlinearLens
+        | Plugin
         | Programmable
         | PRot
         | Quad
@@ -668,9 +823,11 @@ class KnownElementsList:
         | Drift
         | ExactDrift
         | ExactSbend
+        | ExpressionMap
         | Kicker
         | Multipole
         | NonlinearLens
+        | Plugin
         | Programmable
         | PRot
         | Quad
@@ -809,6 +966,36 @@ class PRot(Thin):
     @phi_out.setter
     def phi_out(self, arg1: float) -> None: ...
 
+class Plugin(Thick):
+    def __init__(
+        self,
+        library: str,
+        element: str = "",
+        ds: float = 0.0,
+        parameters: dict[str, float] = {},
+        nslice: int = 1,
+    ) -> None:
+        """
+        An element of a plugin: a shared library that is loaded at runtime and pushes the particles in C/C++.
+        """
+    def __repr__(self) -> str: ...
+    def push(
+        self, pc: impactx.impactx_pybind.ImpactXParticleContainer, step: int = 0
+    ) -> None:
+        """
+        Push first the reference particle, then all other particles.
+        """
+    @property
+    def element(self) -> str:
+        """
+        name of the element type in the plugin
+        """
+    @property
+    def library(self) -> str:
+        """
+        path of the shared library
+        """
+
 class Programmable:
     ds: float
     nslice: int
@@ -907,6 +1094,7 @@ class RFCavity(Thick, Alignment):
         rotation: float = 0,
         mapsteps: int = 1,
         nslice: int = 1,
+        map_tolerance: float = 0,
     ) -> None:
         """
         An RF cavity.
@@ -933,6 +1121,13 @@ class RFCavity(Thick, Alignment):
     @freq.setter
     def freq(self, arg1: float) -> None: ...
     @property
+    def map_tolerance(self) -> float:
+        """
+        tolerance of the relative error per integration step for an adaptive step size of the map and reference particle push; 0 uses mapsteps fixed steps
+        """
+    @map_tolerance.setter
+    def map_tolerance(self, arg1: float) -> None: ...
+    @property
     def mapsteps(self) -> int:
         """
         number of integration steps per slice used for map and reference particle push in applied fields
@@ -940,6 +1135,11 @@ class RFCavity(Thick, Alignment):
     @mapsteps.setter
     def mapsteps(self, arg1: int) -> None: ...
     @property
+    def mapsteps_used(self) -> int:
+        """
+        number of integration steps used for the map and reference particle push in the last slice
+        """
+    @property
     def phase(self) -> float:
         """
         RF driven phase in degrees
@@ -1029,6 +1229,7 @@ class SoftQuadrupole(Thick, Alignment):
         rotation: float = 0,
         mapsteps: int = 1,
         nslice: int = 1,
+        map_tolerance: float = 0,
     ) -> None:
         """
         A soft-edge quadrupole.
@@ -1048,12 +1249,24 @@ class SoftQuadrupole(Thick, Alignment):
     @gscale.setter
     def gscale(self, arg1: float) -> None: ...
     @property
+    def map_tolerance(self) -> float:
+        """
+        tolerance of the relative error per integration step for an adaptive step size of the map and reference particle push; 0 uses mapsteps fixed steps
+        """
+    @map_tolerance.setter
+    def map_tolerance(self, arg1: float) -> None: ...
+    @property
     def mapsteps(self) -> int:
         """
         number of integration steps per slice used for map and reference particle push in applied fields
         """
     @mapsteps.setter
     def mapsteps(self, arg1: int) -> None: ...
+    @property
+    def mapsteps_used(self) -> int:
+        """
+        number of integration steps used for the map and reference particle push in the last slice
+        """
 
 class SoftSolenoid(Thick, Alignment):
     def __init__(
@@ -1068,6 +1281,7 @@ class SoftSolenoid(Thick, Alignment):
         rotation: float = 0,
         mapsteps: int = 1,
         nslice: int = 1,
+        map_tolerance: float = 0,
     ) -> None:
         """
         A soft-edge solenoid.
@@ -1087,6 +1301,13 @@ class SoftSolenoid(Thick, Alignment):
     @bscale.setter
     def bscale(self, arg1: float) -> None: ...
     @property
+    def map_tolerance(self) -> float:
+        """
+        tolerance of the relative error per integration step for an adaptive step size of the map and reference particle push; 0 uses mapsteps fixed steps
+        """
+    @map_tolerance.setter
+    def map_tolerance(self, arg1: float) -> None: ...
+    @property
     def mapsteps(self) -> int:
         """
         number of integration steps per slice used for map and reference particle push in applied fields
@@ -1094,6 +1315,11 @@ class SoftSolenoid(Thick, Alignment):
     @mapsteps.setter
     def mapsteps(self, arg1: int) -> None: ...
     @property
+    def mapsteps_used(self) -> int:
+        """
+        number of integration steps used for the map and reference particle push in the last slice
+        """
+    @property
     def unit(self) -> int:
         """
         specification of units for scaling of the on-axis longitudinal magnetic field
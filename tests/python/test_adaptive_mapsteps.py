@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+
+from impactx import Config, ImpactX, distribution, elements
+
+
+def push(mapsteps, map_tolerance=0.0):
+    """Push a beam through a soft-edge quadrupole, return the beam and the steps used"""
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.rng_seed = 7
+    sim.init_grids()
+
+    pc = sim.particle_container()
+    ref = pc.ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Waterbag(
+        lambdaX=4.0e-5,
+        lambdaY=4.0e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.7e-5,
+        lambdaPy=2.7e-5,
+        lambdaPt=2.0e-3,
+    )
+    sim.add_particles(1.0e-9, distr, 100)
+
+    # a field gradient with fringe fields at both ends
+    quad = elements.SoftQuadrupole(
+        ds=1.0,
+        gscale=1.0,
+        cos_coefficients=[1.0, 0.8, 0.3, 0.1],
+        sin_coefficients=[0.0, 0.0, 0.0, 0.0],
+        mapsteps=mapsteps,
+        map_tolerance=map_tolerance,
+    )
+    quad.push(pc)
+
+    data = pc.to_arrays(copy=True)
+    if Config.have_gpu:
+        import cupy as cp
+
+        data = {k: cp.asnumpy(v) for k, v in data.items()}
+    order = np.argsort(data["idcpu"])
+    beam = {k: v[order] for k, v in data.items()}
+    sim.finalize()
+
+    return beam, quad.mapsteps_used
+
+
+def test_adaptive_mapsteps():
+    """
+    The adaptive step size reaches the accuracy of many fixed steps
+    """
+    beam, steps = push(mapsteps=4000)
+    assert steps == 4000
+
+    adaptive_beam, adaptive_steps = push(mapsteps=1, map_tolerance=1.0e-8)
+    coarse_beam, coarse_steps = push(mapsteps=1, map_tolerance=1.0e-5)
+
+    # a tighter tolerance needs more steps
+    assert 1 < coarse_steps < adaptive_steps
+
+    for name in ["position_x", "position_y", "momentum_x", "momentum_y"]:
+        assert np.allclose(adaptive_beam[name], beam[name], rtol=1.0e-4, atol=1.0e-9)
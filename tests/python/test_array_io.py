@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+import pytest
+
+from impactx import Config, ImpactX
+
+
+def test_array_io():
+    """
+    Add particles from NumPy arrays and read them back as arrays
+    """
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.slice_step_diagnostics = False
+    sim.diagnostics = False
+    sim.init_grids()
+
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+    qm_eev = -1.0 / 0.510998950 / 1e6  # electron charge/mass in e / eV
+
+    # arrays must have the floating point type of the particle data
+    real_dtype = np.float32 if Config.precision == "SINGLE" else np.float64
+    npart = 1000
+    rng = np.random.default_rng(seed=42)
+    x, y, t, px, py, pt = rng.normal(0.0, 1.0e-3, (6, npart)).astype(real_dtype)
+
+    xp = np
+    if Config.have_gpu:
+        import cupy as xp
+
+    pc = sim.particle_container()
+    pc.add_n_particles(
+        xp.asarray(x),
+        xp.asarray(y),
+        xp.asarray(t),
+        xp.asarray(px),
+        xp.asarray(py),
+        xp.asarray(pt),
+        qm_eev,
+        1.0e-9,
+    )
+    assert pc.total_number_of_particles() == npart
+
+    # arrays are used in place and not converted: other types are rejected
+    with pytest.raises(RuntimeError):
+        pc.add_n_particles(
+            *[xp.asarray(v, dtype=xp.float16) for v in (x, y, t, px, py, pt)],
+            qm_eev,
+            1.0e-9,
+        )
+    assert pc.total_number_of_particles() == npart
+
+    arrays = pc.to_arrays()
+    if Config.have_gpu:
+        arrays = {name: xp.asnumpy(arr) for name, arr in arrays.items()}
+
+    # particles are not redistributed yet: same order as on input
+    assert np.array_equal(arrays["position_x"], x)
+    assert np.array_equal(arrays["momentum_t"], pt)
+    assert np.allclose(arrays["qm"], qm_eev)
+
+    # finalize simulation
+    sim.finalize()
+
+
+def test_array_io_rank_slice():
+    """
+    Add particles from the same arrays on all MPI ranks, each rank adds its own slice
+    """
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.slice_step_diagnostics = False
+    sim.diagnostics = False
+    sim.init_grids()
+
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+    qm_eev = -1.0 / 0.510998950 / 1e6  # electron charge/mass in e / eV
+
+    real_dtype = np.float32 if Config.precision == "SINGLE" else np.float64
+    npart = 1001
+    rng = np.random.default_rng(seed=42)
+    coords = rng.normal(0.0, 1.0e-3, (6, npart)).astype(real_dtype)
+
+    xp = np
+    if Config.have_gpu:
+        import cupy as xp
+
+    pc = sim.particle_container()
+    pc.add_n_particles(*[xp.asarray(c) for c in coords], qm_eev, 1.0e-9, rank_slice=True)
+
+    # the slices of all ranks are the whole beam, with its total charge
+    assert pc.total_number_of_particles() == npart
+    rbc = pc.reduced_beam_characteristics()
+    assert np.isclose(abs(rbc["charge_C"]), 1.0e-9, rtol=1.0e-5)
+
+    arrays = pc.to_arrays()
+    if Config.have_gpu:
+        arrays = {name: xp.asnumpy(arr) for name, arr in arrays.items()}
+    assert arrays["position_x"].dtype == real_dtype
+
+    # each local slice is a contiguous part of the input, in order
+    num_local = len(arrays["position_x"])
+    offsets = np.flatnonzero(coords[0] == arrays["position_x"][0]) if num_local else [0]
+    assert len(offsets) == 1
+    offset = offsets[0]
+    assert np.array_equal(arrays["position_x"], coords[0][offset : offset + num_local])
+    assert np.array_equal(arrays["momentum_t"], coords[5][offset : offset + num_local])
+
+    # finalize simulation
+    sim.finalize()
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+import pytest
+
+from impactx import ImpactX, distribution, elements
+
+
+def run(async_io, series_name):
+    """Track a beam through a ring with a beam monitor"""
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.diag_async_io = async_io
+    sim.init_grids()
+
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Waterbag(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+    )
+    sim.add_particles(1.0e-9, distr, 10000)
+
+    monitor = elements.BeamMonitor(series_name, backend="h5")
+    monitor.histograms = ["x:px"]
+    sim.periods = 5
+    sim.lattice.extend(
+        [
+            monitor,
+            elements.Drift(ds=0.25),
+            elements.Quad(ds=0.5, k=1.0),
+            elements.Drift(ds=0.25),
+        ]
+    )
+    sim.evolve()
+    sim.finalize()
+
+
+def test_async_io():
+    """
+    Asynchronous BeamMonitor output is identical to synchronous output
+    """
+    io = pytest.importorskip("openpmd_api")
+
+    run(False, "sync_io")
+    run(True, "async_io")
+
+    sync_series = io.Series("diags/openPMD/sync_io.h5", io.Access.read_only)
+    async_series = io.Series("diags/openPMD/async_io.h5", io.Access.read_only)
+    assert list(sync_series.iterations) == list(async_series.iterations)
+    assert len(sync_series.iterations) == 5
+
+    for step in sync_series.iterations:
+        sync_it = sync_series.iterations[step]
+        async_it = async_series.iterations[step]
+
+        sync_beam = sync_it.particles["beam"].to_df().sort_values("id")
+        async_beam = async_it.particles["beam"].to_df().sort_values("id")
+        assert len(sync_beam) == len(async_beam)
+        for name in sync_beam.columns:
+            assert np.array_equal(sync_beam[name].to_numpy(), async_beam[name].to_numpy())
+        assert sync_it.particles["beam"].get_attribute("s_ref") == async_it.particles[
+            "beam"
+        ].get_attribute("s_ref")
+
+        sync_hist = sync_it.meshes["phase_space_x_px"][io.Mesh_Record_Component.SCALAR]
+        async_hist = async_it.meshes["phase_space_x_px"][io.Mesh_Record_Component.SCALAR]
+        sync_data = sync_hist.load_chunk()
+        async_data = async_hist.load_chunk()
+        sync_series.flush()
+        async_series.flush()
+        assert np.array_equal(sync_data, async_data)
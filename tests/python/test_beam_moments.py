@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+
+from impactx import Config, ImpactX, distribution
+
+
+def test_beam_moments():
+    """
+    The single-pass moments agree with a two-pass reference
+    """
+    npart = 10000
+
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.init_grids()
+
+    pc = sim.particle_container()
+    ref = pc.ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Gaussian(
+        lambdaX=1.0e-3,
+        lambdaY=2.0e-3,
+        lambdaT=3.0e-3,
+        lambdaPx=1.0e-4,
+        lambdaPy=2.0e-4,
+        lambdaPt=3.0e-4,
+        muxpx=0.5,
+        muypy=-0.4,
+        mutpt=0.3,
+    )
+    sim.add_particles(1.0e-9, distr, npart)
+
+    data = pc.to_arrays(copy=True)
+    if Config.have_gpu:
+        import cupy as cp
+
+        data = {k: cp.asnumpy(v) for k, v in data.items()}
+    u = np.array(
+        [
+            data[name]
+            for name in [
+                "position_x",
+                "momentum_x",
+                "position_y",
+                "momentum_y",
+                "position_t",
+                "momentum_t",
+            ]
+        ]
+    )
+    w = data["weighting"]
+
+    cm = np.array(pc.covariance_matrix())
+    cm_ref = np.cov(u, aweights=w, bias=True)
+    assert np.allclose(cm, cm_ref, rtol=1.0e-9, atol=0.0)
+
+    rbc = pc.reduced_beam_characteristics()
+    assert np.isclose(rbc["x_mean"], np.average(u[0], weights=w), rtol=1.0e-9, atol=1.0e-18)
+    assert np.isclose(rbc["pt_max"], np.max(u[5]))
+
+    # uncoupled beam: the eigen-emittances are the projected emittances
+    eigen = sorted([rbc["emittance_1"], rbc["emittance_2"], rbc["emittance_3"]])
+    projected = sorted([rbc["emittance_x"], rbc["emittance_y"], rbc["emittance_t"]])
+    assert np.allclose(eigen, projected, rtol=0.05)
+
+    sim.finalize()
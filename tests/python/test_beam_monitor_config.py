@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+import pytest
+
+from impactx import ImpactX, distribution, elements
+
+
+def test_beam_monitor_config():
+    """
+    Beam monitor with a backend configuration and single precision records
+    """
+    io = pytest.importorskip("openpmd_api")
+
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.init_grids()
+
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Waterbag(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+    )
+    sim.add_particles(1.0e-9, distr, 1000)
+
+    full = elements.BeamMonitor("config_full", backend="h5")
+    reduced = elements.BeamMonitor(
+        "config_reduced",
+        backend="h5",
+        config='{"hdf5": {"dataset": {"chunks": "none"}}}',
+    )
+    reduced.float32_records = ["qm", "weighting", "momentum_t"]
+
+    sim.lattice.extend([full, reduced])
+    sim.evolve()
+    sim.finalize()
+
+    full_series = io.Series("diags/openPMD/config_full.h5", io.Access.read_only)
+    reduced_series = io.Series("diags/openPMD/config_reduced.h5", io.Access.read_only)
+    full_beam = full_series.iterations[1].particles["beam"]
+    reduced_beam = reduced_series.iterations[2].particles["beam"]
+    assert reduced_beam["weighting"][io.Record_Component.SCALAR].dtype == np.float32
+    assert reduced_beam["momentum"]["t"].dtype == np.float32
+    assert reduced_beam["momentum"]["x"].dtype == full_beam["momentum"]["x"].dtype
+
+    full_df = full_beam.to_df().sort_values("id")
+    reduced_df = reduced_beam.to_df().sort_values("id")
+    for name in ["momentum_t", "weighting", "qm"]:
+        assert np.allclose(reduced_df[name], full_df[name], rtol=1.0e-6, atol=0.0)
+    assert np.array_equal(reduced_df["position_x"], full_df["position_x"])
+
+
+def test_beam_monitor_config_file(tmp_path):
+    """
+    Beam monitor with a backend configuration from a file, the form used in inputs files
+    """
+    io = pytest.importorskip("openpmd_api")
+
+    config_file = tmp_path / "openpmd_config.toml"
+    config_file.write_text("[hdf5.dataset]\nchunks = 'none'\n")
+
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.init_grids()
+
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Waterbag(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+    )
+    sim.add_particles(1.0e-9, distr, 1000)
+
+    monitor = elements.BeamMonitor(
+        "config_file", backend="h5", config="@" + str(config_file)
+    )
+
+    sim.lattice.extend([monitor])
+    sim.evolve()
+    sim.finalize()
+
+    series = io.Series("diags/openPMD/config_file.h5", io.Access.read_only)
+    beam = series.iterations[1].particles["beam"]
+    assert len(beam.to_df()) == 1000
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+import pytest
+
+from impactx import ImpactX, distribution, elements
+
+
+def test_beam_monitor_filter():
+    """
+    Beam monitors that write a subset of the particles, every N-th period
+    """
+    io = pytest.importorskip("openpmd_api")
+
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.init_grids()
+
+    npart = 10000
+    bunch_charge_C = 1.0e-9
+
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Waterbag(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+    )
+    sim.add_particles(bunch_charge_C, distr, npart)
+
+    # every 3rd particle inside a band in x, every 2nd period
+    band = elements.BeamMonitor("filter_band", backend="h5")
+    band.filter_every_nth_id = 3
+    band.filter_region_x = [-1.0e-5, 1.0e-5]
+    band.period_interval = 2
+
+    # 10% tracer particles: the same particles in every period
+    tracers = elements.BeamMonitor("filter_tracers", backend="h5")
+    tracers.filter_fraction = 0.1
+    tracers.filter_seed = 42
+
+    sim.periods = 4
+    sim.lattice.extend([band, tracers, elements.Drift(ds=0.5)])
+    sim.evolve()
+    sim.finalize()
+
+    series = io.Series("diags/openPMD/filter_band.h5", io.Access.read_only)
+    steps = list(series.iterations)
+    assert len(steps) == 2  # periods 1 and 3 of 4
+    for step in steps:
+        beam = series.iterations[step].particles["beam"].to_df()
+        assert len(beam) > 0
+        assert np.all(np.abs(beam["position_x"]) <= 1.0e-5)
+        particle_number = (beam["id"].to_numpy(dtype=np.uint64) >> np.uint64(24)) & np.uint64(0x7FFFFFFFFF)
+        assert np.all(particle_number % np.uint64(3) == 0)
+    del series
+
+    series = io.Series("diags/openPMD/filter_tracers.h5", io.Access.read_only)
+    steps = list(series.iterations)
+    assert len(steps) == 4
+    ids = [
+        np.sort(series.iterations[step].particles["beam"].to_df()["id"].to_numpy())
+        for step in steps
+    ]
+    assert 0.08 * npart < len(ids[0]) < 0.12 * npart
+    for other in ids[1:]:
+        assert np.array_equal(ids[0], other)
+    del series
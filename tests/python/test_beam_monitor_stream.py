@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import json
+import subprocess
+import sys
+
+import pytest
+
+from impactx import ImpactX, distribution, elements
+
+# a local reader process: collects the steps of the stream until the simulation closes it
+READER = """
+import json
+import openpmd_api as io
+
+series = io.Series("diags/openPMD/stream.sst", io.Access.read_linear, '{"adios2": {"engine": {"parameters": {"OpenTimeoutSecs": "120"}}}}')
+steps = []
+for i in series.read_iterations():
+    beam = i.particles["beam"]
+    steps.append({
+        "step": i.iteration_index,
+        "np": beam["id"][io.Record_Component.SCALAR].shape[0],
+        "sig_x": beam.get_attribute("sig_x"),
+    })
+    i.close()
+print(json.dumps(steps))
+"""
+
+
+def test_beam_monitor_stream():
+    """
+    Stream beam monitor steps to a reader that runs at the same time
+    """
+    io = pytest.importorskip("openpmd_api")
+    if "sst" not in io.file_extensions:
+        pytest.skip("openPMD-api without ADIOS2 SST")
+
+    npart = 1000
+
+    reader = subprocess.Popen(
+        [sys.executable, "-c", READER], stdout=subprocess.PIPE, text=True
+    )
+
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.init_grids()
+
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Waterbag(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+    )
+    sim.add_particles(1.0e-9, distr, npart)
+
+    # wait for the reader and deliver every step: deterministic for testing
+    monitor = elements.BeamMonitor(
+        "stream",
+        backend="sst",
+        config='{"adios2": {"engine": {"parameters": {"RendezvousReaderCount": "1", "QueueFullPolicy": "Block"}}}}',
+    )
+    sim.lattice.extend([monitor, elements.Drift(ds=1.0), monitor])
+    sim.evolve()
+    sim.finalize()
+
+    out, _ = reader.communicate(timeout=300)
+    assert reader.returncode == 0
+    steps = json.loads(out)
+
+    assert [s["step"] for s in steps] == [1, 2]
+    assert all(s["np"] == npart for s in steps)
+    assert steps[1]["sig_x"] > steps[0]["sig_x"]  # the beam diverges in the drift
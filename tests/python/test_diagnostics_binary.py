@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import os
+
+import amrex.space3d as amr
+import numpy as np
+
+from impactx import ImpactX, distribution, elements, read_diagnostics
+
+
+def run(diag_format):
+    """Track a beam with slice step diagnostics in the given diagnostics format"""
+    pp_diag = amr.ParmParse("diag")
+    pp_diag.add("format", diag_format)
+    pp_diag.add("flush_every", 2)
+
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = True
+    sim.init_grids()
+
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Waterbag(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+    )
+    sim.add_particles(1.0e-9, distr, 1000)
+
+    sim.lattice.extend(
+        [
+            elements.Drift(ds=0.25, nslice=3),
+            elements.Quad(ds=1.0, k=1.0, nslice=5),
+            elements.Drift(ds=0.25, nslice=3),
+        ]
+    )
+    sim.evolve()
+    sim.finalize()
+
+
+def test_diagnostics_binary():
+    """
+    The binary diagnostics contain the same data as the text diagnostics
+    """
+    # binary files are appended to, like text files: start fresh
+    for name in ["reduced_beam_characteristics", "ref_particle"]:
+        if os.path.exists(f"diags/{name}.0.bin"):
+            os.remove(f"diags/{name}.0.bin")
+
+    run("binary")
+    binary = read_diagnostics("diags/reduced_beam_characteristics.0.bin")
+    binary_ref = read_diagnostics("diags/ref_particle.0.bin", as_dataframe=False)
+
+    run("text")
+    text = read_diagnostics("diags/reduced_beam_characteristics.0")
+
+    # the text file is appended to by other tests: compare the last run
+    text = text.tail(len(binary)).reset_index(drop=True)
+
+    # initial output and one row per slice step, over several flushes
+    assert len(binary) > 2
+    assert binary["step"].dtype == np.int64
+    assert list(binary.columns) == list(text.columns)
+    assert np.array_equal(binary["step"], text["step"])
+    for name in binary.columns:
+        assert np.allclose(binary[name], text[name], rtol=1.0e-14, atol=0.0, equal_nan=True)
+
+    assert np.isclose(binary_ref["s"][-1], 1.5)
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+import pytest
+
+from impactx import ImpactX, elements
+
+
+def scan(plane, x, v, periods):
+    """Scan the dynamic aperture of a drift and an aperture, return the survival map"""
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.track = "dynamic_aperture"
+    sim.da_plane = plane
+    sim.da_x_min, sim.da_x_max, sim.da_num_x = x
+    sim.da_v_min, sim.da_v_max, sim.da_num_v = v
+    sim.init_grids()
+
+    pc = sim.particle_container()
+    ref = pc.ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    sim.periods = periods
+    sim.lattice.extend(
+        [
+            elements.Drift(ds=1.0, nslice=2),
+            elements.BeamMonitor("monitor", backend="h5"),
+            elements.Aperture(xmax=2.5e-3, ymax=2.5e-3),
+        ]
+    )
+    sim.evolve()
+
+    num_survived = pc.total_number_of_particles()
+    s_ref = ref.s
+    sim.finalize()
+
+    survival_map = np.genfromtxt("diags/dynamic_aperture", names=True)
+    return survival_map, num_survived, s_ref
+
+
+def test_dynamic_aperture_xy():
+    """
+    Probes outside of the aperture get lost in the first turn
+    """
+    survival_map, num_survived, s_ref = scan(
+        "xy", x=(0.0, 4.0e-3, 5), v=(0.0, 4.0e-3, 5), periods=10
+    )
+
+    assert len(survival_map) == 25
+    inside = (survival_map["x"] < 2.5e-3) & (survival_map["y"] < 2.5e-3)
+    assert np.array_equal(survival_map["survived"] == 1, inside)
+    assert num_survived == np.count_nonzero(inside)
+
+    assert np.all(survival_map["turns"][inside] == 10)
+    assert np.all(survival_map["turns"][~inside] == 0)
+    assert np.allclose(survival_map["s_lost"][~inside], 1.0)
+    assert np.all(np.isnan(survival_map["s_lost"][inside]))
+    assert np.isclose(s_ref, 10.0)
+
+
+def test_dynamic_aperture_xpx():
+    """
+    Probes with a momentum drift out of the aperture after a number of turns
+    """
+    survival_map, num_survived, s_ref = scan(
+        "xpx", x=(0.0, 0.0, 1), v=(0.0, 1.0e-3, 3), periods=4
+    )
+
+    assert np.allclose(survival_map["px"], [0.0, 5.0e-4, 1.0e-3])
+    assert list(survival_map["survived"]) == [1, 1, 0]
+    assert list(survival_map["turns"]) == [4, 4, 2]
+    assert np.isclose(survival_map["s_lost"][2], 3.0)
+    assert num_survived == 2
+
+
+def test_dynamic_aperture_early_termination():
+    """
+    The scan stops after the turn in which all probes got lost
+    """
+    survival_map, num_survived, s_ref = scan(
+        "xy", x=(3.0e-3, 4.0e-3, 3), v=(0.0, 1.0e-3, 2), periods=100
+    )
+
+    assert np.all(survival_map["survived"] == 0)
+    assert np.all(survival_map["turns"] == 0)
+    assert num_survived == 0
+    assert np.isclose(s_ref, 1.0)
+
+
+def test_dynamic_aperture_monitor():
+    """
+    Beam monitors write the probes that survived until they reach the monitor
+    """
+    io = pytest.importorskip("openpmd_api")
+
+    survival_map, num_survived, s_ref = scan(
+        "xy", x=(0.0, 4.0e-3, 5), v=(0.0, 4.0e-3, 5), periods=3
+    )
+
+    series = io.Series("diags/openPMD/monitor.h5", io.Access.read_only)
+    steps = sorted(series.iterations)
+    assert len(steps) == 3
+    num_written = [
+        len(series.iterations[step].particles["beam"].to_df()) for step in steps
+    ]
+    assert num_written == [25, num_survived, num_survived]
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+
+from impactx import ImpactX, RefPart, distribution, elements
+
+
+def test_ensemble_fodo():
+    """
+    Track two lattice variants of a FODO cell in one simulation:
+    the nominal cell and the same cell with switched-off quadrupoles.
+    """
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.slice_step_diagnostics = True
+    sim.init_grids()
+
+    # init particle beam
+    kin_energy_MeV = 2.0e3
+    bunch_charge_C = 1.0e-9
+    npart = 10000
+
+    distr = distribution.Waterbag(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+        muxpx=-0.846574929020762,
+        muypy=0.846574929020762,
+        mutpt=0.0,
+    )
+
+    # one ensemble member per quadrupole strength
+    for k in [1.0, 0.0]:
+        ref = RefPart()
+        ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(
+            kin_energy_MeV
+        )
+
+        lattice = elements.KnownElementsList()
+        lattice.extend(
+            [
+                elements.Drift(0.25),
+                elements.Quad(1.0, k),
+                elements.Drift(0.5),
+                elements.Quad(1.0, -k),
+                elements.Drift(0.25),
+            ]
+        )
+
+        sim.add_ensemble_member(ref, lattice, bunch_charge_C, distr, npart)
+
+    assert sim.ensemble_size == 2
+    assert sim.particle_container().total_number_of_particles() == 2 * npart
+
+    sim.evolve()
+
+    # the reference particles of both members moved through the cell
+    for m in range(sim.ensemble_size):
+        assert np.isclose(sim.ensemble_ref_particle(m).s, 3.0)
+
+    # in situ calculate the reduced beam characteristics of both members
+    rbc = sim.ensemble_reduced_beam_characteristics()
+    assert len(rbc) == 2
+
+    rtol = 2.2 * npart**-0.5  # from random sampling of a smooth distribution
+    for m in range(2):
+        assert np.isclose(rbc[m]["charge_C"], -bunch_charge_C, rtol=1.0e-12)
+        assert np.isclose(rbc[m]["emittance_x"], 2.0e-9, rtol=rtol)
+        assert np.isclose(rbc[m]["emittance_y"], 2.0e-9, rtol=rtol)
+
+    # nominal cell: matched beam, drift: the diverging beam grows
+    assert np.isclose(rbc[0]["sig_x"], 7.5451170454175073e-005, rtol=rtol)
+    assert np.isclose(rbc[1]["sig_x"], 2.17e-4, rtol=0.05)
+
+    # finalize simulation
+    sim.finalize()
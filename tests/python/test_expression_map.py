@@ -0,0 +1,103 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+import pytest
+
+from impactx import Config, ImpactX, distribution, elements
+
+
+def push(lattice):
+    """Push a beam through a list of elements, return the beam and the reference s"""
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.rng_seed = 11
+    sim.init_grids()
+
+    pc = sim.particle_container()
+    ref = pc.ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Waterbag(
+        lambdaX=4.0e-5,
+        lambdaY=4.0e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.7e-5,
+        lambdaPy=2.7e-5,
+        lambdaPt=2.0e-3,
+    )
+    sim.add_particles(1.0e-9, distr, 100)
+
+    for element in lattice:
+        element.push(pc)
+
+    data = pc.to_arrays(copy=True)
+    if Config.have_gpu:
+        import cupy as cp
+
+        data = {k: cp.asnumpy(v) for k, v in data.items()}
+    order = np.argsort(data["idcpu"])
+    beam = {k: v[order] for k, v in data.items()}
+    s = ref.s
+    sim.finalize()
+
+    return beam, s
+
+
+def test_expression_map_drift():
+    """
+    An expression map of a linear drift agrees with the native drift
+    """
+    beam, s = push([elements.Drift(ds=0.5, nslice=4, dx=1.0e-5)])
+
+    drift = elements.ExpressionMap(
+        ds=0.5,
+        x="x + ds * px",
+        y="y + ds * py",
+        t="t + ds / beta_gamma^2 * pt",
+        nslice=4,
+        dx=1.0e-5,
+    )
+    assert drift.expressions[3] == "px"
+    expression_beam, expression_s = push([drift])
+
+    assert np.isclose(expression_s, s)
+    for name in ["position_x", "position_y", "position_t", "momentum_t"]:
+        assert np.allclose(
+            expression_beam[name], beam[name], rtol=1.0e-12, atol=1.0e-15
+        )
+
+
+def test_expression_map_kick():
+    """
+    A thin kick with a named parameter focuses the beam, like a thin multipole
+    """
+    k = 0.3
+    beam, _ = push([elements.Multipole(multipole=2, K_normal=k, K_skew=0.0)])
+
+    kick = elements.ExpressionMap(
+        ds=0.0, px="px - k * x", py="py + k * y", parameters={"k": k}
+    )
+    expression_beam, _ = push([kick])
+
+    for name in ["position_x", "momentum_x", "momentum_y"]:
+        assert np.allclose(
+            expression_beam[name], beam[name], rtol=1.0e-12, atol=1.0e-15
+        )
+
+
+def test_expression_map_unknown_symbol():
+    """
+    Unknown symbols in an expression are rejected
+    """
+    with pytest.raises(RuntimeError):
+        elements.ExpressionMap(ds=1.0, px="px - kq * x")
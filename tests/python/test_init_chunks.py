@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+
+from impactx import Config, ImpactX, distribution
+
+
+def test_init_chunks():
+    """
+    Sample the initial beam in chunks, directly into the particle tile
+    """
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.init_chunk_size = 333
+    sim.init_grids()
+
+    # init particle beam
+    kin_energy_MeV = 2.0e3
+    bunch_charge_C = 1.0e-9
+    npart = 10000
+
+    #   reference particle
+    pc = sim.particle_container()
+    ref = pc.ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(kin_energy_MeV)
+
+    #   particle bunch
+    distr = distribution.Waterbag(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+        muxpx=-0.846574929020762,
+        muypy=0.846574929020762,
+        mutpt=0.0,
+    )
+    sim.add_particles(bunch_charge_C, distr, npart)
+
+    assert pc.total_number_of_particles() == npart
+
+    # every chunk is sampled and has charge and weighting set
+    arrays = pc.to_arrays()
+    if Config.have_gpu:
+        import cupy as cp
+
+        arrays = {name: cp.asnumpy(arr) for name, arr in arrays.items()}
+
+    assert np.all(arrays["position_x"] != 0.0)
+    assert np.allclose(arrays["qm"], ref.qm_ratio_SI)
+    assert np.allclose(arrays["weighting"], bunch_charge_C / 1.602176634e-19 / npart)
+
+    rbc = pc.reduced_beam_characteristics()
+    assert np.isclose(rbc["charge_C"], -bunch_charge_C)
+
+    # finalize simulation
+    sim.finalize()
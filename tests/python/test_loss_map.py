@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+
+from impactx import ImpactX, distribution, elements
+
+
+def test_loss_map():
+    """
+    Loss map of a beam scraped by two apertures
+    """
+    npart = 10000
+    bunch_charge = 1.0e-9
+
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.diag_loss_map = True
+    sim.diag_loss_map_ds = 0.5
+    sim.init_grids()
+
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Waterbag(
+        lambdaX=1.0e-3,
+        lambdaY=1.0e-3,
+        lambdaT=1.0e-3,
+        lambdaPx=1.0e-4,
+        lambdaPy=1.0e-4,
+        lambdaPt=1.0e-3,
+    )
+    sim.add_particles(bunch_charge, distr, npart)
+
+    # the beam diverges: the second aperture scrapes in every period
+    sim.periods = 2
+    sim.lattice.extend(
+        [
+            elements.Drift(ds=1.0),
+            elements.Aperture(xmax=1.0e-3, ymax=1.0e-3),
+            elements.Drift(ds=1.0, nslice=2),
+            elements.Aperture(xmax=1.0e-3, ymax=1.0e-3),
+        ]
+    )
+    sim.evolve()
+    num_lost = npart - sim.particle_container().total_number_of_particles()
+    sim.finalize()
+
+    per_element = np.genfromtxt(
+        "diags/loss_map_elements", names=True, dtype=None, encoding="utf-8"
+    )
+    per_s = np.genfromtxt("diags/loss_map_s", names=True)
+    per_period = np.genfromtxt("diags/loss_map_periods", names=True)
+
+    # losses only in the apertures
+    assert list(per_element["element_type"]) == ["Drift", "Aperture", "Drift", "Aperture"]
+    assert per_element["lost_particles"][0] == 0
+    assert per_element["lost_particles"][2] == 0
+    assert per_element["lost_particles"][1] > 0
+    assert per_element["lost_particles"][3] > 0
+
+    # all tables count the same particles
+    for table in [per_element, per_s, per_period]:
+        assert table["lost_particles"].sum() == num_lost
+        assert np.isclose(
+            table["lost_charge_C"].sum(), -bunch_charge * num_lost / npart
+        )
+
+    # apertures at s = 1, 2, 3, 4 m: losses in the bins starting there
+    assert len(per_period) == 2
+    assert np.all(per_period["lost_particles"] > 0)
+    lossy_bins = per_s["s_begin"][per_s["lost_particles"] > 0]
+    assert set(lossy_bins) <= {1.0, 2.0, 3.0, 4.0}
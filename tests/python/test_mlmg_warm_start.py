@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+
+from impactx import ImpactX, distribution, elements
+
+
+def phi_to_numpy(sim):
+    """Copy the potential of all local boxes to one flat host array"""
+    phi = sim.phi(lev=0)
+    return np.concatenate([phi.array(mfi).to_numpy(copy=True).ravel() for mfi in phi])
+
+
+def test_mlmg_warm_start():
+    """
+    Two consecutive space charge steps with the multigrid Poisson solver:
+    the second solve is warm-started from the first and must need fewer
+    MLMG iterations, while it agrees with a cold solve of the same charge
+    density.
+    """
+    sim = ImpactX()
+
+    sim.n_cell = [16, 16, 20]
+    sim.particle_shape = 2
+    sim.space_charge = True
+    sim.poisson_solver = "multigrid"
+    sim.mlmg_relative_tolerance = 1.0e-8
+    sim.dynamic_size = True
+    sim.prob_relative = [1.2]
+    sim.diagnostics = False
+    sim.slice_step_diagnostics = False
+    sim.init_grids()
+
+    # init particle beam
+    kin_energy_MeV = 250.0
+    bunch_charge_C = 1.0e-9
+    npart = 10000
+
+    #   reference particle
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(kin_energy_MeV)
+
+    #   particle bunch
+    distr = distribution.Kurth6D(
+        lambdaX=4.472135955e-4,
+        lambdaY=4.472135955e-4,
+        lambdaT=9.12241869e-7,
+        lambdaPx=0.0,
+        lambdaPy=0.0,
+        lambdaPt=0.0,
+    )
+    sim.add_particles(bunch_charge_C, distr, npart)
+
+    # one space charge step per evolve
+    sim.lattice.append(elements.Drift(ds=0.01, nslice=1))
+
+    # step 1: cold start
+    sim.evolve()
+    iters_first = sim.mlmg_num_iters
+
+    # step 2: warm-started from the phi of step 1
+    sim.evolve()
+    iters_warm = sim.mlmg_num_iters
+    phi_warm = phi_to_numpy(sim)
+
+    print(f"MLMG iterations: first={iters_first} warm={iters_warm}")
+    assert iters_first > 0
+    assert iters_warm < iters_first
+
+    # cold solve of the same charge density, deposited in step 2
+    sim.reset_poisson_solver()
+    iters_cold = sim.poisson_solve()
+    phi_cold = phi_to_numpy(sim)
+
+    print(f"MLMG iterations: cold={iters_cold}")
+    assert iters_cold == sim.mlmg_num_iters
+    assert iters_warm < iters_cold
+
+    # both solutions are converged to the relative tolerance of the solver
+    atol = 1.0e-6 * np.max(np.abs(phi_cold))
+    assert np.allclose(phi_warm, phi_cold, rtol=0.0, atol=atol)
+
+    # finalize simulation
+    sim.finalize()
+
+
+# implement a direct script run mode
+if __name__ == "__main__":
+    test_mlmg_warm_start()
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+
+from impactx import Config, ImpactX, distribution, elements
+
+
+def particles(pc):
+    """Return the local particle data, sorted by x"""
+    data = pc.to_arrays(copy=True)
+    if Config.have_gpu:
+        import cupy as cp
+
+        data = {k: cp.asnumpy(v) for k, v in data.items()}
+    order = np.argsort(data["position_x"])
+    return {k: v[order] for k, v in data.items()}
+
+
+def make_sim(kin_energy_MeV):
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.init_grids()
+
+    ref = sim.particle_container().ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(kin_energy_MeV)
+
+    return sim
+
+
+def test_openpmd_reader():
+    """
+    Read a beam back from a BeamMonitor series
+    """
+    npart = 1000
+    bunch_charge = 1.0e-9
+
+    # write a beam with a beam monitor
+    sim = make_sim(2.0e3)
+    distr = distribution.Waterbag(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+    )
+    sim.add_particles(bunch_charge, distr, npart)
+    sim.lattice.extend([elements.BeamMonitor("openpmd_reader", backend="h5")])
+    sim.evolve()
+    written = particles(sim.particle_container())
+    sim.finalize()
+
+    # same reference particle: the beam is unchanged
+    sim = make_sim(2.0e3)
+    sim.add_particles_from_openpmd("diags/openPMD/openpmd_reader.h5")
+    pc = sim.particle_container()
+    assert pc.total_number_of_particles() == npart
+    read = particles(pc)
+    for name in ["position_x", "position_y", "position_t", "momentum_x", "momentum_y", "momentum_t", "weighting"]:
+        assert np.allclose(read[name], written[name], rtol=1.0e-12, atol=0.0)
+    sim.finalize()
+
+    # another reference energy: momenta are renormalized, the weights rescaled
+    sim = make_sim(1.0e3)
+    sim.add_particles_from_openpmd("diags/openPMD/openpmd_reader.h5", bunch_charge=2.0 * bunch_charge)
+    read = particles(sim.particle_container())
+    assert np.allclose(read["position_x"], written["position_x"], rtol=1.0e-12, atol=0.0)
+    assert np.all(read["momentum_x"] / written["momentum_x"] > 1.9)
+    assert np.all(read["momentum_t"] < 0.0)  # more energy than the new reference particle
+    assert np.allclose(read["weighting"], 2.0 * written["weighting"])
+    sim.finalize()
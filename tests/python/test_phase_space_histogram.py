@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+
+from impactx import Config, ImpactX, distribution, elements
+
+
+def test_phase_space_histogram():
+    """
+    In situ phase space histograms match numpy histograms of the particles
+    """
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.init_grids()
+
+    npart = 10000
+    bunch_charge_C = 1.0e-9
+
+    pc = sim.particle_container()
+    ref = pc.ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Gaussian(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+    )
+    sim.add_particles(bunch_charge_C, distr, npart)
+
+    data = pc.to_arrays(copy=True)
+    if Config.have_gpu:
+        import cupy as cp
+
+        data = {k: cp.asnumpy(v) for k, v in data.items()}
+    x = data["position_x"]
+    px = data["momentum_x"]
+    w = data["weighting"]
+
+    # 2D, fixed ranges: same bins as numpy
+    ranges = [[-1.0e-4, 1.0e-4], [-5.0e-5, 5.0e-5]]
+    hist, extent = pc.phase_space_histogram(["x", "px"], num_bins=16, ranges=ranges)
+    ref_hist, _ = np.histogramdd((x, px), bins=16, range=ranges, weights=w)
+    assert hist.shape == (16, 16)
+    assert np.allclose(extent, ranges)
+    assert np.allclose(hist, ref_hist, rtol=1.0e-12)
+
+    # 1D, extent of the beam: all particles are counted
+    hist, extent = pc.phase_space_histogram(["pt"], num_bins=32)
+    assert hist.shape == (32,)
+    assert np.isclose(np.sum(hist), np.sum(w), rtol=1.0e-12)
+    assert extent[0][0] == np.min(data["momentum_t"])
+
+    # 4D
+    hist, _ = pc.phase_space_histogram(["x", "y", "px", "py"], num_bins=4)
+    assert hist.shape == (4, 4, 4, 4)
+    assert np.isclose(np.sum(hist), np.sum(w), rtol=1.0e-12)
+
+    # beam monitor: histograms only, no particle data
+    monitor = elements.BeamMonitor("histograms", backend="h5")
+    monitor.histograms = ["x:px", "t:pt"]
+    monitor.histogram_bins = 32
+    monitor.write_particles = False
+    sim.lattice.extend([monitor, elements.Drift(ds=1.0), monitor])
+    sim.evolve()
+
+    sim.finalize()
@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+
+from impactx import Config, ImpactX, distribution
+
+
+def generate(npart, seed, chunk_size, sampling="random"):
+    """Generate a Gaussian beam and return its local x positions"""
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.rng_seed = seed
+    sim.init_chunk_size = chunk_size
+    sim.init_sampling = sampling
+    sim.init_grids()
+
+    pc = sim.particle_container()
+    ref = pc.ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Gaussian(
+        lambdaX=1.0e-3,
+        lambdaY=1.0e-3,
+        lambdaT=1.0e-3,
+        lambdaPx=1.0e-4,
+        lambdaPy=1.0e-4,
+        lambdaPt=1.0e-4,
+    )
+    sim.add_particles(1.0e-9, distr, npart)
+
+    x = pc.to_arrays(copy=True)["position_x"]
+    if Config.have_gpu:
+        import cupy as cp
+
+        x = cp.asnumpy(x)
+
+    sim.finalize()
+    return x
+
+
+def test_rng():
+    """
+    The initial beam only depends on the seed and the particle index
+    """
+    npart = 1000
+
+    x_ref = generate(npart, seed=7, chunk_size=0)
+    assert np.all(np.isfinite(x_ref))
+    assert np.isclose(np.std(x_ref), 1.0e-3, rtol=0.1)
+
+    # kernel layout does not change the beam
+    x_chunked = generate(npart, seed=7, chunk_size=97)
+    assert np.array_equal(x_ref, x_chunked)
+
+    # a different seed does
+    x_other = generate(npart, seed=8, chunk_size=0)
+    assert not np.array_equal(x_ref, x_other)
+
+
+def test_halton():
+    """
+    Quasi-random sampling converges faster than pseudo-random sampling
+    """
+    npart = 1000
+
+    x = generate(npart, seed=7, chunk_size=0, sampling="halton")
+    assert np.all(np.isfinite(x))
+    assert np.isclose(np.std(x), 1.0e-3, rtol=1.0e-2)
+    assert abs(np.mean(x)) < 1.0e-5
+
+    # errors of the mean and rms size, over several randomizations of both sequences
+    def errors(sampling):
+        err = []
+        for seed in range(1, 5):
+            x = generate(npart, seed=seed, chunk_size=0, sampling=sampling)
+            err.append([np.mean(x) / 1.0e-3, np.std(x) / 1.0e-3 - 1.0])
+        return np.sqrt(np.mean(np.square(err), axis=0))
+
+    assert np.all(errors("halton") < errors("random"))
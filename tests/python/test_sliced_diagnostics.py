@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import amrex.space3d as amr
+import numpy as np
+
+from impactx import ImpactX, distribution, elements, read_diagnostics
+
+
+def test_sliced_diagnostics():
+    """
+    Sliced beam characteristics are consistent with the whole beam
+    """
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.init_grids()
+
+    npart = 10000
+    bunch_charge_C = 1.0e-9
+    num_bins = 32
+
+    pc = sim.particle_container()
+    ref = pc.ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Gaussian(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+        muxpx=0.0,
+        muypy=0.0,
+        mutpt=0.5,
+    )
+    sim.add_particles(bunch_charge_C, distr, npart)
+
+    rbc = pc.reduced_beam_characteristics()
+    slices = pc.sliced_beam_characteristics(num_bins)
+    slices = {k: np.array(v) for k, v in slices.items()}
+
+    for name in ["t", "count", "charge_C", "current_A", "sig_pt", "emittance_x"]:
+        assert len(slices[name]) == num_bins
+
+    # all particles are in a slice
+    assert np.sum(slices["count"]) == npart
+    assert np.isclose(np.sum(slices["charge_C"]), rbc["charge_C"], rtol=1.0e-10)
+
+    # slices are ordered and span the beam
+    dt = np.diff(slices["t"])
+    assert np.allclose(dt, dt[0])
+    assert slices["t"][0] - 0.5 * dt[0] <= rbc["t_min"]
+    assert slices["t"][-1] + 0.5 * dt[0] >= rbc["t_max"]
+
+    # charge-weighted slice means are the beam means
+    w = slices["charge_C"] / np.sum(slices["charge_C"])
+    assert np.isclose(np.sum(w * slices["pt_mean"]), rbc["pt_mean"], rtol=1.0e-8, atol=1.0e-12)
+
+    # correlated energy chirp: the slice energy spread is smaller than the projected one
+    filled = slices["count"] > 100
+    assert np.all(slices["sig_pt"][filled] < rbc["sig_pt"])
+
+    # the current integrates to the charge
+    c = 299792458.0
+    assert np.isclose(np.sum(slices["current_A"]) * dt[0] / c, rbc["charge_C"], rtol=1.0e-6)
+
+    sim.finalize()
+
+
+def test_sliced_diagnostics_file():
+    """
+    The sliced beam characteristics file has one row per slice
+    """
+    num_bins = 16
+    pp_diag = amr.ParmParse("diag")
+    pp_diag.add("sliced_beam_characteristics", 1)
+    pp_diag.add("sliced_beam_characteristics_num_bins", num_bins)
+
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.init_grids()
+
+    npart = 10000
+    bunch_charge_C = 1.0e-9
+
+    pc = sim.particle_container()
+    ref = pc.ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Waterbag(
+        lambdaX=3.9984884770e-5,
+        lambdaY=3.9984884770e-5,
+        lambdaT=1.0e-3,
+        lambdaPx=2.6623538760e-5,
+        lambdaPy=2.6623538760e-5,
+        lambdaPt=2.0e-3,
+    )
+    sim.add_particles(bunch_charge_C, distr, npart)
+
+    sim.lattice.append(elements.Drift(ds=1.0))
+    sim.evolve()
+
+    slices = pc.sliced_beam_characteristics(num_bins)
+
+    # the file is appended to by other runs: compare the last step
+    final = read_diagnostics("diags/sliced_beam_characteristics_final.0")
+    final = final.tail(num_bins).reset_index(drop=True)
+    assert np.array_equal(final["slice"], np.arange(num_bins))
+    assert np.sum(final["count"]) == npart
+    assert np.isclose(np.sum(final["charge_C"]), -bunch_charge_C, rtol=1.0e-10)
+    for name in ["t", "count", "x_mean", "sig_x", "sig_pt", "emittance_x"]:
+        assert np.allclose(final[name], slices[name], rtol=1.0e-9, atol=0.0)
+
+    # the initial step is in the file of the slice steps
+    initial = read_diagnostics("diags/sliced_beam_characteristics.0")
+    assert np.sum(initial["count"].tail(num_bins)) == npart
+
+    pp_diag.add("sliced_beam_characteristics", 0)
+    sim.finalize()
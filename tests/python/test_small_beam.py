@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+#
+# Copyright 2022-2023 The ImpactX Community
+#
+# Authors: Axel Huebl
+# License: BSD-3-Clause-LBNL
+#
+# -*- coding: utf-8 -*-
+
+import numpy as np
+
+from impactx import Config, ImpactX, distribution, elements
+
+
+def track(small_beam):
+    """Track a small beam through a scraping lattice, return the beam and the loss map"""
+    sim = ImpactX()
+
+    sim.particle_shape = 2
+    sim.space_charge = False
+    sim.slice_step_diagnostics = False
+    sim.small_beam = small_beam
+    sim.rng_seed = 11
+    sim.diag_loss_map = True
+    sim.diag_loss_map_ds = 0.25
+    sim.init_grids()
+
+    pc = sim.particle_container()
+    ref = pc.ref_particle()
+    ref.set_charge_qe(-1.0).set_mass_MeV(0.510998950).set_kin_energy_MeV(2.0e3)
+
+    distr = distribution.Waterbag(
+        lambdaX=1.0e-3,
+        lambdaY=1.0e-3,
+        lambdaT=1.0e-3,
+        lambdaPx=1.0e-4,
+        lambdaPy=1.0e-4,
+        lambdaPt=1.0e-3,
+    )
+    sim.add_particles(1.0e-9, distr, 300)
+
+    # thick, thin and monitor elements: the monitor needs the particle container
+    sim.periods = 3
+    sim.lattice.extend(
+        [
+            elements.Drift(ds=0.5, nslice=2),
+            elements.Quad(ds=0.5, k=1.0, nslice=3),
+            elements.Aperture(xmax=1.5e-3, ymax=1.5e-3),
+            elements.BeamMonitor("small_beam", backend="h5"),
+            elements.Quad(ds=0.5, k=-1.0),
+            elements.Aperture(xmax=1.5e-3, ymax=1.5e-3, shape="elliptical"),
+        ]
+    )
+    sim.evolve()
+
+    data = pc.to_arrays(copy=True)
+    if Config.have_gpu:
+        import cupy as cp
+
+        data = {k: cp.asnumpy(v) for k, v in data.items()}
+    order = np.argsort(data["idcpu"])
+    beam = {k: v[order] for k, v in data.items()}
+    s_ref = ref.s
+    sim.finalize()
+
+    loss_map = np.genfromtxt("diags/loss_map_s", names=True)
+    return beam, s_ref, loss_map
+
+
+def test_small_beam():
+    """
+    Small beam mode gives the same results as the default mode
+    """
+    beam, s_ref, loss_map = track(small_beam=False)
+    small_beam, small_s_ref, small_loss_map = track(small_beam=True)
+
+    assert loss_map["lost_particles"].sum() > 0
+    assert np.array_equal(small_loss_map["lost_particles"], loss_map["lost_particles"])
+    assert np.isclose(small_s_ref, s_ref)
+
+    assert np.array_equal(small_beam["idcpu"], beam["idcpu"])
+    for name in ["position_x", "position_y", "position_t", "momentum_x", "momentum_y", "momentum_t"]:
+        assert np.allclose(small_beam[name], beam[name], rtol=1.0e-12, atol=1.0e-15)